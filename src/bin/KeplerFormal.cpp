@@ -28,7 +28,7 @@
 static void print_usage(const char* prog) {
   std::printf(
       "Usage: %s [--config <file>] | <-naja_if/-verilog> <netlist1> <netlist2> "
-      "[<liberty-file>...]\n",
+      "[<liberty-file>...] [--threads <n>]\n",
       prog);
 }
 
@@ -64,6 +64,14 @@ int main(int argc, char** argv) {
   bool usedConfig = false;
 
   std::string logFileName;
+  // case analysis: pin path -> constant value
+  std::vector<std::pair<std::string, bool>> caseConstants;
+  // worker threads, 0: CPUs available to the process (cgroup quota aware)
+  size_t threads = 0;
+  // one solver per group of POs sharing support, run on the worker pool
+  bool parallelSAT = false;
+  // memory of the solvers running at once in parallel SAT mode, 0: no limit
+  size_t solverMemoryMB = 0;
 
   for (int i = 1; i < argc; ++i) {
     std::string a = argv[i];
@@ -118,6 +126,39 @@ int main(int argc, char** argv) {
           logFileName = cfg["log_file"].as<std::string>();
         }
 
+        // threads: worker count of the PO builds
+        if (cfg["threads"] && cfg["threads"].IsScalar()) {
+          threads = cfg["threads"].as<size_t>();
+        }
+
+        // parallel_sat: check groups of POs in parallel solvers, bounded by
+        // solver_memory_mb
+        if (cfg["parallel_sat"] && cfg["parallel_sat"].IsScalar()) {
+          parallelSAT = cfg["parallel_sat"].as<bool>();
+        }
+        if (cfg["solver_memory_mb"] && cfg["solver_memory_mb"].IsScalar()) {
+          solverMemoryMB = cfg["solver_memory_mb"].as<size_t>();
+        }
+
+        // constants: map of top-level ports or internal pins
+        // ("inst/sub/pin") to 0 or 1, held in both designs
+        if (cfg["constants"]) {
+          if (!cfg["constants"].IsMap()) {
+            SPDLOG_CRITICAL("constants in config must map pins to 0 or 1");
+            return EXIT_FAILURE;
+          }
+          for (const auto& entry : cfg["constants"]) {
+            std::string pin = entry.first.as<std::string>();
+            std::string value = entry.second.as<std::string>();
+            if (value != "0" && value != "1") {
+              SPDLOG_CRITICAL("Constant value of {} must be 0 or 1, got {}",
+                              pin, value);
+              return EXIT_FAILURE;
+            }
+            caseConstants.emplace_back(pin, value == "1");
+          }
+        }
+
         usedConfig = true;
       } catch (const std::exception& e) {
         SPDLOG_CRITICAL("Failed to parse config {}: {}", cfgPath, e.what());
@@ -146,7 +187,23 @@ int main(int argc, char** argv) {
     }
 
     // collect paths and liberty files from argv
-    for (int i = 2; i < argc; ++i) inputPaths.emplace_back(argv[i]);
+    for (int i = 2; i < argc; ++i) {
+      std::string a = argv[i];
+      if (a == "--threads" || a == "-j") {
+        if (i + 1 >= argc) {
+          SPDLOG_CRITICAL("Missing thread count after {}", a);
+          return EXIT_FAILURE;
+        }
+        try {
+          threads = std::stoul(argv[++i]);
+        } catch (const std::exception&) {
+          SPDLOG_CRITICAL("Invalid thread count: {}", argv[i]);
+          return EXIT_FAILURE;
+        }
+        continue;
+      }
+      inputPaths.emplace_back(a);
+    }
 
     // If user provided more than two paths, treat the rest as liberty files
     if (inputPaths.size() > 2) {
@@ -302,6 +359,10 @@ int main(int argc, char** argv) {
   // --------------------------------------------------------------------------
   try {
     KEPLER_FORMAL::MiterStrategy MiterS(top0, top1, logFileName);
+    MiterS.setCaseConstants(caseConstants);
+    MiterS.setThreads(threads);
+    MiterS.setParallelSAT(parallelSAT);
+    MiterS.setSolverMemoryBudget(solverMemoryMB << 20);
     if (MiterS.run()) {
       SPDLOG_INFO("No difference was found.");
     } else {
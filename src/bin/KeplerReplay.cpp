@@ -0,0 +1,190 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+// Offline replay of cones dumped with KEPLER_DUMP_CLOUDS=<dir>: reload the
+// clouds and time Tree2BoolExpr::convert, Tseitin encoding and solving
+// without the netlists or the libraries. --encode-bench <n> measures the
+// Tseitin encoding throughput on a synthetic miter of n nodes instead.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <tbb/task_arena.h>
+
+#include "SNLLogicCloudDump.h"
+#include "TseitinEncoder.h"
+#include "Tree2BoolExpr.h"
+
+using namespace KEPLER_FORMAL;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Encode `expr` in a fresh solver, assert it and solve.
+bool encodeAndSolve(const std::shared_ptr<BoolExpr>& expr,
+                    double& encodeTime,
+                    double& solveTime) {
+  Glucose::SimpSolver solver;
+  auto start = Clock::now();
+  TseitinEncoder encoder(solver);
+  Glucose::Lit root = encoder.encode(expr);
+  solver.addClause(root);
+  encodeTime = secondsSince(start);
+  start = Clock::now();
+  bool sat = solver.solve();
+  solveTime = secondsSince(start);
+  return sat;
+}
+
+// Chain of random AND/OR/XOR gates over `numVars` inputs: gate k reads gate
+// k-1 and one of the 64 gates before it, so the last gate reaches them all.
+std::shared_ptr<BoolExpr> buildGateChain(size_t numNodes,
+                                         size_t numVars,
+                                         uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<std::shared_ptr<BoolExpr>> nodes;
+  nodes.reserve(numNodes);
+  for (size_t v = 0; v < numVars; ++v) {
+    nodes.push_back(BoolExpr::Var(2 + v));
+  }
+  while (nodes.size() < numNodes) {
+    const auto& a = nodes.back();
+    const size_t window = std::min<size_t>(nodes.size() - 1, 64);
+    const auto& b = nodes[nodes.size() - 2 - rng() % window];
+    switch (rng() % 3) {
+      case 0:
+        nodes.push_back(BoolExpr::And(a, b));
+        break;
+      case 1:
+        nodes.push_back(BoolExpr::Or(a, b));
+        break;
+      default:
+        nodes.push_back(BoolExpr::Xor(a, b));
+        break;
+    }
+  }
+  return nodes.back();
+}
+
+// Tseitin-encode the miter of two gate chains of numNodes / 2 gates each.
+void benchEncode(size_t numNodes) {
+  auto miter = BoolExpr::Xor(buildGateChain(numNodes / 2, 4096, 1),
+                             buildGateChain(numNodes / 2, 4096, 2));
+  Glucose::SimpSolver solver;
+  TseitinEncoder encoder(solver);
+  auto start = Clock::now();
+  encoder.encode(miter);
+  const double encodeTime = secondsSince(start);
+  SPDLOG_INFO("encode bench: {} nodes {:.6f}s ({:.0f} nodes/s)",
+              encoder.getNumEncodedNodes(), encodeTime,
+              encoder.getNumEncodedNodes() / std::max(encodeTime, 1e-9));
+}
+
+void printUsage(const char* prog) {
+  std::printf("Usage: %s [--repeat <n>] [--collapse] <cloud-file>...\n",
+              prog);
+  std::printf("       %s --encode-bench <nodes>\n", prog);
+  std::printf(
+      "Replays every cloud of the given files. Clouds of the same PO found "
+      "in two\nfiles (one per design) are also checked as a miter. "
+      "--collapse merges\nsmall Table subtrees before converting, as "
+      "KEPLER_COLLAPSE_TABLES does.\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t repeat = 1;
+  bool collapse = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--repeat") {
+      if (i + 1 >= argc) {
+        SPDLOG_CRITICAL("Missing count after {}", a);
+        return EXIT_FAILURE;
+      }
+      repeat = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (a == "--encode-bench") {
+      if (i + 1 >= argc) {
+        SPDLOG_CRITICAL("Missing node count after {}", a);
+        return EXIT_FAILURE;
+      }
+      benchEncode(std::strtoull(argv[++i], nullptr, 10));
+      return EXIT_SUCCESS;
+    } else if (a == "--collapse") {
+      collapse = true;
+    } else if (a == "--help" || a == "-h") {
+      printUsage(argv[0]);
+      return EXIT_SUCCESS;
+    } else {
+      files.push_back(a);
+    }
+  }
+  if (files.empty()) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Tree2BoolExpr buffers are indexed by arena slot.
+  tbb::task_arena arena(1);
+  std::map<std::string, std::vector<std::shared_ptr<BoolExpr>>> byName;
+  try {
+    for (const auto& file : files) {
+      std::ifstream in(file, std::ios::binary);
+      if (!in) {
+        SPDLOG_CRITICAL("Cannot open {}", file);
+        return EXIT_FAILURE;
+      }
+      SNLLogicCloudDump::Record record;
+      while (SNLLogicCloudDump::read(in, record)) {
+        size_t absorbed = collapse ? record.tree.collapse() : 0;
+        std::shared_ptr<BoolExpr> expr;
+        double convertTime = 0.0;
+        arena.execute([&]() {
+          for (size_t r = 0; r < repeat; ++r) {
+            auto start = Clock::now();
+            expr = Tree2BoolExpr::convert(record.tree, record.varNames);
+            convertTime += secondsSince(start);
+          }
+        });
+        double encodeTime = 0.0, solveTime = 0.0;
+        bool sat = encodeAndSolve(expr, encodeTime, solveTime);
+        SPDLOG_INFO(
+            "{} [{}]: nodes {} (collapsed {}) inputs {} convert {:.6f}s "
+            "encode {:.6f}s solve {:.6f}s ({})",
+            record.name, file, record.tree.getNumNodes(), absorbed,
+            record.varNames.size(), convertTime / repeat, encodeTime,
+            solveTime, sat ? "SAT" : "UNSAT");
+        byName[record.name].push_back(expr);
+      }
+    }
+
+    for (const auto& [name, exprs] : byName) {
+      if (exprs.size() != 2)
+        continue;
+      double encodeTime = 0.0, solveTime = 0.0;
+      bool sat = encodeAndSolve(BoolExpr::Xor(exprs[0], exprs[1]), encodeTime,
+                                solveTime);
+      SPDLOG_INFO("miter {}: encode {:.6f}s solve {:.6f}s ({})", name,
+                  encodeTime, solveTime, sat ? "DIFFERENT" : "IDENTICAL");
+    }
+  } catch (const std::exception& e) {
+    SPDLOG_ERROR("Replay failed: {}", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "DNLConstantPropagation.h"
+#include <cassert>
+
+// #define DEBUG_PRINTS
+
+#ifdef DEBUG_PRINTS
+#define DEBUG_LOG(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_LOG(fmt, ...)
+#endif
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+using namespace naja::NL;
+
+namespace {
+
+// Wider tables are not cofactored; their outputs stay unknown.
+constexpr uint32_t kMaxArity = 20;
+
+}  // namespace
+
+DNLConstantPropagation::DNLConstantPropagation(const DNLFull& dnl,
+                                               const DNLFaninGraph& graph,
+                                               const DNLTermSet& PIs)
+    : dnl_(dnl),
+      graph_(graph),
+      PIs_(PIs),
+      values_(dnl.getNBterms(), Value::Unknown) {}
+
+void DNLConstantPropagation::assign(DNLID driver, Value value) {
+  assert(value != Value::Unknown);
+  values_[driver] = value;
+  constants_.push_back(driver);
+}
+
+void DNLConstantPropagation::setConstant(DNLID driver, bool value) {
+  const Value v = value ? Value::One : Value::Zero;
+  if (isConstant(driver)) {
+    values_[driver] = v;
+  } else {
+    assign(driver, v);
+  }
+}
+
+DNLConstantPropagation::Value DNLConstantPropagation::evaluate(
+    DNLID driver) const {
+  const SNLTruthTable& table = graph_.getAttributes().getTruthTable(driver);
+  const auto inputs = graph_.getDriverInputs(driver);
+  if (!table.isInitialized() || table.size() != inputs.size()) {
+    return Value::Unknown;
+  }
+  if (table.all0()) {
+    return Value::Zero;
+  }
+  if (table.all1()) {
+    return Value::One;
+  }
+  if (table.size() > kMaxArity) {
+    return Value::Unknown;
+  }
+  uint64_t freeMask = 0;
+  uint64_t known = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const auto drivers = graph_.getDrivers(inputs[i]);
+    const Value v =
+        drivers.size() == 1 ? values_[drivers.front()] : Value::Unknown;
+    if (v == Value::Unknown) {
+      freeMask |= uint64_t{1} << i;
+    } else if (v == Value::One) {
+      known |= uint64_t{1} << i;
+    }
+  }
+  // Rows compatible with the known inputs: every subset of the free inputs.
+  const bool first = table.bits().bit(known);
+  for (uint64_t sub = freeMask & (0 - freeMask); sub != 0;
+       sub = (sub - freeMask) & freeMask) {
+    if (table.bits().bit(known | sub) != first) {
+      return Value::Unknown;
+    }
+  }
+  return first ? Value::One : Value::Zero;
+}
+
+void DNLConstantPropagation::run() {
+  // Tie cells, whatever their inputs.
+  for (DNLID leaf : dnl_.getLeaves()) {
+    const auto [firstTerm, lastTerm] =
+        dnl_.getDNLInstanceFromID(leaf).getTermIndexes();
+    for (DNLID term = firstTerm; term != DNLID_MAX && term <= lastTerm;
+         ++term) {
+      if (!graph_.isOutputTerm(term) || isConstant(term)) {
+        continue;
+      }
+      const SNLTruthTable& table = graph_.getAttributes().getTruthTable(term);
+      if (table.isInitialized() && (table.all0() || table.all1())) {
+        assign(term, table.all1() ? Value::One : Value::Zero);
+      }
+    }
+  }
+  DEBUG_LOG("Constant propagation: %zu seeds\n", constants_.size());
+
+  // Forward: re-evaluate the outputs of the readers of every new constant.
+  for (size_t next = 0; next < constants_.size(); ++next) {
+    const DNLID isoID = graph_.getIsoID(constants_[next]);
+    if (isoID == DNLID_MAX) {
+      continue;
+    }
+    for (DNLID reader :
+         dnl_.getDNLIsoDB().getIsoFromIsoIDconst(isoID).getReaders()) {
+      const DNLInstanceFull& inst =
+          dnl_.getDNLTerminalFromID(reader).getDNLInstance();
+      if (!inst.isLeaf()) {
+        continue;  // top output port
+      }
+      const auto [firstTerm, lastTerm] = inst.getTermIndexes();
+      for (DNLID term = firstTerm; term != DNLID_MAX && term <= lastTerm;
+           ++term) {
+        if (!graph_.isOutputTerm(term) || isConstant(term) ||
+            PIs_.contains(term)) {
+          continue;
+        }
+        const Value value = evaluate(term);
+        if (value != Value::Unknown) {
+          assign(term, value);
+        }
+      }
+    }
+  }
+  DEBUG_LOG("Constant propagation: %zu constant drivers\n",
+            constants_.size());
+}
+
+void DNLConstantPropagation::bindVarNames(std::vector<VarID>& varNames) const {
+  for (auto driver : constants_) {
+    assert(driver < varNames.size());
+    varNames[driver] = values_[driver] == Value::One ? 1 : 0;
+  }
+}
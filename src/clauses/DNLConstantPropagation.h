@@ -0,0 +1,63 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DNL.h"
+#include "DNLFaninGraph.h"
+#include "DNLTermSet.h"
+
+namespace KEPLER_FORMAL {
+
+/// Forward constant propagation over the combinational part of a DNL, run
+/// once before the clouds are built.
+///
+/// Seeds are the outputs of tie cells (leaf outputs with an all0/all1 truth
+/// table) and the drivers forced with setConstant (e.g. user-constrained
+/// PIs). A combinational output becomes constant when its truth table,
+/// restricted to the inputs already known, no longer depends on the others,
+/// so an AND with an input tied to 0 is constant whatever its other inputs.
+/// PIs (sequential and black-box outputs) are never computed, only forced.
+///
+/// SNLLogicCloud and SNLLogicDAG stop at constant drivers; bindVarNames maps
+/// them to the BoolExpr constants for Tree2BoolExpr::convert.
+class DNLConstantPropagation {
+ public:
+  enum class Value : uint8_t { Unknown = 0, Zero = 1, One = 2 };
+
+  DNLConstantPropagation(const naja::DNL::DNLFull& dnl,
+                         const DNLFaninGraph& graph,
+                         const DNLTermSet& PIs);
+
+  /// Force driver terminal `driver` to `value`; call before run.
+  void setConstant(naja::DNL::DNLID driver, bool value);
+  void run();
+
+  Value getValue(naja::DNL::DNLID driver) const { return values_[driver]; }
+  bool isConstant(naja::DNL::DNLID driver) const {
+    return values_[driver] != Value::Unknown;
+  }
+  /// Constant drivers, in the order they were found.
+  const std::vector<naja::DNL::DNLID>& getConstants() const {
+    return constants_;
+  }
+  /// Set varNames[driver] to 0/1 for every constant driver (varNames is
+  /// indexed by DNLID, as for Tree2BoolExpr::convert).
+  void bindVarNames(std::vector<VarID>& varNames) const;
+
+ private:
+  // Value of the output `driver` given the known inputs of its instance.
+  Value evaluate(naja::DNL::DNLID driver) const;
+  void assign(naja::DNL::DNLID driver, Value value);
+
+  const naja::DNL::DNLFull& dnl_;
+  const DNLFaninGraph& graph_;
+  const DNLTermSet& PIs_;
+  std::vector<Value> values_;
+  std::vector<naja::DNL::DNLID> constants_;
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,36 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DNL.h"
+#include "TermID.h"
+
+namespace KEPLER_FORMAL {
+
+/// Packed, immutable membership set of DNL terminals. Built once per build
+/// from the PI or PO list and shared read-only by every cloud, instead of
+/// each cloud filling its own vector<bool> over all terminals.
+class DNLTermSet {
+ public:
+  DNLTermSet() = default;
+  DNLTermSet(size_t numTerms, const std::vector<TermID>& terms)
+      : words_((numTerms + 63) / 64, 0) {
+    for (auto term : terms) {
+      words_[term >> 6] |= uint64_t{1} << (term & 63);
+    }
+  }
+
+  bool contains(naja::DNL::DNLID term) const {
+    return (term >> 6) < words_.size() &&
+           ((words_[term >> 6] >> (term & 63)) & 1u) != 0;
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+};
+
+}  // namespace KEPLER_FORMAL
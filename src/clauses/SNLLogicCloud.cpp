@@ -5,16 +5,21 @@
 #include <tbb/tbb_allocator.h>
 #include <cassert>
 #include "SNLDesignModeling.h"
+#include "TraversalMarks.h"
 #include "tbb/concurrent_vector.h"
 #include "tbb/enumerable_thread_specific.h"
 
-typedef std::pair<
-    std::vector<naja::DNL::DNLID, tbb::tbb_allocator<naja::DNL::DNLID>>,
-    size_t>
+using KEPLER_FORMAL::TermID;
+
+typedef std::pair<std::vector<TermID, tbb::tbb_allocator<TermID>>, size_t>
     IterationInputsETSPair;
 tbb::enumerable_thread_specific<IterationInputsETSPair>
     currentIterationInputsETS;
 tbb::enumerable_thread_specific<IterationInputsETSPair> newIterationInputsETS;
+// Drivers whose inputs were already pushed, reused across the clouds of a
+// worker.
+tbb::enumerable_thread_specific<KEPLER_FORMAL::TraversalMarks>
+    handledDriversETS;
 
 tbb::concurrent_vector<IterationInputsETSPair*>
     currentIterationInputsETSvector =
@@ -69,7 +74,7 @@ void clearCurrentIterationInputsETS() {
   currentIterationInputs.second = 0;
 }
 
-void pushBackCurrentIterationInputsETS(naja::DNL::DNLID input) {
+void pushBackCurrentIterationInputsETS(TermID input) {
   auto& currentIterationInputs = getCurrentIterationInputsETS();
   auto& vec = currentIterationInputs.first;
   auto& sz = currentIterationInputs.second;
@@ -86,7 +91,7 @@ size_t sizeOfCurrentIterationInputsETS() {
   return getCurrentIterationInputsETS().second;
 }
 
-void copyCurrentIterationInputsETS(std::vector<naja::DNL::DNLID>& res) {
+void copyCurrentIterationInputsETS(std::vector<TermID>& res) {
   res.clear();
   auto& current = getCurrentIterationInputsETS();
   for (size_t i = 0; i < current.second; i++) {
@@ -99,7 +104,7 @@ void clearNewIterationInputsETS() {
   newIterationInputs.second = 0;
 }
 
-void pushBackNewIterationInputsETS(naja::DNL::DNLID input) {
+void pushBackNewIterationInputsETS(TermID input) {
   auto& newIterationInputs = getNewIterationInputsETS();
   auto& vec = newIterationInputs.first;
   auto& sz = newIterationInputs.second;
@@ -141,11 +146,11 @@ using namespace KEPLER_FORMAL;
 using namespace naja::DNL;
 
 bool SNLLogicCloud::isInput(naja::DNL::DNLID termID) {
-  return PIs_[termID];
+  return PIs_->contains(termID);
 }
 
 bool SNLLogicCloud::isOutput(naja::DNL::DNLID termID) {
-  return POs_[termID];
+  return POs_->contains(termID);
 }
 
 void SNLLogicCloud::compute() {
@@ -155,15 +160,15 @@ void SNLLogicCloud::compute() {
   initCurrentIterationInputsETS();
   clearNewIterationInputsETS();
   clearCurrentIterationInputsETS();
+  currentIterationInputs_.clear();
   DEBUG_LOG("---- Begin!!\n");
-  if (dnl_.getDNLTerminalFromID(seedOutputTerm_).isTopPort() ||
-      isOutput(seedOutputTerm_)) {
-    auto iso = dnl_.getDNLIsoDB().getIsoFromIsoIDconst(
-        dnl_.getDNLTerminalFromID(seedOutputTerm_).getIsoID());
+  const DNLTermAttributes& attributes = graph_->getAttributes();
+  if (attributes.isTopPort(seedOutputTerm_) || isOutput(seedOutputTerm_)) {
+    const auto drivers = graph_->getDrivers(seedOutputTerm_);
     // LCOV_EXCL_START
-    if (iso.getDrivers().size() > 1) {
+    if (drivers.size() > 1) {
       
-      for (auto driver : iso.getDrivers()) {
+      for (auto driver : drivers) {
         DEBUG_LOG("Driver: %s\n", dnl_.getDNLTerminalFromID(driver)
                                       .getSnlBitTerm()
                                       ->getName()
@@ -171,7 +176,7 @@ void SNLLogicCloud::compute() {
                                       .c_str());
       }
       throw std::runtime_error("Seed output term is not a single driver");
-    } else if (iso.getDrivers().empty()) {
+    } else if (drivers.empty()) {
       std::string termName = dnl_.getDNLTerminalFromID(seedOutputTerm_)
                                  .getSnlBitTerm()
                                  ->getName()
@@ -181,50 +186,46 @@ void SNLLogicCloud::compute() {
       throw std::runtime_error(error);
     }
     // LCOV_EXCL_STOP
-    auto driver = iso.getDrivers().front();
-    auto inst = dnl_.getDNLTerminalFromID(driver).getDNLInstance();
-    if (isInput(driver)) {
-      pushBackCurrentIterationInputsETS(driver);
-      table_ = SNLTruthTableTree(inst.getID(), driver,
-                                 SNLTruthTableTree::Node::Type::P);
+    auto driver = drivers.front();
+    const DNLID instID = graph_->getInstanceID(driver);
+    if (isInput(driver) || isConstant(driver) || isCached(driver)) {
+      if (isInput(driver)) {
+        currentIterationInputs_.push_back(driver);
+      }
+      table_ = SNLTruthTableTree(instID, driver,
+                                 SNLTruthTableTree::Node::Type::P,
+                                 &attributes);
       return;
     }
-    DEBUG_LOG("Instance name: %s\n",
-              inst.getSNLInstance()->getName().getString().c_str());
-    for (DNLID termID = inst.getTermIndexes().first;
-         termID <= inst.getTermIndexes().second; termID++) {
-      const DNLTerminalFull& term = dnl_.getDNLTerminalFromID(termID);
-      if (term.getSnlBitTerm()->getDirection() !=
-          SNLBitTerm::Direction::Output) {
-        pushBackNewIterationInputsETS(termID);
-        DEBUG_LOG("Add input with id: %zu\n", termID);
-      }
+    DEBUG_LOG("Instance name: %s\n", dnl_.getDNLInstanceFromID(instID)
+                                         .getSNLInstance()
+                                         ->getName()
+                                         .getString()
+                                         .c_str());
+    for (DNLID termID : graph_->getInstanceInputs(instID)) {
+      pushBackNewIterationInputsETS(termID);
+      DEBUG_LOG("Add input with id: %zu\n", termID);
     }
     DEBUG_LOG("model name: %s\n",
-              inst.getSNLModel()->getName().getString().c_str());
-    table_ = SNLTruthTableTree(inst.getID(), driver);
-    auto* model = const_cast<SNLDesign*>(inst.getSNLModel());
-    assert(SNLDesignModeling::getTruthTable(model, 
-                dnl_.getDNLTerminalFromID(driver).getSnlBitTerm()->getOrderID())
-            .isInitialized() &&
-        "Truth table is not initialized");
+              attributes.getModel(driver)->getName().getString().c_str());
+    table_ = SNLTruthTableTree(instID, driver,
+                               SNLTruthTableTree::Node::Type::Table,
+                               &attributes);
+    assert(attributes.getTruthTable(driver).isInitialized() &&
+           "Truth table is not initialized");
     assert(table_.isInitialized() &&
            "Truth table for seed output term is not initialized");
   } else {
     auto inst = dnl_.getDNLInstanceFromID(seedOutputTerm_);
-    for (DNLID termID = inst.getTermIndexes().first;
-         termID <= inst.getTermIndexes().second; termID++) {
-      const DNLTerminalFull& term = dnl_.getDNLTerminalFromID(termID);
-      if (term.getSnlBitTerm()->getDirection() !=
-          SNLBitTerm::Direction::Output) {
-        // newIterationInputs.push_back(termID);
-        pushBackNewIterationInputsETS(termID);
-        DEBUG_LOG("Add input with id: %zu\n", termID);
-      }
+    for (DNLID termID : graph_->getInstanceInputs(inst.getID())) {
+      pushBackNewIterationInputsETS(termID);
+      DEBUG_LOG("Add input with id: %zu\n", termID);
     }
     DEBUG_LOG("model name: %s\n",
               inst.getSNLModel()->getName().getString().c_str());
-    table_ = SNLTruthTableTree(inst.getID(), seedOutputTerm_);
+    table_ = SNLTruthTableTree(inst.getID(), seedOutputTerm_,
+                               SNLTruthTableTree::Node::Type::Table,
+                               &attributes);
     assert(table_.isInitialized() &&
            "Truth table for seed output term is not initialized");
   }
@@ -234,21 +235,13 @@ void SNLLogicCloud::compute() {
     return;
   }
 
-  bool reachedPIs = true;
-  size_t size = sizeOfNewIterationInputsETS();
-  for (size_t i = 0; i < size; i++) {
-    if (!isInput(
-            getNewIterationInputsETS().first
-                [i]) /* && !isOutput(getNewIterationInputsETS().first[i])*/) {
-      reachedPIs = false;
-      break;
-    }
-  }
-
-  std::set<std::pair<naja::DNL::DNLID, naja::DNL::DNLID>> handledTerms;
+  TraversalMarks& handledDrivers = handledDriversETS.local();
+  handledDrivers.reset(dnl_.getNBterms());
   size_t iter = 0;
 
-  while (!reachedPIs) {
+  // Reached PIs become closed P leaves of the tree and are not carried to
+  // the next level, so each level only costs its own frontier.
+  while (!emptyNewIterationInputsETS()) {
     DEBUG_LOG("---iter %lu---\n", iter);
     DEBUG_LOG("Current iteration inputs size: %zu\n",
               sizeOfNewIterationInputsETS());
@@ -258,16 +251,15 @@ void SNLLogicCloud::compute() {
     DEBUG_LOG("table size: %zu, currentIterationInputs_ size: %zu\n",
               table_.size(), sizeOfCurrentIterationInputsETS());
 
-    std::vector<
-        std::pair<naja::DNL::DNLID, naja::DNL::DNLID>,
-        tbb::tbb_allocator<std::pair<naja::DNL::DNLID, naja::DNL::DNLID>>>
+    std::vector<SNLTruthTableTree::Splice,
+                tbb::tbb_allocator<SNLTruthTableTree::Splice>>
         inputsToMerge;
 
     size_t sizeOfCurrentInputs = sizeOfCurrentIterationInputsETS();
     for (size_t i = 0; i < sizeOfCurrentInputs; i++) {
       auto input = getCurrentIterationInputsETS().first[i];
       if (isInput(input) /*|| isOutput(input)*/) {
-        pushBackNewIterationInputsETS(input);
+        currentIterationInputs_.push_back(input);
         DEBUG_LOG("Adding input id: %zu %s\n", input,
                   dnl_.getDNLTerminalFromID(input)
                       .getSnlBitTerm()
@@ -275,15 +267,14 @@ void SNLLogicCloud::compute() {
                       .getString()
                       .c_str());
         inputsToMerge.push_back(
-            {naja::DNL::DNLID_MAX, input});  // Placeholder for PI/PO
+            {kNoTermID, input});  // Placeholder for PI/PO
         continue;
       }
 
-      auto iso = dnl_.getDNLIsoDB().getIsoFromIsoIDconst(
-          dnl_.getDNLTerminalFromID(input).getIsoID());
-      DEBUG_LOG("number of drivers: %zu\n", iso.getDrivers().size());
+      const auto drivers = graph_->getDrivers(input);
+      DEBUG_LOG("number of drivers: %zu\n", drivers.size());
 
-      for (auto driver : iso.getDrivers()) {
+      for (auto driver : drivers) {
         DEBUG_LOG("Driver: %s\n", dnl_.getDNLTerminalFromID(driver)
                                       .getSnlBitTerm()
                                       ->getName()
@@ -291,18 +282,23 @@ void SNLLogicCloud::compute() {
                                       .c_str());
       }
 
-      if (iso.getDrivers().size() >= 1) {
-        assert(iso.getDrivers().size() <= 1 &&
-               "Iso have more than one driver, not supported");
-      } else if (iso.getDrivers().empty()) {
-        iso.display(std::cerr);
-        assert(iso.getDrivers().size() == 1 &&
-               "Iso have no drivers and more than one reader, not supported");
+      assert(drivers.size() == 1 &&
+             "Iso of a cone input must have exactly one driver");
+
+      auto driver = drivers.front();
+      if (bypassBuffers_) {
+        bool negated = false;
+        // a constant or cached driver ends the chain: the bypass must not
+        // expand the logic behind a forced or already converted net
+        driver = graph_->skipPassthrough(driver, negated, [this](DNLID term) {
+          return isInput(term) || isConstant(term) || isCached(term);
+        });
+        if (negated) {
+          table_.negateBorderInput(inputsToMerge.size());
+        }
       }
-
-      auto driver = iso.getDrivers().front();
       if (isInput(driver) /* || isOutput(driver)*/) {
-        pushBackNewIterationInputsETS(driver);
+        currentIterationInputs_.push_back(driver);
         DEBUG_LOG(
             "- %lu After analyzing input %s(%lu), addings driver %s(%lu) is a "
             "primary input\n",
@@ -320,13 +316,23 @@ void SNLLogicCloud::compute() {
                 .c_str(),
             driver);
         inputsToMerge.push_back(
-            {naja::DNL::DNLID_MAX, driver});  // Placeholder for PI/PO
+            {kNoTermID, driver});  // Placeholder for PI/PO
         continue;
       }
 
-      auto inst = dnl_.getDNLInstanceFromID(
-          dnl_.getDNLTerminalFromID(driver).getDNLInstance().getID());
-      auto* model = const_cast<SNLDesign*>(inst.getSNLModel());
+      if (isConstant(driver)) {
+        // constant net: the branch behind it is pruned
+        inputsToMerge.push_back({kNoTermID, driver});
+        continue;
+      }
+
+      if (isCached(driver)) {
+        // sub-cone already converted by another PO: stop here
+        inputsToMerge.push_back({kNoTermID, driver});
+        continue;
+      }
+
+      const DNLID instID = graph_->getInstanceID(driver);
       // if (!model
       //          ->getTruthTable(dnl_.getDNLTerminalFromID(driver)
       //                              .getSnlBitTerm()
@@ -356,36 +362,16 @@ void SNLLogicCloud::compute() {
                     ->getName()
                     .getString()
                     .c_str());
-      inputsToMerge.push_back({inst.getID(), driver});
-
-      for (DNLID termID = inst.getTermIndexes().first;
-           termID <= inst.getTermIndexes().second; termID++) {
-        const DNLTerminalFull& term = dnl_.getDNLTerminalFromID(termID);
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Output) {
-          if (handledTerms.find({driver, termID}) != handledTerms.end()) {
-            DEBUG_LOG(
-                "#### iter %lu 1 Term (%zu) %s of inst %s already handled, "
-                "skipping\n",
-                iter, input,
-                naja::DNL::get()
-                    ->getDNLTerminalFromID(input)
-                    .getSnlBitTerm()
-                    ->getName()
-                    .getString()
-                    .c_str(),
-                naja::DNL::get()
-                    ->getDNLTerminalFromID(input)
-                    .getDNLInstance()
-                    .getSNLModel()
-                    ->getName()
-                    .getString()
-                    .c_str());
-            continue;
-          }
-          handledTerms.insert({driver, termID});
-          pushBackNewIterationInputsETS(termID);
-        }
+      inputsToMerge.push_back({instID, driver});
+
+      // the inputs of a driver are pushed once: later visits reuse its node
+      if (!handledDrivers.mark(driver)) {
+        DEBUG_LOG("#### iter %lu driver %zu already handled, skipping\n",
+                  iter, driver);
+        continue;
+      }
+      for (DNLID termID : graph_->getInstanceInputs(instID)) {
+        pushBackNewIterationInputsETS(termID);
       }
     }
 
@@ -396,21 +382,12 @@ void SNLLogicCloud::compute() {
     DEBUG_LOG("--- Merging truth tables with %zu inputs\n",
               inputsToMerge.size());
     table_.concatFull(inputsToMerge);
-    reachedPIs = true;
-    size_t sizeOfNewInputs = sizeOfNewIterationInputsETS();
-    for (size_t i = 0; i < sizeOfNewInputs; i++) {
-      if (!isInput(getNewIterationInputsETS().first[i])) {
-        reachedPIs = false;
-        break;
-      }
-    }
     DEBUG_LOG("--- End of iteration %zu\n", iter);
     iter++;
   }
 
-  copyNewIterationInputsETStoCurrent();
-  copyCurrentIterationInputsETS(currentIterationInputs_);
-  assert(currentIterationInputs_.size() == sizeOfCurrentIterationInputsETS());
+  assert(table_.getNumBorderLeaves() == 0 &&
+         "all border leaves should be closed once the frontier is empty");
   for (auto input : currentIterationInputs_) {
     assert(isInput(input));
   }
@@ -1,36 +1,73 @@
 // Copyright 2024-2026 keplertech.io
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <memory>
+
 #include "DNL.h"
+#include "DNLConstantPropagation.h"
+#include "DNLFaninGraph.h"
+#include "DNLTermSet.h"
 #include "SNLTruthTableTree.h"
+#include "SharedConeCache.h"
 
 namespace KEPLER_FORMAL {
 
 class SNLLogicCloud {
  public:
+  // PIs, POs and the fan-in graph are shared by all the clouds of a build;
+  // they must outlive the cloud. With a cache, drivers already published
+  // there become P leaves; convert the tree with the same cache to resolve
+  // them.
   SNLLogicCloud(naja::DNL::DNLID seedOutputTerm,
-                const std::vector<naja::DNL::DNLID>& PIs,
-                const std::vector<naja::DNL::DNLID>& POs)
-      : seedOutputTerm_(seedOutputTerm), dnl_(*naja::DNL::get()) {
-    PIs_ = std::vector<bool>(naja::DNL::get()->getNBterms(), false);
-    for (auto pi : PIs) {
-      PIs_[pi] = true;
-    }
-    POs_ = std::vector<bool>(naja::DNL::get()->getNBterms(), false);
-    for (auto po : POs) {
-      POs_[po] = true;
-    }
-  }
+                const DNLTermSet& PIs,
+                const DNLTermSet& POs,
+                const DNLFaninGraph& graph,
+                const SharedConeCache* cache = nullptr)
+      : seedOutputTerm_(seedOutputTerm),
+        dnl_(*naja::DNL::get()),
+        cache_(cache),
+        PIs_(&PIs),
+        POs_(&POs),
+        graph_(&graph) {}
+  // Standalone cloud: builds its own PI/PO sets and fan-in graph.
+  SNLLogicCloud(naja::DNL::DNLID seedOutputTerm,
+                const std::vector<TermID>& PIs,
+                const std::vector<TermID>& POs,
+                const SharedConeCache* cache = nullptr)
+      : seedOutputTerm_(seedOutputTerm),
+        dnl_(*naja::DNL::get()),
+        cache_(cache),
+        ownedPIs_(naja::DNL::get()->getNBterms(), PIs),
+        ownedPOs_(naja::DNL::get()->getNBterms(), POs),
+        ownedGraph_(std::make_unique<DNLFaninGraph>(*naja::DNL::get())),
+        PIs_(&ownedPIs_),
+        POs_(&ownedPOs_),
+        graph_(ownedGraph_.get()) {}
   void compute();
   bool isInput(naja::DNL::DNLID inputTerm);
   bool isOutput(naja::DNL::DNLID inputTerm);
+  // Expand frontier inputs through buffers and inverters (default): the
+  // cell behind them is spliced directly and inversions are folded into the
+  // reading table.
+  void setBypassBuffers(bool bypass) { bypassBuffers_ = bypass; }
+  // Stop at the drivers found constant by `constants` (closed P leaves);
+  // convert with varNames bound by DNLConstantPropagation::bindVarNames.
+  void setConstants(const DNLConstantPropagation* constants) {
+    constants_ = constants;
+  }
+  bool isConstant(naja::DNL::DNLID driver) const {
+    return constants_ != nullptr && constants_->isConstant(driver);
+  }
+  bool isCached(naja::DNL::DNLID driver) const {
+    return cache_ != nullptr && cache_->find(toTermID(driver)) != nullptr;
+  }
   SNLTruthTableTree& getTruthTable() { return table_; }
-  const std::vector<naja::DNL::DNLID>& getInputs() const {
+  const std::vector<TermID>& getInputs() const {
     return currentIterationInputs_;
   }
   // Get all inputs from the tree SNLTruthTableTree directly
-  std::vector<naja::DNL::DNLID> getAllInputs() const {
-    std::vector<naja::DNL::DNLID> allInputs;
+  std::vector<TermID> getAllInputs() const {
+    std::vector<TermID> allInputs;
     std::vector<std::shared_ptr<SNLTruthTableTree::Node>> stk;
     stk.push_back(table_.getRoot());
     while (!stk.empty()) {
@@ -51,11 +88,18 @@ class SNLLogicCloud {
 
  private:
   naja::DNL::DNLID seedOutputTerm_;
-  std::vector<naja::DNL::DNLID> currentIterationInputs_;
+  std::vector<TermID> currentIterationInputs_;
   SNLTruthTableTree table_;
   const naja::DNL::DNLFull& dnl_;
-  std::vector<bool> PIs_;
-  std::vector<bool> POs_;
+  const SharedConeCache* cache_ = nullptr;
+  DNLTermSet ownedPIs_;
+  DNLTermSet ownedPOs_;
+  std::unique_ptr<DNLFaninGraph> ownedGraph_;
+  const DNLTermSet* PIs_;
+  const DNLTermSet* POs_;
+  const DNLFaninGraph* graph_;
+  bool bypassBuffers_ = true;
+  const DNLConstantPropagation* constants_ = nullptr;
 };
 
 }  // namespace KEPLER_FORMAL
\ No newline at end of file
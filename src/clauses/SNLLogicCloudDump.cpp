@@ -0,0 +1,327 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "SNLLogicCloudDump.h"
+#include <cassert>
+#include <istream>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "NajaDynamicBitset.h"
+
+using namespace KEPLER_FORMAL;
+
+namespace {
+
+constexpr uint32_t kMagic = 0x444c434b;  // "KCLD"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNoTable = std::numeric_limits<uint32_t>::max();
+
+template <typename T>
+void put(std::ostream& out, T value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putString(std::ostream& out, const std::string& s) {
+  put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+  out.write(s.data(), s.size());
+}
+
+// Widest table a record may hold: the composite tables of
+// SNLTruthTableTree::collapse stay far below it.
+constexpr uint32_t kMaxArity = 24;
+
+// Reads one record, bounding every length by the bytes left in the stream so
+// that a corrupt file cannot request huge allocations.
+class Reader {
+ public:
+  explicit Reader(std::istream& in) : in_(in) {
+    const auto pos = in_.tellg();
+    if (pos < 0)
+      return;
+    in_.seekg(0, std::ios::end);
+    const auto end = in_.tellg();
+    in_.seekg(pos);
+    if (end >= pos)
+      left_ = static_cast<uint64_t>(end - pos);
+  }
+
+  template <typename T>
+  T get() {
+    need(1, sizeof(T));
+    T value{};
+    in_.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!in_) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("SNLLogicCloudDump: truncated record");
+      // LCOV_EXCL_STOP
+    }
+    left_ -= sizeof(T);
+    return value;
+  }
+
+  std::string getString() {
+    const uint32_t size = get<uint32_t>();
+    need(size, 1);
+    std::string s(size, '\0');
+    in_.read(s.data(), s.size());
+    if (!in_) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("SNLLogicCloudDump: truncated record");
+      // LCOV_EXCL_STOP
+    }
+    left_ -= size;
+    return s;
+  }
+
+  // Throw unless `count` items of at least `bytes` bytes each can follow.
+  void need(uint64_t count, uint64_t bytes) const {
+    if (count > left_ / bytes)
+      throw std::runtime_error("SNLLogicCloudDump: truncated record");
+  }
+
+ private:
+  std::istream& in_;
+  uint64_t left_ = std::numeric_limits<uint64_t>::max();
+};
+
+// Truth tables are stored as their arity followed by 2^arity packed bits.
+using PackedTable = std::pair<uint32_t, std::vector<uint64_t>>;
+
+PackedTable pack(const naja::NL::SNLTruthTable& table) {
+  PackedTable packed{table.size(), {}};
+  const uint64_t rows = uint64_t{1} << table.size();
+  packed.second.resize((rows + 63) / 64, 0);
+  for (uint64_t m = 0; m < rows; ++m) {
+    if (table.bits().bit(m))
+      packed.second[m / 64] |= uint64_t{1} << (m % 64);
+  }
+  return packed;
+}
+
+naja::NL::SNLTruthTable unpack(const PackedTable& packed) {
+  const uint32_t size = packed.first;
+  if (size <= 6)
+    return naja::NL::SNLTruthTable(size, packed.second[0]);
+  const uint64_t rows = uint64_t{1} << size;
+  naja::NajaDynamicBitset bits(rows);
+  for (uint64_t m = 0; m < rows; ++m) {
+    if ((packed.second[m / 64] >> (m % 64)) & 1u)
+      bits.set(m, true);
+  }
+  return naja::NL::SNLTruthTable(size, bits);
+}
+
+}  // namespace
+
+void SNLLogicCloudDump::write(std::ostream& out,
+                              const std::string& name,
+                              const SNLTruthTableTree& tree,
+                              const std::vector<VarID>& varNames,
+                              const InputKey& inputKey) {
+  using Node = SNLTruthTableTree::Node;
+  const size_t numNodes = tree.getNumNodes();
+
+  // Distinct tables and local PI slots, in node order.
+  std::map<PackedTable, uint32_t> tableIndex;
+  std::vector<const PackedTable*> tables;
+  std::vector<uint32_t> nodeTable(numNodes, kNoTable);
+  std::unordered_map<TermID, uint32_t> slotOf;
+  std::vector<TermID> slots;
+  for (size_t i = 0; i < numNodes; ++i) {
+    const auto& sp = tree.nodeFromId(static_cast<uint32_t>(i) +
+                                     SNLTruthTableTree::kIdOffset);
+    if (!sp) {
+      // LCOV_EXCL_START
+      throw std::logic_error("SNLLogicCloudDump: tree is not finalized");
+      // LCOV_EXCL_STOP
+    }
+    if (sp->type == Node::Type::Table) {
+      auto [it, inserted] = tableIndex.emplace(
+          pack(sp->getTruthTable()), static_cast<uint32_t>(tables.size()));
+      if (inserted)
+        tables.push_back(&it->first);
+      nodeTable[i] = it->second;
+    } else if (sp->type == Node::Type::P) {
+      if (slotOf.emplace(sp->data.termid, slots.size()).second)
+        slots.push_back(sp->data.termid);
+    }
+  }
+
+  put(out, kMagic);
+  put(out, kVersion);
+  putString(out, name);
+  put<uint32_t>(out, static_cast<uint32_t>(numNodes));
+  put<uint32_t>(out, tree.getRootId());
+  put<uint64_t>(out, tree.size());
+
+  put<uint32_t>(out, static_cast<uint32_t>(tables.size()));
+  for (const auto* table : tables) {
+    put<uint32_t>(out, table->first);
+    for (uint64_t word : table->second)
+      put(out, word);
+  }
+
+  put<uint32_t>(out, static_cast<uint32_t>(slots.size()));
+  for (auto termid : slots) {
+    assert(termid < varNames.size());
+    put<uint64_t>(out, varNames[termid] == kNoVarID
+                           ? std::numeric_limits<uint64_t>::max()
+                           : uint64_t{varNames[termid]});
+    putString(out, inputKey(termid));
+  }
+
+  for (size_t i = 0; i < numNodes; ++i) {
+    const auto& sp = tree.nodeFromId(static_cast<uint32_t>(i) +
+                                     SNLTruthTableTree::kIdOffset);
+    put<uint8_t>(out, static_cast<uint8_t>(sp->type));
+    switch (sp->type) {
+      case Node::Type::Input:
+        put<uint64_t>(out, sp->data.inputIndex);
+        break;
+      case Node::Type::P:
+        put<uint64_t>(out, slotOf[sp->data.termid]);
+        break;
+      case Node::Type::Table:
+        put<uint64_t>(out, sp->data.termid);
+        put<uint32_t>(out, nodeTable[i]);
+        break;
+    }
+    put<uint32_t>(out, static_cast<uint32_t>(sp->childrenIds.size()));
+    for (auto cid : sp->childrenIds)
+      put(out, cid);
+    put<uint32_t>(out, static_cast<uint32_t>(sp->parentIds.size()));
+    for (auto pid : sp->parentIds)
+      put(out, pid);
+  }
+}
+
+bool SNLLogicCloudDump::read(std::istream& in, Record& record) {
+  using Node = SNLTruthTableTree::Node;
+  uint32_t magic = 0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  if (in.gcount() == 0)
+    return false;
+  uint32_t version = 0;
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  if (!in || magic != kMagic || version != kVersion) {
+    // LCOV_EXCL_START
+    throw std::runtime_error("SNLLogicCloudDump: bad header");
+    // LCOV_EXCL_STOP
+  }
+  Reader reader(in);
+  record.name = reader.getString();
+  const uint32_t numNodes = reader.get<uint32_t>();
+  const uint32_t rootId = reader.get<uint32_t>();
+  const uint64_t numExternalInputs = reader.get<uint64_t>();
+  // Node ids are slot + kIdOffset, as allocateNode assigns them.
+  auto checkId = [numNodes](uint32_t id) {
+    if (id < SNLTruthTableTree::kIdOffset ||
+        id - SNLTruthTableTree::kIdOffset >= numNodes) {
+      throw std::runtime_error("SNLLogicCloudDump: bad node id " +
+                               std::to_string(id));
+    }
+    return id;
+  };
+  if (rootId != SNLTruthTableTree::kInvalidId)
+    checkId(rootId);
+
+  const uint32_t numTables = reader.get<uint32_t>();
+  reader.need(numTables, sizeof(uint32_t) + sizeof(uint64_t));
+  std::vector<naja::NL::SNLTruthTable> tables(numTables);
+  for (auto& table : tables) {
+    PackedTable packed{reader.get<uint32_t>(), {}};
+    if (packed.first > kMaxArity) {
+      throw std::runtime_error("SNLLogicCloudDump: bad table arity " +
+                               std::to_string(packed.first));
+    }
+    const uint64_t numWords = ((uint64_t{1} << packed.first) + 63) / 64;
+    reader.need(numWords, sizeof(uint64_t));
+    packed.second.resize(numWords);
+    for (auto& word : packed.second)
+      word = reader.get<uint64_t>();
+    table = unpack(packed);
+  }
+
+  const uint32_t numSlots = reader.get<uint32_t>();
+  reader.need(numSlots, sizeof(uint64_t) + sizeof(uint32_t));
+  record.varNames.resize(numSlots);
+  record.inputKeys.resize(numSlots);
+  for (uint32_t s = 0; s < numSlots; ++s) {
+    const uint64_t var = reader.get<uint64_t>();
+    if (var != std::numeric_limits<uint64_t>::max() && var >= kNoVarID) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("SNLLogicCloudDump: bad variable id " +
+                               std::to_string(var));
+      // LCOV_EXCL_STOP
+    }
+    record.varNames[s] = var == std::numeric_limits<uint64_t>::max()
+                             ? kNoVarID
+                             : static_cast<VarID>(var);
+    record.inputKeys[s] = reader.getString();
+  }
+
+  SNLTruthTableTree& tree = record.tree;
+  tree.destroy();
+  // type, data and the two list sizes
+  reader.need(numNodes, sizeof(uint8_t) + sizeof(uint64_t) +
+                            2 * sizeof(uint32_t));
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    auto node = tree.newNode(0u, &tree);
+    const uint8_t type = reader.get<uint8_t>();
+    if (type > static_cast<uint8_t>(Node::Type::P)) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("SNLLogicCloudDump: bad node type " +
+                               std::to_string(type));
+      // LCOV_EXCL_STOP
+    }
+    node->type = static_cast<Node::Type>(type);
+    const uint64_t data = reader.get<uint64_t>();
+    if (node->type == Node::Type::Input) {
+      if (data > std::numeric_limits<uint32_t>::max()) {
+        // LCOV_EXCL_START
+        throw std::runtime_error("SNLLogicCloudDump: bad input index " +
+                                 std::to_string(data));
+        // LCOV_EXCL_STOP
+      }
+      node->data.inputIndex = static_cast<uint32_t>(data);
+    } else {
+      // P nodes hold a local slot, Table nodes their terminal
+      if (data > std::numeric_limits<TermID>::max() ||
+          (node->type == Node::Type::P && data >= numSlots)) {
+        // LCOV_EXCL_START
+        throw std::runtime_error("SNLLogicCloudDump: bad terminal id " +
+                                 std::to_string(data));
+        // LCOV_EXCL_STOP
+      }
+      node->data.termid = static_cast<TermID>(data);
+    }
+    if (node->type == Node::Type::Table) {
+      const uint32_t t = reader.get<uint32_t>();
+      if (t >= tables.size()) {
+        // LCOV_EXCL_START
+        throw std::runtime_error("SNLLogicCloudDump: bad table index");
+        // LCOV_EXCL_STOP
+      }
+      node->truthTable = tables[t];
+    }
+    const uint32_t numChildren = reader.get<uint32_t>();
+    reader.need(numChildren, sizeof(uint32_t));
+    node->childrenIds.resize(numChildren);
+    for (auto& cid : node->childrenIds)
+      cid = checkId(reader.get<uint32_t>());
+    const uint32_t numParents = reader.get<uint32_t>();
+    reader.need(numParents, sizeof(uint32_t));
+    node->parentIds.resize(numParents);
+    for (auto& pid : node->parentIds)
+      pid = checkId(reader.get<uint32_t>());
+    tree.allocateNode(node);
+  }
+  tree.rootId_ = rootId;
+  tree.numExternalInputs_ = numExternalInputs;
+  tree.finalize();
+  return true;
+}
@@ -0,0 +1,53 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "SNLTruthTableTree.h"
+
+namespace KEPLER_FORMAL {
+
+/// Compact binary dump of one SNLLogicCloud result, so that a slow PO can be
+/// replayed (convert, encode, solve) without the netlist and libraries.
+///
+/// A record stores the tree topology with canonical node ids, a pool of the
+/// distinct truth tables referenced by Table nodes and, for every P node, a
+/// local input slot instead of the design-specific DNLID. Each slot carries
+/// the BoolExpr variable id used by Tree2BoolExpr::convert and a stable path
+/// key of the primary input. Records are appended one after the other; a
+/// file may hold any number of them.
+class SNLLogicCloudDump {
+ public:
+  struct Record {
+    std::string name;  // stable key of the PO
+    SNLTruthTableTree tree;
+    // P node termid (local slot) -> BoolExpr var id, ready for
+    // Tree2BoolExpr::convert.
+    std::vector<VarID> varNames;
+    // local slot -> stable path key of the primary input
+    std::vector<std::string> inputKeys;
+  };
+
+  using InputKey = std::function<std::string(naja::DNL::DNLID)>;
+
+  /// Append a finalized tree to `out`. varNames is indexed by terminal, as
+  /// for Tree2BoolExpr::convert. Ids are stored on 64 bits whatever the
+  /// TermID width.
+  static void write(std::ostream& out,
+                    const std::string& name,
+                    const SNLTruthTableTree& tree,
+                    const std::vector<VarID>& varNames,
+                    const InputKey& inputKey);
+  /// Read the next record. Returns false at end of stream; throws
+  /// std::runtime_error on a truncated or malformed record (node ids out of
+  /// range, oversized tables or lengths, terminals wider than TermID), so
+  /// that the tree is valid even when finalize is compiled out.
+  static bool read(std::istream& in, Record& record);
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,227 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "SNLLogicDAG.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include "SNLTruthTableTree.h"
+#include "Tree2BoolExpr.h"
+
+// #define DEBUG_PRINTS
+
+#ifdef DEBUG_PRINTS
+#define DEBUG_LOG(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_LOG(fmt, ...)
+#endif
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+using namespace naja::NL;
+
+SNLLogicDAG::SNLLogicDAG(const std::vector<TermID>& PIs,
+                         const std::vector<TermID>& POs,
+                         const std::vector<VarID>& varNames,
+                         const DNLFaninGraph* graph)
+    : dnl_(*naja::DNL::get()),
+      PIs_(dnl_.getNBterms(), PIs),
+      POs_(POs),
+      varNames_(varNames),
+      graph_(graph) {
+  if (graph_ == nullptr) {
+    ownedGraph_ = std::make_unique<DNLFaninGraph>(dnl_);
+    graph_ = ownedGraph_.get();
+  }
+  driverIndex_ = std::vector<uint32_t>(dnl_.getNBterms(), kNoDriver);
+}
+
+DNLID SNLLogicDAG::getDriver(DNLID term) const {
+  const auto drivers = graph_->getDrivers(term);
+  if (drivers.size() != 1) {
+    // LCOV_EXCL_START
+    std::string termName =
+        dnl_.getDNLTerminalFromID(term).getSnlBitTerm()->getName().getString();
+    throw std::runtime_error("Iso of term '" + termName +
+                             "' does not have a single driver");
+    // LCOV_EXCL_STOP
+  }
+  return drivers.front();
+}
+
+DNLID SNLLogicDAG::resolve(DNLID term) const {
+  if (isInput(term)) {
+    return term;
+  }
+  return getDriver(term);
+}
+
+uint32_t SNLLogicDAG::addDriver(DNLID driver) {
+  assert(!isLeaf(driver));
+  if (driverIndex_[driver] == kNoDriver) {
+    driverIndex_[driver] = static_cast<uint32_t>(drivers_.size());
+    drivers_.push_back(driver);
+  }
+  return driverIndex_[driver];
+}
+
+std::shared_ptr<BoolExpr> SNLLogicDAG::sourceExpr(DNLID source) const {
+  if (!isLeaf(source)) {
+    assert(driverIndex_[source] != kNoDriver);
+    return exprs_[driverIndex_[source]];
+  }
+  if (isConstant(source)) {
+    return constants_->getValue(source) == DNLConstantPropagation::Value::One
+               ? BoolExpr::createTrue()
+               : BoolExpr::createFalse();
+  }
+  assert(source < varNames_.size());
+  const VarID var = varNames_[source];
+  if (var == kNoVarID) {
+    // LCOV_EXCL_START
+    throw std::runtime_error("Input variable index is SIZE_MAX");
+    // LCOV_EXCL_STOP
+  }
+  if (var == 0) {
+    return BoolExpr::createFalse();
+  } else if (var == 1) {
+    return BoolExpr::createTrue();
+  }
+  return BoolExpr::Var(var);
+}
+
+//----------------------------------------------------------------------
+// levelize: level 0 reads only PIs, level n reads level n-1 at most
+//----------------------------------------------------------------------
+void SNLLogicDAG::levelize() {
+  constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+  constexpr uint32_t kInProgress = std::numeric_limits<uint32_t>::max() - 1;
+  std::vector<uint32_t> levelOf(drivers_.size(), kUnvisited);
+  std::vector<std::pair<uint32_t, bool>> stack;
+  uint32_t numLevels = 0;
+  for (uint32_t seed = 0; seed < drivers_.size(); ++seed) {
+    if (levelOf[seed] != kUnvisited)
+      continue;
+    stack.emplace_back(seed, false);
+    while (!stack.empty()) {
+      auto [index, expanded] = stack.back();
+      stack.pop_back();
+      if (!expanded) {
+        if (levelOf[index] == kInProgress) {
+          // LCOV_EXCL_START
+          throw std::runtime_error("SNLLogicDAG: combinational loop detected");
+          // LCOV_EXCL_STOP
+        }
+        if (levelOf[index] != kUnvisited)
+          continue;
+        levelOf[index] = kInProgress;
+        stack.emplace_back(index, true);
+        for (size_t f = faninStart_[index]; f < faninStart_[index + 1]; ++f) {
+          if (!isLeaf(fanins_[f]))
+            stack.emplace_back(driverIndex_[fanins_[f]], false);
+        }
+        continue;
+      }
+      uint32_t level = 0;
+      for (size_t f = faninStart_[index]; f < faninStart_[index + 1]; ++f) {
+        if (!isLeaf(fanins_[f]))
+          level = std::max(level, levelOf[driverIndex_[fanins_[f]]] + 1);
+      }
+      levelOf[index] = level;
+      numLevels = std::max(numLevels, level + 1);
+    }
+  }
+  levels_.assign(numLevels, {});
+  for (uint32_t index = 0; index < drivers_.size(); ++index) {
+    levels_[levelOf[index]].push_back(index);
+  }
+}
+
+void SNLLogicDAG::compute() {
+  for (auto driver : drivers_) {
+    driverIndex_[driver] = kNoDriver;
+  }
+  drivers_.clear();
+  faninStart_.assign(1, 0);
+  fanins_.clear();
+  faninNegated_.clear();
+  std::vector<DNLID> poSources;
+  poSources.reserve(POs_.size());
+  for (auto po : POs_) {
+    DNLID driver = getDriver(po);
+    if (!isLeaf(driver)) {
+      addDriver(driver);
+    }
+    poSources.push_back(driver);
+  }
+
+  // Collect the fan-in of every driver; drivers_ grows while it is scanned,
+  // so each driver is expanded once and the CSR stays in index order.
+  // Buffers and inverters are skipped as in SNLLogicCloud: the fan-in is the
+  // cell behind them, with an inversion flag folded into the reader table.
+  for (size_t index = 0; index < drivers_.size(); ++index) {
+    for (DNLID termID : graph_->getDriverInputs(drivers_[index])) {
+      DNLID source = resolve(termID);
+      bool negated = false;
+      if (!isLeaf(source)) {
+        // stops at constants too, see SNLLogicCloud::compute
+        source = graph_->skipPassthrough(
+            source, negated, [this](DNLID term) { return isLeaf(term); });
+      }
+      if (!isLeaf(source)) {
+        addDriver(source);
+      }
+      fanins_.push_back(source);
+      faninNegated_.push_back(negated);
+    }
+    faninStart_.push_back(fanins_.size());
+    if (faninStart_[index + 1] - faninStart_[index] !=
+        graph_->getAttributes().getTruthTable(drivers_[index]).size()) {
+      // LCOV_EXCL_START
+      throw std::logic_error("SNLLogicDAG: fan-in does not match truth table");
+      // LCOV_EXCL_STOP
+    }
+  }
+  DEBUG_LOG("SNLLogicDAG: %zu drivers, %zu fan-in edges\n", drivers_.size(),
+            fanins_.size());
+
+  levelize();
+  DEBUG_LOG("SNLLogicDAG: %zu levels\n", levels_.size());
+
+  // One wave per level: every driver of a level only reads lower levels.
+  exprs_.assign(drivers_.size(), nullptr);
+  for (const auto& level : levels_) {
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, level.size()),
+        [&](const tbb::blocked_range<size_t>& r) {
+          std::vector<std::shared_ptr<BoolExpr>> inputs;
+          for (size_t i = r.begin(); i < r.end(); ++i) {
+            const uint32_t index = level[i];
+            inputs.clear();
+            for (size_t f = faninStart_[index]; f < faninStart_[index + 1];
+                 ++f) {
+              inputs.push_back(sourceExpr(fanins_[f]));
+            }
+            SNLTruthTable table =
+                graph_->getAttributes().getTruthTable(drivers_[index]);
+            for (size_t f = faninStart_[index]; f < faninStart_[index + 1];
+                 ++f) {
+              if (faninNegated_[f]) {
+                table = SNLTruthTableTree::negateInput(
+                    table, static_cast<uint32_t>(f - faninStart_[index]));
+              }
+            }
+            exprs_[index] = Tree2BoolExpr::convertTable(table, inputs);
+          }
+        });
+  }
+
+  poExprs_.clear();
+  poExprs_.reserve(POs_.size());
+  for (auto source : poSources) {
+    poExprs_.push_back(sourceExpr(source));
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "BoolExpr.h"
+#include "DNL.h"
+#include "DNLConstantPropagation.h"
+#include "DNLFaninGraph.h"
+#include "DNLTermSet.h"
+
+namespace KEPLER_FORMAL {
+
+/// Netlist-wide alternative to one SNLLogicCloud per PO: the combinational
+/// drivers in the fan-in of all POs are levelized once and each driver
+/// terminal is converted to a BoolExpr exactly once, level by level in
+/// parallel. Overlapping cones share their sub-expressions, so the work is
+/// linear in the netlist size instead of the sum of the cone sizes.
+///
+/// PIs and POs have the SNLLogicCloud meaning; varNames is indexed by term
+/// as for Tree2BoolExpr::convert (0/1 for constants). The conversion uses
+/// Tree2BoolExpr buffers, so compute must run inside a task arena. Without a
+/// fan-in graph the DAG builds its own.
+class SNLLogicDAG {
+ public:
+  SNLLogicDAG(const std::vector<TermID>& PIs,
+              const std::vector<TermID>& POs,
+              const std::vector<VarID>& varNames,
+              const DNLFaninGraph* graph = nullptr);
+
+  /// Stop at the drivers found constant by `constants`.
+  void setConstants(const DNLConstantPropagation* constants) {
+    constants_ = constants;
+  }
+  void compute();
+
+  /// Function of POs[index], valid after compute.
+  const std::shared_ptr<BoolExpr>& getPOExpr(size_t index) const {
+    return poExprs_[index];
+  }
+  size_t getNumDrivers() const { return drivers_.size(); }
+  size_t getNumLevels() const { return levels_.size(); }
+
+ private:
+  static constexpr uint32_t kNoDriver = std::numeric_limits<uint32_t>::max();
+
+  bool isInput(naja::DNL::DNLID term) const { return PIs_.contains(term); }
+  bool isConstant(naja::DNL::DNLID term) const {
+    return constants_ != nullptr && constants_->isConstant(term);
+  }
+  // PIs and constant drivers end the fan-in.
+  bool isLeaf(naja::DNL::DNLID term) const {
+    return isInput(term) || isConstant(term);
+  }
+  // Single driver of the iso of `term`.
+  naja::DNL::DNLID getDriver(naja::DNL::DNLID term) const;
+  // PI reached through `term`, or the driver terminal feeding it.
+  naja::DNL::DNLID resolve(naja::DNL::DNLID term) const;
+  // Index of a driver terminal, allocating it (and its fan-in) on first use.
+  uint32_t addDriver(naja::DNL::DNLID driver);
+  void levelize();
+  std::shared_ptr<BoolExpr> sourceExpr(naja::DNL::DNLID source) const;
+
+  const naja::DNL::DNLFull& dnl_;
+  DNLTermSet PIs_;
+  std::vector<TermID> POs_;
+  const std::vector<VarID>& varNames_;
+  std::unique_ptr<DNLFaninGraph> ownedGraph_;
+  const DNLFaninGraph* graph_;
+  const DNLConstantPropagation* constants_ = nullptr;
+
+  // Driver terminals in allocation order; fan-in in CSR form, each entry a
+  // PI or a driver terminal (buffers/inverters skipped), in the order of the
+  // model truth table inputs.
+  std::vector<TermID> drivers_;
+  std::vector<uint32_t> driverIndex_;  // term -> index in drivers_
+  std::vector<size_t> faninStart_;
+  std::vector<TermID> fanins_;
+  std::vector<bool> faninNegated_;  // fan-in read through an inverter chain
+  std::vector<std::vector<uint32_t>> levels_;
+  std::vector<std::shared_ptr<BoolExpr>> exprs_;
+  std::vector<std::shared_ptr<BoolExpr>> poExprs_;
+};
+
+}  // namespace KEPLER_FORMAL
@@ -4,6 +4,7 @@
 #include "SNLTruthTableTree.h"
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstdio>
 #include <limits>
@@ -11,6 +12,8 @@
 #include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
+#include "DNLTermAttributes.h"
+#include "NajaDynamicBitset.h"
 
 using namespace KEPLER_FORMAL;
 
@@ -54,8 +57,8 @@ SNLTruthTableTree::Node::Node(uint32_t idx, SNLTruthTableTree* t)
 }
 
 SNLTruthTableTree::Node::Node(SNLTruthTableTree* t,
-                              naja::DNL::DNLID instid,
-                              naja::DNL::DNLID term,
+                              TermID instid,
+                              TermID term,
                               Type type_)
     : type(type_),
       /*nodeID(0),*/ nodeID(SNLTruthTableTree::kInvalidId),
@@ -68,7 +71,9 @@ SNLTruthTableTree::Node::Node(SNLTruthTableTree* t,
   }
   if (tree)
     nodeID = (uint32_t)tree->lastID_++;
-  if (type == Type::Table) {
+  if (type == Type::Table && tree && tree->attributes_) {
+    truthTable = tree->attributes_->getTruthTable(data.termid);
+  } else if (type == Type::Table) {
     truthTable = SNLDesignModeling::getTruthTable(naja::DNL::get()
                                              ->getDNLTerminalFromID(data.termid)
                                              .getDNLInstance()
@@ -233,66 +238,6 @@ uint32_t SNLTruthTableTree::allocateNode(std::shared_ptr<Node>& np) {
   return id;
 }
 
-//----------------------------------------------------------------------
-// updateBorderLeaves
-//----------------------------------------------------------------------
-void SNLTruthTableTree::updateBorderLeaves() {
-  borderLeaves_.clear();
-  size_t externalIndex = 0;
-  if (rootId_ == kInvalidId)
-    return;
-  std::vector<uint32_t> stk;
-  stk.reserve(64);
-  stk.push_back(rootId_);
-  std::set<uint32_t> visited;
-  while (!stk.empty()) {
-    uint32_t nid = stk.back();
-    stk.pop_back();
-    if (visited.find(nid) != visited.end())
-      continue;
-    visited.insert(nid);
-    auto nsp = nodeFromId(nid);
-    if (!nsp)
-      assert(false && "updateBorderLeaves: null node in tree");
-    assert(nsp->childrenIds.size() > 0);
-    for (size_t i = 0; i < nsp->childrenIds.size(); ++i) {
-      uint32_t cid = nsp->childrenIds[i];
-      auto ch = nodeFromId(cid);
-      if (!ch)
-        assert(false && "updateBorderLeaves: null child node in tree");
-      if (ch->type == Node::Type::Input || ch->type == Node::Type::P) {
-        BorderLeaf bl;
-        if (ch->type == Node::Type::P) {
-          bl.parentId = cid;
-          bl.childPos = 0;
-        } else {
-          bl.parentId = (nid);
-          bl.childPos = i;
-        }
-        bl.extIndex = externalIndex;
-        DEBUG_LOG(
-            "updateBorderLeaves: found border leaf parentId=%u childPos=%zu "
-            "extIndex=%zu\n",
-            bl.parentId, bl.childPos, bl.extIndex);
-        externalIndex++;
-        borderLeaves_.push_back(bl);
-      } else {
-        stk.push_back(cid);
-      }
-    }
-  }
-  if (borderLeaves_.size() != numExternalInputs_) {
-    DEBUG_LOG(
-        "updateBorderLeaves: mismatch in border leaves count %zu vs "
-        "numExternalInputs %zu\n",
-        borderLeaves_.size(), numExternalInputs_);
-    assert(false && "border leaves count mismatch");
-  }
-  std::sort(
-      borderLeaves_.begin(), borderLeaves_.end(),
-      [](auto const& a, auto const& b) { return a.extIndex < b.extIndex; });
-}
-
 //----------------------------------------------------------------------
 // Constructors for tree
 //----------------------------------------------------------------------
@@ -301,19 +246,21 @@ SNLTruthTableTree::SNLTruthTableTree()
 
 SNLTruthTableTree::SNLTruthTableTree(naja::DNL::DNLID instid,
                                      naja::DNL::DNLID termid,
-                                     Node::Type type) {
-  auto rootNode = std::make_shared<Node>(this, instid, termid, type);
+                                     Node::Type type,
+                                     const DNLTermAttributes* attributes)
+    : attributes_(attributes) {
+  auto rootNode = newNode(this, toTermID(instid), toTermID(termid), type);
   uint32_t id = allocateNode(rootNode);
   rootId_ = id;
 
   if (type == Node::Type::P || type == Node::Type::Input) {
-    auto inNode = std::make_shared<Node>(0u, this);
+    auto inNode = newNode(0u, this);
     uint32_t inId = allocateNode(inNode);
     rootNode->childrenIds.push_back(inId);
     inNode->parentIds.push_back(rootId_);
     assert(inNode->parentIds.size() == 1);
+    // the leaf under a P root is closed: nothing to expand
     numExternalInputs_ = 1;
-    updateBorderLeaves();
     return;
   }
 
@@ -321,14 +268,59 @@ SNLTruthTableTree::SNLTruthTableTree(naja::DNL::DNLID instid,
 
   auto arity = table.size();
   for (uint32_t i = 0; i < arity; ++i) {
-    auto inNode = std::make_shared<Node>(i, this);
+    auto inNode = newNode(i, this);
     uint32_t inId = allocateNode(inNode);
     rootNode->childrenIds.push_back(inId);
     inNode->parentIds.push_back(rootId_);
     assert(inNode->parentIds.size() == 1);
+    borderLeaves_.push_back({rootId_, i, i});
   }
   numExternalInputs_ = arity;
-  updateBorderLeaves();
+}
+
+SNLTruthTableTree::SNLTruthTableTree(SNLTruthTableTree&& other) noexcept
+    : arena_(std::move(other.arena_)),
+      nodes_(std::move(other.nodes_)),
+      rootId_(other.rootId_),
+      numExternalInputs_(other.numExternalInputs_),
+      borderLeaves_(std::move(other.borderLeaves_)),
+      nextBorderLeaves_(std::move(other.nextBorderLeaves_)),
+      lastID_(other.lastID_),
+      numSplices_(other.numSplices_),
+      termid2nodeid_(std::move(other.termid2nodeid_)),
+      attributes_(other.attributes_) {
+  rebindNodes();
+  other.rootId_ = kInvalidId;
+  other.numExternalInputs_ = 0;
+}
+
+SNLTruthTableTree& SNLTruthTableTree::operator=(
+    SNLTruthTableTree&& other) noexcept {
+  if (this == &other)
+    return *this;
+  // the old nodes go before the arena holding them
+  nodes_ = std::move(other.nodes_);
+  arena_ = std::move(other.arena_);
+  rootId_ = other.rootId_;
+  numExternalInputs_ = other.numExternalInputs_;
+  borderLeaves_ = std::move(other.borderLeaves_);
+  nextBorderLeaves_ = std::move(other.nextBorderLeaves_);
+  lastID_ = other.lastID_;
+  numSplices_ = other.numSplices_;
+  termid2nodeid_ = std::move(other.termid2nodeid_);
+  attributes_ = other.attributes_;
+  rebindNodes();
+  other.rootId_ = kInvalidId;
+  other.numExternalInputs_ = 0;
+  return *this;
+}
+
+// Point every node back at this tree after a move.
+void SNLTruthTableTree::rebindNodes() {
+  for (auto& sp : nodes_) {
+    if (sp)
+      sp->tree = this;
+  }
 }
 
 //----------------------------------------------------------------------
@@ -358,8 +350,8 @@ bool SNLTruthTableTree::eval(const std::vector<bool>& extInputs) const {
 //----------------------------------------------------------------------
 const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
     size_t borderIndex,
-    naja::DNL::DNLID instid,
-    naja::DNL::DNLID termid) {
+    TermID instid,
+    TermID termid) {
   if (borderIndex >= borderLeaves_.size()) {
     // LCOV_EXCL_START
     throw std::out_of_range("concat: leafIndex out of range");
@@ -379,10 +371,9 @@ const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
 
   uint32_t arity = 1;
   std::shared_ptr<Node> newNodeSp;
-  if (instid != naja::DNL::DNLID_MAX) {
-    newNodeSp = std::make_shared<Node>(this, instid, termid, Node::Type::Table);
-    const auto& tbl = newNodeSp->getTruthTable();
-    arity = tbl.size();
+  if (instid != kNoTermID) {
+    // Look the term up before building a node: a reused node already has
+    // its table and children.
     auto iter = termid2nodeid_.find(termid);
     if (iter != termid2nodeid_.end()) {
       DEBUG_LOG(
@@ -415,9 +406,11 @@ const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
       }
       return *newNodeSp;
     }
+    newNodeSp = newNode(this, instid, termid, Node::Type::Table);
+    arity = newNodeSp->getTruthTable().size();
   } else {
     arity = 1;
-    newNodeSp = std::make_shared<Node>(this, instid, termid, Node::Type::P);
+    newNodeSp = newNode(this, instid, termid, Node::Type::P);
   }
 
   uint32_t newNodeId = allocateNode(newNodeSp);
@@ -429,10 +422,9 @@ const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
   if (oldChildSp) {
     assert(oldChildSp->type == Node::Type::Input);
     assert(oldChildSp->parentIds.size() == 1);
+    // the spliced leaf keeps its external slot
     oldChildSp->parentIds[0] = (newNodeId);
-    oldChildSp->data.inputIndex = numExternalInputs_;
-    numExternalInputs_++;
-    DEBUG_LOG("concating with inputIndex %zu\n", oldChildSp->data.inputIndex);
+    DEBUG_LOG("concating with inputIndex %u\n", oldChildSp->data.inputIndex);
   } else {
     // LCOV_EXCL_START
     throw std::logic_error("concat: null old child");
@@ -441,7 +433,7 @@ const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
 
   if (newNodeSp->type == Node::Type::Table) {
     for (uint32_t i = 1; i < arity; ++i) {
-      auto inNode = std::make_shared<Node>(numExternalInputs_, this);
+      auto inNode = newNode(numExternalInputs_, this);
       numExternalInputs_++;
       uint32_t inId = allocateNode(inNode);
       newNodeSp->childrenIds.push_back(inId);
@@ -468,10 +460,7 @@ const SNLTruthTableTree::Node& SNLTruthTableTree::concatBody(
 }
 
 void SNLTruthTableTree::concatFull(
-    const std::vector<
-        std::pair<naja::DNL::DNLID, naja::DNL::DNLID>,
-        tbb::tbb_allocator<std::pair<naja::DNL::DNLID, naja::DNL::DNLID>>>&
-        tables) {
+    const std::vector<Splice, tbb::tbb_allocator<Splice>>& tables) {
 #ifdef DEBUG_CHECKS
   // print tables
   DEBUG_LOG("Tables in concatFull:\n");
@@ -528,7 +517,7 @@ void SNLTruthTableTree::concatFull(
     BorderLeafInstances.insert(inst.getSNLInstance()->getID());
   }
   for (auto table : tables) {
-    if (table.first == naja::DNL::DNLID_MAX) {
+    if (table.first == kNoTermID) {
       // PI table, skip check
       continue;
     }
@@ -639,292 +628,78 @@ void SNLTruthTableTree::concatFull(
 #endif
   // FUNC START
 
-  std::vector<BorderLeaf, tbb::tbb_allocator<BorderLeaf>> newBorderLeaves;
-  size_t newInputs = 0;
-  size_t index = 0;
+  // One table per open border leaf. Newly created Table nodes contribute
+  // their Input children as the next open leaves, in child order; P nodes
+  // close their leaf and shared (already expanded) nodes contribute nothing.
+  // No tree traversal: cost is linear in the number of spliced nodes.
   assert(tables.size() == borderLeaves_.size());
-  numExternalInputs_ = 0;
+  numSplices_ += tables.size();
+  nextBorderLeaves_.clear();
   for (size_t i = 0; i < tables.size(); ++i) {
-    // For each entry in table to merge
-    assert(newBorderLeaves.size() == newInputs);
-    // Get the relevant border leaf based on order -> assuming identical order
-    // between tables and border leaves
-    const auto& borderLeaf = borderLeaves_[i];
-    // Get parent node of current border leaf
-    auto parentPtr = nodeFromId(borderLeaf.parentId);
-    // if (!parentPtr) {
-    //   // No parent so it is the root
-    //   index++;
-    //   newBorderLeaves.push_back(borderLeaf);
-    //   DEBUG_LOG("--- concatBody: null parent for border leaf index %zu\n",
-    //   index-1); newInputs += 1; assert(newBorderLeaves.size() == newInputs);
-    //   assert(rootId_ == borderLeaf.parentId && "concatFull: null parent is
-    //   not root"); continue;
-    // }
-    if (parentPtr->type == Node::Type::P) {
-      // If it is a PI border leaf, keep the same leaf and continue, no need to
-      // chain PIs
-      index++;
-      newBorderLeaves.push_back(borderLeaf);
-      DEBUG_LOG("--- concatBody: skipping PI border leaf index %zu\n",
-                index - 1);
-      newInputs += 1;
-      assert(newBorderLeaves.size() == newInputs);
+    const auto& n = concatBody(i, tables[i].first, tables[i].second);
+    if (n.type == Node::Type::P || n.parentIds.size() > 1) {
       continue;
     }
-    const auto& n = concatBody(index, tables[i].first, tables[i].second);
-    if (n.parentIds.size() <= 1 || n.type == Node::Type::P) {
-      // if new node is not reused, expand border leaves
-      DEBUG_LOG("ConcatBody expanding border leaf index %zu termid %zu %s %s\n",
-                index, tables[i].second,
-                naja::DNL::get()
-                    ->getDNLTerminalFromID(tables[i].second)
-                    .getSnlBitTerm()
-                    ->getName()
-                    .getString()
-                    .c_str(),
-                naja::DNL::get()
-                    ->getDNLTerminalFromID(tables[i].second)
-                    .getDNLInstance()
-                    .getSNLModel()
-                    ->getName()
-                    .getString()
-                    .c_str());
-      // Now we will create new border leaves for each input of the newly
-      // inserted node It is in the place of the original border leaf
-      uint32_t insertedId = parentPtr->childrenIds[borderLeaf.childPos];
-      // assert that insertedId is an input node
-      // assert(nodeFromId(insertedId)->type != Node::Type::Input &&
-      //  "concatFull: inserted node is input after concatBody");
-      auto insertedSp = nodeFromId(insertedId);
-      assert(insertedSp->type != Node::Type::Input &&
-             "concatFull: inserted node is input after concatBody");
-      // assert the input node have only one parent
-      assert(insertedSp->parentIds.size() == 1 &&
-             "concatFull: inserted node has multiple parents after concatBody");
-      if (!insertedSp) {
-        index++;
-        assert(false);
-      }
-      DEBUG_LOG("insertedSP %s\n",
-                naja::DNL::get()
-                    ->getDNLTerminalFromID(insertedSp->data.termid)
-                    .getSnlBitTerm()
-                    ->getName()
-                    .getString()
-                    .c_str());
-      DEBUG_LOG("children count: %zu\n", insertedSp->childrenIds.size());
-      // now next is to add border leaf on top of each input node of insertedSp
-      for (size_t j = 0; j < insertedSp->childrenIds.size(); ++j) {
-        uint32_t cid = insertedSp->childrenIds[j];
-
-        auto ch = nodeFromId(cid);
-        assert(ch);
-        // assert that cid is an input node
-        assert(ch->type == Node::Type::Input &&
-               "concatFull: inserted node child is not input after concatBody");
-
-        if (ch->type == Node::Type::Input) {
-          // Now concat a border leaf for this input
-          BorderLeaf bl;
-          bl.parentId = (insertedId);
-          bl.childPos = j;
-          bl.extIndex = ch->data.inputIndex;  // Set correctly in concatBody
-          newBorderLeaves.push_back(bl);
-          DEBUG_LOG(
-              "--- new border leaf extIndex %zu from inserted node id %u "
-              "childPos %zu\n",
-              bl.extIndex, insertedId, j);
-          DEBUG_LOG("--- %s %s\n",
-                    naja::DNL::get()
-                        ->getDNLTerminalFromID(insertedSp->data.termid)
-                        .getSnlBitTerm()
-                        ->getName()
-                        .getString()
-                        .c_str(),
-                    naja::DNL::get()
-                        ->getDNLTerminalFromID(insertedSp->data.termid)
-                        .getDNLInstance()
-                        .getSNLModel()
-                        ->getName()
-                        .getString()
-                        .c_str());
-          newInputs += 1;
-          assert(newBorderLeaves.size() == newInputs);
-        } else {
-          assert(false);
-        }
-      }
-    } else {
+    DEBUG_LOG("ConcatBody expanding border leaf index %zu termid %zu\n", i,
+              tables[i].second);
+    for (size_t j = 0; j < n.childrenIds.size(); ++j) {
+      const auto& ch = nodeFromId(n.childrenIds[j]);
+      assert(ch && ch->type == Node::Type::Input &&
+             "concatFull: inserted node child is not input after concatBody");
+      nextBorderLeaves_.push_back({n.nodeID, j, ch->data.inputIndex});
     }
-    index++;
   }
-  numExternalInputs_ = (size_t)newInputs;
-  borderLeaves_ = std::move(newBorderLeaves);
-  DEBUG_LOG("ConcatBody done, new numExternalInputs_: %zu\n",
-            numExternalInputs_);
+  borderLeaves_.swap(nextBorderLeaves_);
+  DEBUG_LOG("ConcatBody done, numExternalInputs_: %zu\n", numExternalInputs_);
   DEBUG_LOG("ConcatBody done, borderLeaves_ size: %zu\n", borderLeaves_.size());
-  // CHECKS
 
 #ifdef DEBUG_CHECKS
-  // count all inputs and pi nodes in the tree
-  std::stack<uint32_t> stk;
-  stk.push(rootId_);
-  std::set<uint32_t> inputs;
-  while (!stk.empty()) {
-    uint32_t nid = stk.top();
-    stk.pop();
-    auto nsp = nodeFromId(nid);
-    if (!nsp)
-      assert(false && "concatFull: null node in tree during input count");
-    for (size_t i = 0; i < nsp->childrenIds.size(); ++i) {
-      uint32_t cid = nsp->childrenIds[i];
-      auto ch = nodeFromId(cid);
-      if (!ch)
-        assert(false &&
-               "concatFull: null child node in tree during input count");
-      assert(std::find(ch->parentIds.begin(), ch->parentIds.end(), nid) !=
-                 ch->parentIds.end() &&
-             "concatFull: child missing parent link during input count");
-      assert(std::find(nsp->childrenIds.begin(), nsp->childrenIds.end(), cid) !=
-                 nsp->childrenIds.end() &&
-             "concatFull: parent missing child link during input count");
-      if (ch->type == Node::Type::Input || ch->type == Node::Type::P) {
-        inputs.insert(cid);
-      } else {
-        stk.push(cid);
-      }
-    }
-  }
-  DEBUG_LOG(
-      "concatFull: counted inputs %zu vs numExternalInputs_ %zu after "
-      "concatFull\n",
-      inputs.size(), numExternalInputs_);
-  assert((borderLeaves_.size() == numExternalInputs_) &&
-         "concatFull: border leaves count mismatch after concatFull");
-  for (const auto& bl : borderLeaves_) {
-    DEBUG_LOG("1  border leaf parentId %u childPos %zu extIndex %zu\n",
-              bl.parentId, bl.childPos, bl.extIndex);
-  }
-  assert(inputs.size() == numExternalInputs_ &&
-         "concatFull: counted inputs mismatch after concatFull");
-  // updateBorderLeaves(); <- not used as it changes the order and unsyncing the
-  // connection of tables and border leaves order
-  assert((borderLeaves_.size() == numExternalInputs_) &&
-         "concatFull: border leaves count mismatch after concatFull");
-  assert(inputs.size() == numExternalInputs_ &&
-         "concatFull: counted inputs mismatch after concatFull");
   for (const auto& bl : borderLeaves_) {
-    DEBUG_LOG("2  border leaf parentId %u childPos %zu extIndex %zu\n",
-              bl.parentId, bl.childPos, bl.extIndex);
+    auto parentPtr = nodeFromId(bl.parentId);
+    assert(parentPtr && parentPtr->type == Node::Type::Table &&
+           "concatFull: border leaf parent is not a table after concatFull");
+    auto ch = nodeFromId(parentPtr->childrenIds[bl.childPos]);
+    assert(ch && ch->type == Node::Type::Input &&
+           "concatFull: border leaf is not an input after concatFull");
+    assert(ch->data.inputIndex == bl.extIndex &&
+           bl.extIndex < numExternalInputs_ &&
+           "concatFull: border leaf external index is stale");
   }
+#endif
+}
 
-  // assert all new border leaves are in table and in the right order
-  size_t order = 0;
-  DEBUG_LOG("@@ Border leaves size after concatFull: %zu\n",
-            borderLeaves_.size());
-  for (size_t i = 0; i < borderLeaves_.size(); ++i) {
-    DEBUG_LOG("node id %u border leaf %zu extIndex %zu\n",
-              borderLeaves_[i].parentId, i, borderLeaves_[i].extIndex);
-    assert(nodeFromId(borderLeaves_[i].parentId) &&
-           "concatFull: null border leaf parent after concatFull");
-    // assert that node is not an input
-    assert(nodeFromId(borderLeaves_[i].parentId)->type != Node::Type::Input &&
-           "concatFull: border leaf parent is input after concatFull");
-    naja::DNL::DNLID termid =
-        naja::DNL::get()
-            ->getDNLTerminalFromID(
-                nodeFromId(borderLeaves_[i].parentId)->data.termid)
-            .getID();
-    size_t newOrder = 0;
-    DEBUG_LOG("border leaf %zu termid %zu %s %s\n", i, termid,
-              naja::DNL::get()
-                  ->getDNLTerminalFromID(termid)
-                  .getSnlBitTerm()
-                  ->getName()
-                  .getString()
-                  .c_str(),
-              naja::DNL::get()
-                  ->getDNLTerminalFromID(termid)
-                  .getDNLInstance()
-                  .getSNLModel()
-                  ->getName()
-                  .getString()
-                  .c_str());
-    bool PI = false;
-    for (size_t j = 0; j < tables.size(); ++j) {
-      if (tables[j].first == naja::DNL::DNLID_MAX) {
-        // PI table
-        PI = true;
-      }
-      if (tables[j].second == termid) {
-        newOrder = j;
-        break;
-      }
-    }
-    if (PI) {
-      // skip PI tables in order check
-      continue;
-    }
-    if (newOrder == 0) {
-      if (nodeFromId(borderLeaves_[i].parentId)->parentIds.size() > 1) {
-        // reused node, skip
-        continue;
-      }
-    }
-    DEBUG_LOG("newOrder %zu order %zu\n", newOrder, order);
-    assert(newOrder >= order &&
-           "concatFull: border leaves out of order after concatFull");
-    if (order < newOrder) {
-      order = newOrder;
+//----------------------------------------------------------------------
+// negateBorderInput: fold an inverter into the parent table
+//----------------------------------------------------------------------
+SNLTruthTable SNLTruthTableTree::negateInput(const SNLTruthTable& table,
+                                             uint32_t input) {
+  const uint32_t arity = table.size();
+  const uint64_t flip = uint64_t{1} << input;
+  const uint64_t rows = uint64_t{1} << arity;
+  if (arity <= 6) {
+    uint64_t mask = 0;
+    for (uint64_t m = 0; m < rows; ++m) {
+      if (table.bits().bit(m ^ flip))
+        mask |= uint64_t{1} << m;
     }
+    return SNLTruthTable(arity, mask);
   }
-  for (const auto& pair : tables) {
-    naja::DNL::DNLID termid = pair.second;
-    bool found = false;
-    for (size_t i = 0; i < borderLeaves_.size(); ++i) {
-      naja::DNL::DNLID btermid =
-          naja::DNL::get()
-              ->getDNLTerminalFromID(
-                  nodeFromId(borderLeaves_[i].parentId)->data.termid)
-              .getID();
-      if (btermid == termid) {
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
-      DEBUG_LOG(
-          "concatFull: table termid %zu %s %s not found in border leaves after "
-          "concatFull\n",
-          termid,
-          naja::DNL::get()
-              ->getDNLTerminalFromID(termid)
-              .getSnlBitTerm()
-              ->getName()
-              .getString()
-              .c_str(),
-          naja::DNL::get()
-              ->getDNLTerminalFromID(termid)
-              .getDNLInstance()
-              .getSNLModel()
-              ->getName()
-              .getString()
-              .c_str());
-      if (termid2nodeid_.find(termid) != termid2nodeid_.end()) {
-        DEBUG_LOG("  termid %zu exists in termid2nodeid_\n", termid);
-      } else {
-        assert(false &&
-               "concatFull: table not found in border leaves after concatFull");
-      }
-    }
+  naja::NajaDynamicBitset bits(rows);
+  for (uint64_t m = 0; m < rows; ++m) {
+    if (table.bits().bit(m ^ flip))
+      bits.set(m, true);
   }
-#endif
+  return SNLTruthTable(arity, bits);
+}
+
+void SNLTruthTableTree::negateBorderInput(size_t borderIndex) {
+  assert(borderIndex < borderLeaves_.size());
+  const BorderLeaf& bl = borderLeaves_[borderIndex];
+  Node& parent = *nodeFromId(bl.parentId);
+  parent.truthTable = negateInput(parent.getTruthTable(),
+                                  static_cast<uint32_t>(bl.childPos));
 }
 
-//----------------------------------------------------------------------
-// isInitialized / print
-//----------------------------------------------------------------------
 bool SNLTruthTableTree::isInitialized() const {
   if (rootId_ == kInvalidId)
     return false;
@@ -996,208 +771,316 @@ void SNLTruthTableTree::print() const {
 //----------------------------------------------------------------------
 void SNLTruthTableTree::destroy() {
   nodes_.clear();
+  if (arena_) {
+    arena_->release();
+  }
   rootId_ = kInvalidId;
   borderLeaves_.clear();
+  termid2nodeid_.clear();
   numExternalInputs_ = 0;
+  numSplices_ = 0;
 }
 
 //----------------------------------------------------------------------
-// finalize: repair and validation after construction
+// finalize: linear validation of the by-construction invariants
 //----------------------------------------------------------------------
 void SNLTruthTableTree::finalize() {
-  // Build resolver maps for existing nodes based on current fields.
-  // We accept that builders may have used:
-  //  - correct nodeID values (index+kIdOffset)
-  //  - debug nodeID values (node->nodeID)
-  //  - temporary or precomputed ids (which may be wrong)
-  //
-  // Strategy:
-  // 1) Create maps: by current nodeID (if valid), by nodeID (debug), and by
-  // slot index. 2) For each node, resolve each childrenIds entry by attempting:
-  //      a) match by nodeID (fast)
-  //      b) match by nodeID (fallback)
-  //      c) interpret as index (cid - kIdOffset) within range
-  //    If resolved, record target shared_ptr.
-  // 3) After all children resolved, rebuild nodes_ canonical ordering (keep
-  // existing order),
-  //    set node->nodeID = index + kIdOffset, set node->tree = this, and replace
-  //    childrenIds with canonical ids derived from the resolved shared_ptrs.
-  //
-  // This repairs common builder mistakes without requiring edits in builder
-  // code.
-
-  // Step 0: quick sanity for root
-  if (rootId_ == kInvalidId && nodes_.empty())
-    return;
-
-  // Build lookup maps
-  std::unordered_map<uint32_t, std::shared_ptr<Node>> mapById;
-  std::unordered_map<uint32_t, std::shared_ptr<Node>> mapByNodeID;
-  mapById.reserve(nodes_.size() * 2);
-  mapByNodeID.reserve(nodes_.size() * 2);
-
-  for (size_t i = 0; i < nodes_.size(); ++i) {
-    auto sp = nodes_[i];
-    if (!sp)
-      continue;
-    if (sp->nodeID != kInvalidId)
-      mapById[sp->nodeID] = sp;
-    if (sp->nodeID != 0)
-      mapByNodeID[sp->nodeID] = sp;
+#ifndef NDEBUG
+  if (rootId_ != kInvalidId && !nodeFromId(rootId_)) {
+    // LCOV_EXCL_START
+    throw std::logic_error("finalize: dangling root id");
+    // LCOV_EXCL_STOP
   }
-
-  // Resolve children entries to shared_ptrs for every node
-  std::vector<std::vector<std::shared_ptr<Node>>> resolvedChildren(
-      nodes_.size());
   for (size_t i = 0; i < nodes_.size(); ++i) {
-    auto sp = nodes_[i];
-    if (!sp)
-      continue;
-    resolvedChildren[i].reserve(sp->childrenIds.size());
-    for (size_t j = 0; j < sp->childrenIds.size(); ++j) {
-      uint32_t cid = sp->childrenIds[j];
-      std::shared_ptr<Node> target;
-
-      // try match by exact nodeID
-      auto it = mapById.find(cid);
-      if (it != mapById.end())
-        target = it->second;
-      // fallback: match by debug nodeID
-      if (!target) {
-        auto it2 = mapByNodeID.find(cid);
-        if (it2 != mapByNodeID.end())
-          target = it2->second;
-      }
-      // fallback: interpret as index (cid - kIdOffset)
-      if (!target) {
-        if (cid >= kIdOffset) {
-          size_t idx = (size_t)(cid - kIdOffset);
-          if (idx < nodes_.size()) {
-            target = nodes_[idx];
-          }
-        }
-      }
-      if (!target) {
+    const auto& sp = nodes_[i];
+    if (!sp || sp->nodeID != static_cast<uint32_t>(i) + kIdOffset ||
+        sp->tree != this) {
+      // LCOV_EXCL_START
+      fprintf(stderr, "finalize: node in slot %zu is not canonical\n", i);
+      throw std::logic_error("finalize: non-canonical node id");
+      // LCOV_EXCL_STOP
+    }
+    if (sp->type == Node::Type::Input && !sp->childrenIds.empty()) {
+      // LCOV_EXCL_START
+      throw std::logic_error("finalize: Input node with children");
+      // LCOV_EXCL_STOP
+    }
+    for (uint32_t cid : sp->childrenIds) {
+      const auto& ch = nodeFromId(cid);
+      // Every child must know its parent; orphaned leaves left behind by
+      // node reuse are never reached from a parent and are not checked.
+      if (!ch || std::find(ch->parentIds.begin(), ch->parentIds.end(),
+                           sp->nodeID) == ch->parentIds.end()) {
         // LCOV_EXCL_START
-        // cannot resolve child id: report and abort
         fprintf(stderr,
-                "finalize: could not resolve child reference: parent_slot=%zu "
-                "parent_assigned_id=%u childPos=%zu childId=%u nodes=%zu\n",
-                i, sp->nodeID, j, cid, nodes_.size());
+                "finalize: unresolved child reference: parent_slot=%zu "
+                "childId=%u nodes=%zu\n",
+                i, cid, nodes_.size());
         throw std::logic_error("finalize: unresolved child id");
         // LCOV_EXCL_STOP
       }
-      resolvedChildren[i].push_back(target);
     }
   }
-
-  // Now assign canonical ids and remap childrenIds/parentId
-  for (size_t i = 0; i < nodes_.size(); ++i) {
-    uint32_t canonicalId = static_cast<uint32_t>(i) + kIdOffset;
-    auto sp = nodes_[i];
-    sp->nodeID = canonicalId;
-    sp->tree = this;
+  for (const auto& bl : borderLeaves_) {
+    const auto& parent = nodeFromId(bl.parentId);
+    if (!parent || parent->type != Node::Type::Table ||
+        bl.childPos >= parent->childrenIds.size() ||
+        nodeFromId(parent->childrenIds[bl.childPos])->type !=
+            Node::Type::Input) {
+      // LCOV_EXCL_START
+      throw std::logic_error("finalize: stale border leaf");
+      // LCOV_EXCL_STOP
+    }
   }
+#endif
+}
 
-  // Build reverse map from shared_ptr pointer (address) to canonical id
-  std::unordered_map<const Node*, uint32_t> ptrToId;
-  ptrToId.reserve(nodes_.size() * 2);
-  for (size_t i = 0; i < nodes_.size(); ++i) {
-    auto sp = nodes_[i];
-    if (!sp)
-      continue;
-    ptrToId[sp.get()] = static_cast<uint32_t>(i) + kIdOffset;
+//----------------------------------------------------------------------
+// collapse: merge small Table subtrees into composite tables
+//----------------------------------------------------------------------
+namespace {
+
+// Rows of the first six variables within one 64-row word.
+constexpr uint64_t kVarMask[6] = {
+    0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+    0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL};
+
+size_t rowWords(size_t k) {
+  return k <= 6 ? 1 : size_t{1} << (k - 6);
+}
+
+// Truth table of variable j among k variables, 64 rows per word.
+void projection(size_t j, size_t k, uint64_t* out) {
+  for (size_t w = 0; w < rowWords(k); ++w) {
+    out[w] = j < 6 ? kVarMask[j]
+                   : (((w >> (j - 6)) & 1u) ? ~uint64_t{0} : uint64_t{0});
   }
+}
 
-  // Replace childrenIds with canonical ids and set parentId accordingly
-  for (size_t i = 0; i < nodes_.size(); ++i) {
-    auto sp = nodes_[i];
-    sp->childrenIds.clear();
-    sp->childrenIds.reserve(resolvedChildren[i].size());
-    for (size_t j = 0; j < resolvedChildren[i].size(); ++j) {
-      auto targ = resolvedChildren[i][j];
-      auto it = ptrToId.find(targ.get());
-      if (it == ptrToId.end()) {
-        // LCOV_EXCL_START
-        fprintf(stderr,
-                "finalize: internal error mapping ptr->id parent_slot=%zu "
-                "childPos=%zu\n",
-                i, j);
-        throw std::logic_error("finalize: internal mapping failed");
-        // LCOV_EXCL_STOP
-      }
-      uint32_t newCid = it->second;
-      sp->childrenIds.push_back(newCid);
-      // set child's parentId; last writer wins (ok for tree)
-      auto childSp = targ;
-      // replace the slot in the index that contain the value i in parentIds
-      // with the sp->nodeID
-      auto iter = std::find(childSp->parentIds.begin(),
-                            childSp->parentIds.end(), sp->nodeID);
-      if (iter != childSp->parentIds.end()) {
-        *iter = sp->nodeID;
-      } else {
-        // LCOV_EXCL_START
-        throw std::logic_error("finalize: parentIds inconsistent");
-        // LCOV_EXCL_STOP
-      }
+// Evaluate tbl on input words with a mux tree fold over the table rows.
+void compose(const SNLTruthTable& tbl,
+             const std::vector<const uint64_t*>& in,
+             size_t numWords,
+             uint64_t* out,
+             std::vector<uint64_t>& scratch) {
+  const uint32_t arity = tbl.size();
+  auto rowMask = [&tbl](uint64_t m) -> uint64_t {
+    return tbl.bits().bit(m) ? ~uint64_t{0} : uint64_t{0};
+  };
+  if (arity == 0) {
+    std::fill(out, out + numWords, rowMask(0));
+    return;
+  }
+  const size_t half = size_t{1} << (arity - 1);
+  scratch.resize(half);
+  for (size_t w = 0; w < numWords; ++w) {
+    const uint64_t x0 = in[0][w];
+    size_t width = half;
+    for (size_t m = 0; m < width; ++m)
+      scratch[m] = (x0 & rowMask(2 * m + 1)) | (~x0 & rowMask(2 * m));
+    for (uint32_t j = 1; j < arity; ++j) {
+      const uint64_t x = in[j][w];
+      width >>= 1;
+      for (size_t m = 0; m < width; ++m)
+        scratch[m] = (x & scratch[2 * m + 1]) | (~x & scratch[2 * m]);
     }
+    out[w] = scratch[0];
   }
+}
+
+void eraseOne(SmallIdVector& ids, uint32_t id) {
+  auto it = std::find(ids.begin(), ids.end(), id);
+  if (it != ids.end())
+    ids.erase(it);
+}
+
+}  // namespace
+
+size_t SNLTruthTableTree::collapse(uint32_t maxInputs,
+                                   uint32_t maxWideInputs,
+                                   size_t wideBudget) {
+  const auto& root = nodeFromId(rootId_);
+  if (!root)
+    return 0;
+  maxWideInputs = std::max(maxWideInputs, maxInputs);
+  const size_t n = nodes_.size();
+  auto slotOf = [](uint32_t id) { return (size_t)(id - kIdOffset); };
 
-  // Recompute rootId_: if existing rootId_ was resolvable, remap it; otherwise
-  // try to keep slot 0
-  if (rootId_ != kInvalidId) {
-    // try to remap previous rootId_ by matching to new canonical id via
-    // mapById/mapByNodeID/slot heuristic
-    uint32_t newRoot = kInvalidId;
-    auto itRoot = mapById.find(rootId_);
-    if (itRoot != mapById.end()) {
-      auto sp = itRoot->second;
-      auto pit = ptrToId.find(sp.get());
-      if (pit != ptrToId.end())
-        newRoot = pit->second;
+  // allocateNode only shares Table nodes: the P nodes of one terminal are a
+  // single leaf, keyed by the first of them reached.
+  std::unordered_map<TermID, uint32_t> pOfTerm;
+  auto canon = [&](uint32_t id) {
+    const auto& sp = nodes_[slotOf(id)];
+    if (sp->type != Node::Type::P)
+      return id;
+    return pOfTerm.try_emplace(sp->data.termid, id).first->second;
+  };
+
+  // Phase 1 (post-order): distinct leaves of every Table node, looking
+  // through the Table children it could absorb. A child is absorbable when
+  // it is a Table with a single parent whose own leaves fit.
+  std::vector<std::vector<uint32_t>> leaves(n);
+  std::vector<bool> fits(n, false);
+  std::vector<uint8_t> state(n, 0);  // 0 new, 1 open, 2 done
+  std::vector<uint32_t> order;
+  auto absorbable = [&](uint32_t cid) {
+    const auto& c = nodes_[slotOf(cid)];
+    return c->type == Node::Type::Table && c->parentIds.size() == 1 &&
+           fits[slotOf(cid)];
+  };
+  std::vector<std::pair<uint32_t, bool>> stk;
+  stk.emplace_back(rootId_, false);
+  while (!stk.empty()) {
+    auto [id, expanded] = stk.back();
+    stk.pop_back();
+    const size_t slot = slotOf(id);
+    const auto& sp = nodes_[slot];
+    if (sp->type != Node::Type::Table)
+      continue;
+    if (!expanded) {
+      if (state[slot] != 0)
+        continue;
+      state[slot] = 1;
+      stk.emplace_back(id, true);
+      for (auto cid : sp->childrenIds)
+        stk.emplace_back(cid, false);
+      continue;
     }
-    if (newRoot == kInvalidId) {
-      // fallback: if nodes_[0] exists, use that
-      if (!nodes_.empty() && nodes_[0])
-        newRoot = nodes_[0]->nodeID;
+    state[slot] = 2;
+    order.push_back(id);
+    auto& mine = leaves[slot];
+    bool ok = true;
+    auto addLeaf = [&](uint32_t lid) {
+      if (std::find(mine.begin(), mine.end(), lid) == mine.end())
+        mine.push_back(lid);
+      ok = ok && mine.size() <= maxWideInputs;
+    };
+    for (auto cid : sp->childrenIds) {
+      if (absorbable(cid)) {
+        for (auto lid : leaves[slotOf(cid)])
+          addLeaf(lid);
+      } else {
+        addLeaf(canon(cid));
+      }
+      if (!ok)
+        break;
     }
-    rootId_ = newRoot;
+    fits[slot] = ok;
+    if (!ok)
+      mine.clear();
   }
 
-  // Recompute numExternalInputs_ by scanning leaves
-  size_t maxInput = 0;
-  numExternalInputs_ = 0;
-  bool anyInput = false;
-  std::vector<uint32_t> stk;
-  if (rootId_ != kInvalidId)
-    stk.push_back(rootId_);
-  std::set<uint32_t> visited;
-  while (!stk.empty()) {
-    uint32_t nid = stk.back();
-    stk.pop_back();
-    if (visited.count(nid))
+  // Phase 2 (parents first): collapse each maximal fitting subtree that is
+  // not already absorbed by its parent.
+  size_t absorbedCount = 0;
+  std::vector<bool> absorbed(n, false);
+  std::vector<uint32_t> region;
+  std::vector<uint32_t> regionPos(n, kInvalidId);
+  std::vector<uint64_t> words;
+  std::vector<uint64_t> scratch;
+  std::vector<const uint64_t*> inputs;
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    const uint32_t rid = *it;
+    const size_t rslot = slotOf(rid);
+    if (absorbed[rslot] || !fits[rslot])
       continue;
-    visited.insert(nid);
-    auto n = nodeFromId(nid);
-    if (!n)
+    const auto& rsp = nodes_[rslot];
+    if (std::none_of(rsp->childrenIds.begin(), rsp->childrenIds.end(),
+                     absorbable))
       continue;
-    for (size_t k = 0; k < n->childrenIds.size(); ++k) {
-      uint32_t cid = n->childrenIds[k];
-      auto ch = nodeFromId(cid);
-      if (!ch)
+
+    // Absorbed region in post-order; single parents make it a tree.
+    region.clear();
+    stk.clear();
+    stk.emplace_back(rid, false);
+    while (!stk.empty()) {
+      auto [id, expanded] = stk.back();
+      stk.pop_back();
+      if (expanded) {
+        regionPos[slotOf(id)] = static_cast<uint32_t>(region.size());
+        region.push_back(id);
         continue;
-      if (ch->type == Node::Type::Input || ch->type == Node::Type::P) {
-        anyInput = true;
-        // if (ch->data.inputIndex > maxInput) maxInput = ch->data.inputIndex;
-        numExternalInputs_++;
+      }
+      stk.emplace_back(id, true);
+      for (auto cid : nodes_[slotOf(id)]->childrenIds) {
+        if (absorbable(cid))
+          stk.emplace_back(cid, false);
+      }
+    }
+
+    // Leaf projections first, then one row block per region node.
+    const auto& rleaves = leaves[rslot];
+    const size_t k = rleaves.size();
+    const size_t numWords = rowWords(k);
+    words.assign((k + region.size()) * numWords, 0);
+    for (size_t j = 0; j < k; ++j)
+      projection(j, k, words.data() + j * numWords);
+    auto wordsOf = [&](uint32_t cid) -> const uint64_t* {
+      if (regionPos[slotOf(cid)] != kInvalidId)
+        return words.data() + (k + regionPos[slotOf(cid)]) * numWords;
+      size_t j = std::find(rleaves.begin(), rleaves.end(), canon(cid)) -
+                 rleaves.begin();
+      assert(j < k);
+      return words.data() + j * numWords;
+    };
+    for (size_t r = 0; r < region.size(); ++r) {
+      const auto& sp = nodes_[slotOf(region[r])];
+      inputs.clear();
+      for (auto cid : sp->childrenIds)
+        inputs.push_back(wordsOf(cid));
+      compose(sp->getTruthTable(), inputs, numWords,
+              words.data() + (k + r) * numWords, scratch);
+    }
+    const uint64_t* result = words.data() + (k + region.size() - 1) * numWords;
+    const uint64_t rows = uint64_t{1} << k;
+    const uint64_t lastMask =
+        rows >= 64 ? ~uint64_t{0} : ((uint64_t{1} << rows) - 1);
+
+    // Tree2BoolExpr expands a table into one cube per on-set row: keep the
+    // composite only when that does not grow past the absorbed tables.
+    size_t onSet = 0;
+    for (size_t w = 0; w < numWords; ++w)
+      onSet += std::popcount(w + 1 == numWords ? result[w] & lastMask
+                                               : result[w]);
+    size_t regionCost = 0;
+    for (auto id : region) {
+      const auto& tbl = nodes_[slotOf(id)]->getTruthTable();
+      for (uint64_t m = 0; m < (uint64_t{1} << tbl.size()); ++m)
+        regionCost += tbl.bits().bit(m) ? tbl.size() : 0;
+    }
+    bool accept = onSet * k <= regionCost &&
+                  (k <= maxInputs || onSet * k <= wideBudget);
+    if (accept) {
+      SNLTruthTable composite;
+      if (k <= 6) {
+        composite = SNLTruthTable(k, result[0] & lastMask);
       } else {
-        stk.push_back(cid);
+        naja::NajaDynamicBitset bits(rows);
+        for (uint64_t m = 0; m < rows; ++m) {
+          if ((result[m / 64] >> (m % 64)) & 1u)
+            bits.set(m, true);
+        }
+        composite = SNLTruthTable(k, bits);
+      }
+      // Detach the absorbed nodes, then rewire the root to the leaves.
+      for (size_t r = 0; r + 1 < region.size(); ++r) {
+        const auto& sp = nodes_[slotOf(region[r])];
+        for (auto cid : sp->childrenIds)
+          eraseOne(nodes_[slotOf(cid)]->parentIds, sp->nodeID);
+        sp->childrenIds.clear();
+        sp->parentIds.clear();
+        absorbed[slotOf(region[r])] = true;
       }
+      for (auto cid : rsp->childrenIds)
+        eraseOne(nodes_[slotOf(cid)]->parentIds, rid);
+      rsp->childrenIds.assign(rleaves.begin(), rleaves.end());
+      for (auto lid : rleaves)
+        nodes_[slotOf(lid)]->parentIds.push_back(rid);
+      rsp->truthTable = composite;
+      absorbedCount += region.size() - 1;
     }
+    for (auto id : region)
+      regionPos[slotOf(id)] = kInvalidId;
   }
-  // if (anyInput) numExternalInputs_ = maxInput + 1;
-  // else numExternalInputs_ = 0;
-
-  updateBorderLeaves();
+  return absorbedCount;
 }
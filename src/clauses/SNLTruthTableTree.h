@@ -7,6 +7,7 @@
 #include "SNLTruthTable.h"
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -15,9 +16,13 @@
 #include <unordered_set>
 #include "DNL.h"
 #include "SNLDesignModeling.h"
+#include "SmallIdVector.h"
+#include "TermID.h"
 
 namespace KEPLER_FORMAL {
 
+class DNLTermAttributes;
+
 // Compact id-based truth-table tree (no pointer mirrors)
 class SNLTruthTableTree {
 public:
@@ -25,27 +30,27 @@ public:
     // group 32-bit scalars first
   uint32_t nodeID   = std::numeric_limits<uint32_t>::max();
   //uint32_t parentId = std::numeric_limits<uint32_t>::max();
-  std::vector<uint32_t, tbb::tbb_allocator<uint32_t>> parentIds; // for multiple parents support
+  SmallIdVector parentIds; // for multiple parents support
 
-  // put the 64-bit-aligned items next: union with 64-bit termid,
+  // union with the terminal handle (32-bit unless KEPLER_64BIT_TERM_IDS),
   // then pointer and std::vector (both require 8-byte alignment)
   union {
     uint32_t inputIndex;
-    naja::DNL::DNLID termid; // 64-bit
+    TermID termid;
   } data;
 
   SNLTruthTable truthTable; 
 
   SNLTruthTableTree* tree = nullptr; // 8 bytes
-  std::vector<uint32_t, tbb::tbb_allocator<uint32_t>> childrenIds; // typically 24 bytes on LP64
+  SmallIdVector childrenIds; // up to 4 ids inline
 
   // small discriminator last to avoid introducing padding between large fields
   enum class Type : uint8_t { Input = 0, Table = 1, P = 2 } type = Type::Table;
 
     explicit Node(uint32_t idx, SNLTruthTableTree* t);
     Node(SNLTruthTableTree* t,
-         naja::DNL::DNLID instid,
-         naja::DNL::DNLID term,
+         TermID instid,
+         TermID term,
          Type type_ = Type::Table);
 
     Node(const Node& other) = delete;
@@ -62,8 +67,22 @@ public:
   static constexpr uint32_t kInvalidId = std::numeric_limits<uint32_t>::max();
 
   SNLTruthTableTree();
-  SNLTruthTableTree(naja::DNL::DNLID instid, naja::DNL::DNLID termid, Node::Type type = Node::Type::Table);
-
+  // With `attributes`, Table nodes take their truth table from it instead of
+  // walking the global DNL; it must outlive the expansion of the tree.
+  SNLTruthTableTree(naja::DNL::DNLID instid,
+                    naja::DNL::DNLID termid,
+                    Node::Type type = Node::Type::Table,
+                    const DNLTermAttributes* attributes = nullptr);
+  // Nodes point back to their owning tree, so a tree can be moved (the nodes
+  // are rebound to the new owner) but not copied.
+  SNLTruthTableTree(SNLTruthTableTree&& other) noexcept;
+  SNLTruthTableTree& operator=(SNLTruthTableTree&& other) noexcept;
+  SNLTruthTableTree(const SNLTruthTableTree&) = delete;
+  SNLTruthTableTree& operator=(const SNLTruthTableTree&) = delete;
+
+  // Number of external input slots. Slots are assigned once, when an Input
+  // node is created, and never renumbered; a slot whose Input was absorbed by
+  // an already expanded (shared) node stays unused.
   size_t size() const;
   bool eval(const std::vector<bool>& extInputs) const;
 
@@ -71,8 +90,19 @@ public:
               naja::DNL::DNLID instid,
               naja::DNL::DNLID termid);
 
-  void concatFull(const std::vector<std::pair<naja::DNL::DNLID, naja::DNL::DNLID>,
-            tbb::tbb_allocator<std::pair<naja::DNL::DNLID, naja::DNL::DNLID>>>& tables);
+  // One (instance, driver) per open border leaf, instance kNoTermID for a
+  // P leaf (PI, constant or cached driver).
+  using Splice = std::pair<TermID, TermID>;
+  void concatFull(
+      const std::vector<Splice, tbb::tbb_allocator<Splice>>& tables);
+
+  // Complement the input of the Table node that owns open border leaf
+  // borderIndex (its truth table rows are swapped along that input), so the
+  // leaf can be expanded with the driver found behind an inverter. Must be
+  // called before the concatFull that closes the leaf.
+  void negateBorderInput(size_t borderIndex);
+  // `table` with input `input` complemented.
+  static SNLTruthTable negateInput(const SNLTruthTable& table, uint32_t input);
 
   uint32_t getRootId() const { return rootId_; }
   const std::shared_ptr<Node>& getRootShared() const { return nodeFromId(rootId_); }
@@ -81,43 +111,94 @@ public:
   const std::shared_ptr<Node>& nodeFromId(uint32_t id) const;
   bool isInitialized() const;
   void print() const;
+  // Drop all the nodes and release the node arena in bulk. Node pointers
+  // taken from the tree must not outlive destroy() or the tree.
   void destroy();
 
   size_t getNumNodes() const { return nodes_.size(); }
+  // Number of open border leaves, i.e. the number of entries the next
+  // concatFull call expects.
+  size_t getNumBorderLeaves() const { return borderLeaves_.size(); }
+  // Border leaves closed by all the concatFull calls so far, i.e. the
+  // expansion work of the cone build (linear in the cone size).
+  size_t getNumSplices() const { return numSplices_; }
 
   // allocateNode guarantees id assignment before publishing node in nodes_
   uint32_t allocateNode(std::shared_ptr<Node>& np);
 
-  // finalize repairs and validates the tree; must be called once after build and before traversal
-  // It will remap children/parent ids to canonical ids and throw on unresolved references
+  // Node ids are canonical by construction (allocateNode assigns
+  // index + kIdOffset and binds the node to this tree). finalize only
+  // validates that invariant in a single linear pass and throws on a
+  // dangling reference; it is a no-op when NDEBUG is defined.
   void finalize();
 
-  // get the maximum node ID assigned in the tree after normalization(finalize)
+  // Optional pass run after finalize: every Table subtree whose distinct
+  // leaves (P nodes, one per terminal, Input nodes and shared Table nodes)
+  // number at most maxInputs is collapsed into a single composite table,
+  // computed 64 rows per word, when the composite does not expand into more
+  // on-set cubes than the tables it replaces. Subtrees with up to
+  // maxWideInputs leaves are also bounded by on-set size * inputs <=
+  // wideBudget. Absorbed nodes and duplicate P leaves are detached and left
+  // unreachable. Returns the number of absorbed Table nodes.
+  size_t collapse(uint32_t maxInputs = 6,
+                  uint32_t maxWideInputs = 16,
+                  size_t wideBudget = 64);
+
+  // Set the root of a tree assembled by hand with allocateNode.
+  void setRootId(uint32_t id) { rootId_ = id; }
+
+  // get the maximum node ID assigned in the tree
   uint32_t getMaxID() const {
     if (nodes_.empty()) return kIdOffset - 1;
     return static_cast<uint32_t>(nodes_.size() + kIdOffset - 1);
   }
 
 private:
+  friend class SNLLogicCloudDump;
+
   struct BorderLeaf {
     uint32_t parentId;
     size_t childPos;
     size_t extIndex;
   };
 
-  const Node& concatBody(size_t borderIndex,
-                         naja::DNL::DNLID instid,
-                         naja::DNL::DNLID termid);
+  const Node& concatBody(size_t borderIndex, TermID instid, TermID termid);
+
+  void rebindNodes();
+
+  // Node (and its control block and spilled edge lists) allocated from the
+  // tree arena, created on first use.
+  template <typename... Args>
+  std::shared_ptr<Node> newNode(Args&&... args) {
+    if (!arena_) {
+      arena_ = std::make_unique<std::pmr::monotonic_buffer_resource>(
+          kArenaBlockBytes);
+    }
+    auto node = std::allocate_shared<Node>(
+        std::pmr::polymorphic_allocator<Node>(arena_.get()),
+        std::forward<Args>(args)...);
+    node->parentIds.setResource(arena_.get());
+    node->childrenIds.setResource(arena_.get());
+    return node;
+  }
 
-  void updateBorderLeaves();
+  static constexpr size_t kArenaBlockBytes = 16 * 1024;
 
+  // Declared before nodes_: the arena must outlive the nodes it holds.
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
   std::vector<std::shared_ptr<Node>, tbb::tbb_allocator<std::shared_ptr<Node>>> nodes_;
   uint32_t rootId_ = kInvalidId;
   size_t numExternalInputs_ = 0;
+  // Open border leaves: Input children of Table nodes, in the order
+  // SNLLogicCloud::compute expands them. Leaves under P nodes are closed and
+  // never revisited. Maintained incrementally by the ctor and concatFull.
   std::vector<BorderLeaf, tbb::tbb_allocator<BorderLeaf>> borderLeaves_;
+  std::vector<BorderLeaf, tbb::tbb_allocator<BorderLeaf>> nextBorderLeaves_;
   size_t lastID_ = 2;       // debug counter for nodeID assignment
+  size_t numSplices_ = 0;
   static const SNLTruthTable PtableHolder_;
-  std::unordered_map<naja::DNL::DNLID, uint32_t> termid2nodeid_;
+  std::unordered_map<TermID, uint32_t> termid2nodeid_;
+  const DNLTermAttributes* attributes_ = nullptr;
 };
 
 } // namespace KEPLER_FORMAL
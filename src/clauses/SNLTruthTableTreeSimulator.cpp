@@ -0,0 +1,266 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "SNLTruthTableTreeSimulator.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+using namespace KEPLER_FORMAL;
+
+namespace {
+
+constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t kInProgress = std::numeric_limits<uint32_t>::max() - 1;
+
+struct Visit {
+  const SNLTruthTableTree::Node* node;
+  bool isLeaf;
+  size_t row;
+  uint32_t level;
+};
+
+}  // namespace
+
+size_t SNLTruthTableTreeSimulator::addTree(const SNLTruthTableTree& tree) {
+  return compile(tree, tree.getRootId(), nullptr);
+}
+
+size_t SNLTruthTableTreeSimulator::addRoot(const SNLTruthTableTree& tree,
+                                           uint32_t rootId) {
+  return compile(tree, rootId, nullptr);
+}
+
+size_t SNLTruthTableTreeSimulator::addTree(
+    const SNLTruthTableTree& tree,
+    const std::vector<VarID>& varNames) {
+  return compile(tree, tree.getRootId(), &varNames);
+}
+
+void SNLTruthTableTreeSimulator::clear() {
+  programs_.clear();
+  outputs_.clear();
+  numWords_ = 0;
+  numInputRows_ = 0;
+}
+
+//----------------------------------------------------------------------
+// compile: post-order walk, each node visited once, then levelized
+//----------------------------------------------------------------------
+size_t SNLTruthTableTreeSimulator::compile(
+    const SNLTruthTableTree& tree,
+    uint32_t rootId,
+    const std::vector<VarID>* varNames) {
+  using Node = SNLTruthTableTree::Node;
+  if (!tree.nodeFromId(rootId)) {
+    // LCOV_EXCL_START
+    throw std::invalid_argument("simulator: missing root");
+    // LCOV_EXCL_STOP
+  }
+
+  const size_t idSpan = tree.getNumNodes() + SNLTruthTableTree::kIdOffset;
+  // node id -> index in visits, or kUnvisited/kInProgress
+  std::vector<uint32_t> visitOf(idSpan, kUnvisited);
+  std::vector<Visit> visits;
+  std::vector<std::pair<uint32_t, bool>> stack;
+  stack.emplace_back(rootId, false);
+
+  while (!stack.empty()) {
+    auto [id, expanded] = stack.back();
+    stack.pop_back();
+    const auto& sp = tree.nodeFromId(id);
+    if (!sp) {
+      // LCOV_EXCL_START
+      throw std::logic_error("simulator: null node");
+      // LCOV_EXCL_STOP
+    }
+    const Node* node = sp.get();
+    const bool isLeaf =
+        node->type == Node::Type::Input && node->childrenIds.empty();
+
+    if (!expanded) {
+      if (visitOf[id] == kInProgress) {
+        // LCOV_EXCL_START
+        throw std::logic_error("simulator: cycle detected");
+        // LCOV_EXCL_STOP
+      }
+      if (visitOf[id] != kUnvisited)
+        continue;
+      if (!isLeaf) {
+        visitOf[id] = kInProgress;
+        stack.emplace_back(id, true);
+        for (auto cid : node->childrenIds)
+          stack.emplace_back(cid, false);
+        continue;
+      }
+    }
+
+    Visit v{node, isLeaf, 0, 0};
+    if (isLeaf) {
+      if (varNames == nullptr) {
+        v.row = node->data.inputIndex;
+      } else {
+        if (node->parentIds.empty()) {
+          // LCOV_EXCL_START
+          throw std::runtime_error("Input node has no parent");
+          // LCOV_EXCL_STOP
+        }
+        const auto& parent = tree.nodeFromId(node->parentIds[0]);
+        assert(parent && parent->type == Node::Type::P);
+        assert(parent->data.termid < varNames->size());
+        const VarID var = (*varNames)[parent->data.termid];
+        if (var == kNoVarID) {
+          // LCOV_EXCL_START
+          throw std::runtime_error("Input variable index is SIZE_MAX");
+          // LCOV_EXCL_STOP
+        }
+        v.row = var == 0 ? kConst0Row : (var == 1 ? kConst1Row : var);
+      }
+      if (v.row != kConst0Row && v.row != kConst1Row)
+        numInputRows_ = std::max(numInputRows_, v.row + 1);
+    } else {
+      const auto& tbl = node->getTruthTable();
+      if (node->childrenIds.size() != tbl.size()) {
+        // LCOV_EXCL_START
+        throw std::logic_error("TableNode: children count mismatch");
+        // LCOV_EXCL_STOP
+      }
+      for (auto cid : node->childrenIds)
+        v.level = std::max(v.level, visits[visitOf[cid]].level + 1);
+    }
+    visitOf[id] = static_cast<uint32_t>(visits.size());
+    visits.push_back(v);
+  }
+
+  // Slots: leaves first, then ops ordered by level (stable, so children
+  // always precede their parents).
+  Program program;
+  std::vector<uint32_t> opOrder;
+  for (uint32_t i = 0; i < visits.size(); ++i) {
+    if (visits[i].isLeaf)
+      program.leaves.push_back({0, visits[i].row});
+    else
+      opOrder.push_back(i);
+  }
+  std::stable_sort(opOrder.begin(), opOrder.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return visits[a].level < visits[b].level;
+                   });
+  std::vector<uint32_t> slotOf(visits.size());
+  {
+    uint32_t leafSlot = 0;
+    for (uint32_t i = 0; i < visits.size(); ++i) {
+      if (visits[i].isLeaf) {
+        program.leaves[leafSlot].slot = leafSlot;
+        slotOf[i] = leafSlot++;
+      }
+    }
+    for (uint32_t rank = 0; rank < opOrder.size(); ++rank)
+      slotOf[opOrder[rank]] = leafSlot + rank;
+  }
+
+  program.ops.reserve(opOrder.size());
+  for (uint32_t vi : opOrder) {
+    const Visit& v = visits[vi];
+    const auto& tbl = v.node->getTruthTable();
+    Op op;
+    op.arity = tbl.size();
+    op.firstChild = static_cast<uint32_t>(program.childSlots.size());
+    op.firstWord = static_cast<uint32_t>(program.tableWords.size());
+    op.level = v.level;
+    for (auto cid : v.node->childrenIds)
+      program.childSlots.push_back(slotOf[visitOf[cid]]);
+    const uint64_t rows = uint64_t{1} << op.arity;
+    program.tableWords.resize(op.firstWord + (rows + 63) / 64, 0);
+    for (uint64_t m = 0; m < rows; ++m) {
+      if (tbl.bits().bit(m))
+        program.tableWords[op.firstWord + m / 64] |= uint64_t{1} << (m % 64);
+    }
+    program.numLevels = std::max(program.numLevels, v.level);
+    program.ops.push_back(op);
+  }
+  program.outSlot = slotOf[visitOf[rootId]];
+  program.numLevels += 1;
+
+  programs_.push_back(std::move(program));
+  return programs_.size() - 1;
+}
+
+//----------------------------------------------------------------------
+// run: evaluate one program, op by op, numWords words at a time
+//----------------------------------------------------------------------
+void SNLTruthTableTreeSimulator::run(const Program& program,
+                                     const std::vector<Word>& patterns,
+                                     size_t numWords,
+                                     Word* out) {
+  const size_t numLeaves = program.leaves.size();
+  std::vector<Word> values((numLeaves + program.ops.size()) * numWords);
+  for (const auto& leaf : program.leaves) {
+    Word* dst = values.data() + leaf.slot * numWords;
+    if (leaf.row == kConst0Row) {
+      std::fill(dst, dst + numWords, Word{0});
+    } else if (leaf.row == kConst1Row) {
+      std::fill(dst, dst + numWords, ~Word{0});
+    } else {
+      std::copy(patterns.begin() + leaf.row * numWords,
+                patterns.begin() + (leaf.row + 1) * numWords, dst);
+    }
+  }
+
+  std::vector<Word> scratch;
+  for (size_t i = 0; i < program.ops.size(); ++i) {
+    const Op& op = program.ops[i];
+    Word* dst = values.data() + (numLeaves + i) * numWords;
+    const uint32_t* children = program.childSlots.data() + op.firstChild;
+    const uint64_t* bits = program.tableWords.data() + op.firstWord;
+    auto bitMask = [bits](uint64_t m) -> Word {
+      return ((bits[m / 64] >> (m % 64)) & 1u) ? ~Word{0} : Word{0};
+    };
+    if (op.arity == 0) {
+      std::fill(dst, dst + numWords, bitMask(0));
+      continue;
+    }
+    // Mux tree: fold input 0 over the table rows, then input 1 over the
+    // partial results, and so on; 2^arity - 1 word muxes per word.
+    size_t half = size_t{1} << (op.arity - 1);
+    scratch.resize(half);
+    const Word* in0 = values.data() + children[0] * numWords;
+    for (size_t w = 0; w < numWords; ++w) {
+      const Word x0 = in0[w];
+      size_t width = half;
+      for (size_t m = 0; m < width; ++m)
+        scratch[m] = (x0 & bitMask(2 * m + 1)) | (~x0 & bitMask(2 * m));
+      for (uint32_t j = 1; j < op.arity; ++j) {
+        const Word x = values[children[j] * numWords + w];
+        width >>= 1;
+        for (size_t m = 0; m < width; ++m)
+          scratch[m] = (x & scratch[2 * m + 1]) | (~x & scratch[2 * m]);
+      }
+      dst[w] = scratch[0];
+    }
+  }
+
+  const Word* res = values.data() + program.outSlot * numWords;
+  std::copy(res, res + numWords, out);
+}
+
+void SNLTruthTableTreeSimulator::simulate(const std::vector<Word>& patterns,
+                                          size_t numWords) {
+  if (numWords == 0 || patterns.size() < numInputRows_ * numWords) {
+    // LCOV_EXCL_START
+    throw std::invalid_argument("simulate: pattern set too small");
+    // LCOV_EXCL_STOP
+  }
+  numWords_ = numWords;
+  outputs_.assign(programs_.size() * numWords, 0);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, programs_.size()),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      for (size_t i = r.begin(); i < r.end(); ++i) {
+                        run(programs_[i], patterns, numWords,
+                            outputs_.data() + i * numWords);
+                      }
+                    });
+}
@@ -0,0 +1,105 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "SNLTruthTableTree.h"
+
+namespace KEPLER_FORMAL {
+
+/// Levelized, bit-parallel simulator for SNLTruthTableTree.
+///
+/// Each added tree is compiled once into a flat program: leaves first, then
+/// the Table/P nodes sorted by level, every node (including shared subtrees)
+/// appearing exactly once. A simulate() call evaluates 64 patterns per word,
+/// numWords words per pattern row, for all compiled trees against the same
+/// pattern set. Table nodes are evaluated with a word-wide mux tree over
+/// their input words instead of per-bit table indexing.
+///
+/// Pattern rows are stored row-major: row r occupies
+/// patterns[r * numWords, (r + 1) * numWords).
+class SNLTruthTableTreeSimulator {
+ public:
+  using Word = uint64_t;
+  static constexpr size_t kPatternsPerWord = 64;
+
+  /// Add the tree rooted at tree.getRootId(). Input leaves read the pattern
+  /// row of their inputIndex (same binding as SNLTruthTableTree::eval).
+  size_t addTree(const SNLTruthTableTree& tree);
+  /// Same as addTree but starting from any node of the tree.
+  size_t addRoot(const SNLTruthTableTree& tree, uint32_t rootId);
+  /// Add the tree rooted at tree.getRootId(). Input leaves read the row
+  /// varNames[termid of their P parent] (same binding as
+  /// Tree2BoolExpr::convert): rows 0 and 1 are the FALSE/TRUE constants and
+  /// are never read from the pattern set.
+  size_t addTree(const SNLTruthTableTree& tree,
+                 const std::vector<VarID>& varNames);
+
+  /// Evaluate all compiled trees on 64 * numWords patterns.
+  void simulate(const std::vector<Word>& patterns, size_t numWords);
+
+  size_t getNumTrees() const { return programs_.size(); }
+  size_t getNumWords() const { return numWords_; }
+  /// Number of pattern rows the compiled trees read (max row + 1).
+  size_t getNumInputRows() const { return numInputRows_; }
+  size_t getNumLevels(size_t treeIndex) const {
+    return programs_[treeIndex].numLevels;
+  }
+  /// Number of distinct Table/P nodes evaluated per word for a tree.
+  size_t getNumOps(size_t treeIndex) const {
+    return programs_[treeIndex].ops.size();
+  }
+  /// Output words of a tree after simulate(); getNumWords() words.
+  const Word* getOutput(size_t treeIndex) const {
+    return outputs_.data() + treeIndex * numWords_;
+  }
+  bool getOutputBit(size_t treeIndex, size_t pattern) const {
+    return (getOutput(treeIndex)[pattern / kPatternsPerWord] >>
+            (pattern % kPatternsPerWord)) &
+           1u;
+  }
+  void clear();
+
+ private:
+  static constexpr size_t kConst0Row = std::numeric_limits<size_t>::max() - 1;
+  static constexpr size_t kConst1Row = std::numeric_limits<size_t>::max();
+
+  struct Leaf {
+    uint32_t slot;
+    size_t row;
+  };
+  struct Op {
+    uint32_t arity;
+    uint32_t firstChild;  // into Program::childSlots
+    uint32_t firstWord;   // into Program::tableWords
+    uint32_t level;
+  };
+  struct Program {
+    std::vector<Leaf> leaves;
+    std::vector<Op> ops;  // op i writes slot leaves.size() + i
+    std::vector<uint32_t> childSlots;
+    std::vector<uint64_t> tableWords;  // packed truth-table bits
+    uint32_t outSlot = 0;
+    uint32_t numLevels = 0;
+  };
+
+  size_t compile(const SNLTruthTableTree& tree,
+                 uint32_t rootId,
+                 const std::vector<VarID>* varNames);
+  static void run(const Program& program,
+                  const std::vector<Word>& patterns,
+                  size_t numWords,
+                  Word* out);
+
+  std::vector<Program> programs_;
+  std::vector<Word> outputs_;
+  size_t numWords_ = 0;
+  size_t numInputRows_ = 0;
+};
+
+}  // namespace KEPLER_FORMAL
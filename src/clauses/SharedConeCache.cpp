@@ -0,0 +1,31 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "SharedConeCache.h"
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+
+SharedConeCache::SharedConeCache(const DNLFaninGraph& graph, size_t minFanout)
+    : graph_(graph), minFanout_(minFanout) {}
+
+bool SharedConeCache::isCandidate(TermID driver) const {
+  if (driver >= graph_.getNumTerms()) {
+    return false;
+  }
+  const DNLID iso = graph_.getIsoID(driver);
+  return iso != DNLID_MAX && graph_.getNumIsoReaders(iso) > minFanout_;
+}
+
+std::shared_ptr<BoolExpr> SharedConeCache::find(TermID driver) const {
+  auto it = exprs_.find(driver);
+  if (it == exprs_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void SharedConeCache::publish(TermID driver,
+                              const std::shared_ptr<BoolExpr>& expr) {
+  exprs_.emplace(driver, expr);
+}
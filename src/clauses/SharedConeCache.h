@@ -0,0 +1,42 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <tbb/concurrent_unordered_map.h>
+#include <memory>
+
+#include "BoolExpr.h"
+#include "DNLFaninGraph.h"
+#include "TermID.h"
+
+namespace KEPLER_FORMAL {
+
+/// Finished BoolExpr of driver terminals, shared by the workers building PO
+/// clouds. Tree2BoolExpr::convert publishes the expression of every Table
+/// node whose driver fans out to more than minFanout readers, and
+/// SNLLogicCloud::compute stops at published drivers, which become P leaves
+/// resolved from the cache instead of being expanded again.
+///
+/// Expressions are hash-consed, so two workers publishing the same driver
+/// produce the same pointer; the first insertion wins and entries are never
+/// modified afterwards. The fan-out is read from `graph`, which must
+/// outlive the cache.
+class SharedConeCache {
+ public:
+  explicit SharedConeCache(const DNLFaninGraph& graph, size_t minFanout = 4);
+
+  /// True when the iso driven by `driver` has more than minFanout readers.
+  bool isCandidate(TermID driver) const;
+  /// Published expression of `driver`, or nullptr.
+  std::shared_ptr<BoolExpr> find(TermID driver) const;
+  void publish(TermID driver, const std::shared_ptr<BoolExpr>& expr);
+  size_t size() const { return exprs_.size(); }
+
+ private:
+  const DNLFaninGraph& graph_;
+  size_t minFanout_;
+  tbb::concurrent_unordered_map<TermID, std::shared_ptr<BoolExpr>> exprs_;
+};
+
+}  // namespace KEPLER_FORMAL
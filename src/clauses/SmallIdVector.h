@@ -0,0 +1,111 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+
+namespace KEPLER_FORMAL {
+
+/// Node id list of a tree node. Most nodes have 1 to 4 children and a single
+/// parent: up to kInline ids are stored in place, longer lists spill to a
+/// buffer taken from `resource` (the tree arena, or new/delete by default).
+/// An arena never frees individually, so spilled buffers are released with
+/// it.
+class SmallIdVector {
+ public:
+  static constexpr uint32_t kInline = 4;
+
+  SmallIdVector() = default;
+  explicit SmallIdVector(std::pmr::memory_resource* resource)
+      : resource_(resource) {}
+  SmallIdVector(const SmallIdVector& other) : resource_(other.resource_) {
+    assign(other.begin(), other.end());
+  }
+  SmallIdVector& operator=(const SmallIdVector& other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+  ~SmallIdVector() { releaseHeap(); }
+
+  /// Resource of later spills; the list must not have spilled yet.
+  void setResource(std::pmr::memory_resource* resource) {
+    resource_ = resource;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  uint32_t* begin() { return data(); }
+  uint32_t* end() { return data() + size_; }
+  const uint32_t* begin() const { return data(); }
+  const uint32_t* end() const { return data() + size_; }
+  uint32_t& operator[](size_t i) { return data()[i]; }
+  uint32_t operator[](size_t i) const { return data()[i]; }
+
+  void push_back(uint32_t id) {
+    if (size_ == capacity_) {
+      grow(capacity_ * 2);
+    }
+    data()[size_++] = id;
+  }
+  void clear() { size_ = 0; }
+  void resize(size_t n) {
+    if (n > capacity_) {
+      grow(static_cast<uint32_t>(n));
+    }
+    if (n > size_) {
+      std::fill(data() + size_, data() + n, 0u);
+    }
+    size_ = static_cast<uint32_t>(n);
+  }
+  template <typename It>
+  void assign(It first, It last) {
+    clear();
+    for (; first != last; ++first) {
+      push_back(static_cast<uint32_t>(*first));
+    }
+  }
+  uint32_t* erase(uint32_t* pos) {
+    std::copy(pos + 1, end(), pos);
+    --size_;
+    return pos;
+  }
+
+ private:
+  bool isInline() const { return capacity_ == kInline; }
+  uint32_t* data() { return isInline() ? inline_ : heap_; }
+  const uint32_t* data() const { return isInline() ? inline_ : heap_; }
+  std::pmr::memory_resource* resource() const {
+    return resource_ != nullptr ? resource_ : std::pmr::new_delete_resource();
+  }
+  void grow(uint32_t capacity) {
+    auto* ids = static_cast<uint32_t*>(
+        resource()->allocate(capacity * sizeof(uint32_t), alignof(uint32_t)));
+    std::memcpy(ids, data(), size_ * sizeof(uint32_t));
+    releaseHeap();
+    heap_ = ids;
+    capacity_ = capacity;
+  }
+  void releaseHeap() {
+    if (!isInline()) {
+      resource()->deallocate(heap_, capacity_ * sizeof(uint32_t),
+                             alignof(uint32_t));
+    }
+  }
+
+  uint32_t size_ = 0;
+  uint32_t capacity_ = kInline;
+  union {
+    uint32_t inline_[kInline];
+    uint32_t* heap_;
+  };
+  std::pmr::memory_resource* resource_ = nullptr;
+};
+
+}  // namespace KEPLER_FORMAL
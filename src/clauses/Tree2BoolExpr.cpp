@@ -6,9 +6,13 @@
 #include "DNL.h"
 #include "SNLTruthTable.h"
 #include "SNLTruthTableTree.h"
+#include <tbb/blocked_range.h>
 #include <tbb/concurrent_vector.h>
 #include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 #include <tbb/tbb_allocator.h>
+#include <algorithm>
 #include <bitset>
 #include <cstdint>
 #include <stdexcept>
@@ -28,6 +32,8 @@
 using namespace naja::NL;
 using namespace KEPLER_FORMAL;
 
+size_t Tree2BoolExpr::parallelThreshold_ = 1 << 14;
+
 typedef std::pair<std::vector<std::shared_ptr<BoolExpr>, tbb::tbb_allocator<std::shared_ptr<BoolExpr>>>, size_t> TermsPair;
 tbb::enumerable_thread_specific<TermsPair> termsETS;
 tbb::concurrent_vector<TermsPair*> termsETSvector;
@@ -384,8 +390,229 @@ void setChildFETS(size_t i, const std::shared_ptr<BoolExpr>& expr) {
 //   return cur;
 // }
 
+// Expand `tbl` into the DNF of its on-set over its relevant inputs; input i
+// is read from the childF buffer, which the caller fills.
+static std::shared_ptr<BoolExpr> tableToExpr(const SNLTruthTable& tbl) {
+  uint32_t k = tbl.size();
+  uint64_t rows = uint64_t{1} << k;
+
+  if (tbl.all0()) {
+    return BoolExpr::createFalse();
+  } else if (tbl.all1()) {
+    return BoolExpr::createTrue();
+  }
+
+  // find which inputs actually matter
+  clearRelevantETS();
+  reserveRelevantETSwithFalse(k);
+  for (uint32_t j = 0; j < k; ++j) {
+    for (uint64_t m = 0; m < rows; ++m) {
+      bool b0 = tbl.bits().bit(m);
+      bool b1 = tbl.bits().bit(m ^ (uint64_t{1} << j));
+      if (b0 != b1) { setRelevantETS(j, true); break; }
+    }
+  }
+
+  // collect the indices of relevant vars
+  std::vector<uint32_t, tbb::tbb_allocator<uint32_t>> relIdx;
+  for (uint32_t j = 0; j < k; ++j) { if (getRelevantETS(j)) relIdx.push_back(j); }
+
+  // if nothing matters, fall back to constant-false
+  if (relIdx.empty()) {
+    return BoolExpr::createFalse();
+  }
+  // build the DNF terms
+  clearTermsETS();
+  reserveTermsETS(static_cast<size_t>(rows));
+  for (uint64_t m = 0; m < rows; ++m) {
+    if (!tbl.bits().bit(m)) continue;
+    std::shared_ptr<BoolExpr> term = nullptr;
+    bool firstLit = true;
+    std::shared_ptr<BoolExpr> lit = nullptr;
+    for (uint32_t j : relIdx) {
+      bool bit1 = ((m >> j) & 1) != 0;
+      lit = bit1 ? getChildFETS(j) : BoolExpr::Not(getChildFETS(j));
+      if (firstLit) { term = lit; firstLit = false; }
+      else { assert(term != nullptr); assert(lit != nullptr); term = BoolExpr::And(term, lit); }
+    }
+    // only push if we actually got a literal
+    if (term) { pushBackTermsETS(std::move(term)); }
+  }
+
+  // guard against an empty terms list
+  if (emptyTermsETS()) { return BoolExpr::createFalse(); }
+  // fold into OR
+  std::shared_ptr<BoolExpr> expr = getTErmsETS().first[0];
+  for (size_t t = 1; t < sizeOfTermsETS(); ++t) {
+    expr = BoolExpr::Or(expr, getTErmsETS().first[t]);
+  }
+  return expr;
+}
+
+std::shared_ptr<BoolExpr> Tree2BoolExpr::convertTable(
+  const SNLTruthTable& table,
+  const std::vector<std::shared_ptr<BoolExpr>>& inputs) {
+  initChildFETS();
+  initRelevantETS();
+  initTermsETS();
+  if (inputs.size() != table.size()) {
+    // LCOV_EXCL_START
+    throw std::logic_error("convertTable: inputs count mismatch");
+    // LCOV_EXCL_STOP
+  }
+  clearChildFETS();
+  reserveChildFETS(table.size());
+  for (uint32_t i = 0; i < table.size(); ++i) {
+    setChildFETS(i, inputs[i]);
+  }
+  return tableToExpr(table);
+}
+
+// Expression of an Input leaf, read through its P parent: the PI variable,
+// a constant, or the cached sub-cone of a driver.
+static std::shared_ptr<BoolExpr> inputToExpr(
+    const SNLTruthTableTree::Node* node,
+    const std::vector<VarID>& varNames,
+    const SharedConeCache* cache) {
+  assert(node->type == SNLTruthTableTree::Node::Type::Input);
+  if (node->parentIds.size() > 1) {
+    #ifdef DEBUG_PRINTS
+    for (const auto& pid : node->parentIds) {
+      DEBUG_LOG("%s\n", naja::DNL::get()->getDNLTerminalFromID(node->tree->nodeFromId(pid)->data.termid)
+               .getSnlBitTerm()->getString().c_str());
+      DEBUG_LOG("of model %s\n", naja::DNL::get()->getDNLTerminalFromID(node->tree->nodeFromId(pid)->data.termid)
+             .getDNLInstance().getSNLModel()->getString().c_str());
+    }
+    #endif
+  }
+  if (node->parentIds.empty()) { 
+    // LCOV_EXCL_START
+    throw std::runtime_error("Input node has no parent"); 
+    // LCOV_EXCL_STOP
+  }
+  assert(node->parentIds.size() == 1);
+  auto parent = node->tree->nodeFromId(node->parentIds[0]);
+  assert(parent && parent->type == SNLTruthTableTree::Node::Type::P);
+  if (parent->data.termid >= varNames.size()) {
+    DEBUG_LOG("varNames size: %zu, parent data.termid: %zu\n", varNames.size(), (size_t)parent->data.termid);
+    assert(parent->data.termid < varNames.size());
+  }
+  if (varNames[parent->data.termid] == kNoVarID) {
+    // not a PI: a driver whose sub-cone is in the cache
+    auto cached = cache != nullptr ? cache->find(parent->data.termid)
+                                   : nullptr;
+    if (cached == nullptr) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("Input variable index is SIZE_MAX");
+      // LCOV_EXCL_STOP
+    }
+    return cached;
+  } else if (varNames[parent->data.termid] == 0) {
+    return BoolExpr::createFalse();
+  } else if (varNames[parent->data.termid] == 1) {
+    return BoolExpr::createTrue();
+  }
+  return BoolExpr::Var(varNames[parent->data.termid]);
+}
+
+// Expression of a Table / P node whose children are converted; memo(id)
+// returns the expression of child node id.
+template <typename Memo>
+static std::shared_ptr<BoolExpr> tableNodeToExpr(
+    const SNLTruthTableTree::Node* node,
+    SharedConeCache* cache,
+    Memo&& memo) {
+  const SNLTruthTable& tbl = node->getTruthTable();
+  uint32_t k = tbl.size();
+  // gather children
+  clearChildFETS();
+  reserveChildFETS(k);
+  if (!tbl.all0() && !tbl.all1()) {
+    for (uint32_t i = 0; i < k; ++i) {
+      size_t cid = node->tree->nodeFromId(node->childrenIds[i])->nodeID;
+      setChildFETS(i, memo(cid));
+    }
+  }
+  auto expr = tableToExpr(tbl);
+  if (cache != nullptr && node->type == SNLTruthTableTree::Node::Type::Table &&
+      cache->isCandidate(node->data.termid)) {
+    cache->publish(node->data.termid, expr);
+  }
+  return expr;
+}
+
+// Large trees: nodes are levelized by height (leaves first) and each level
+// is converted in parallel, a node only reading the memo of lower levels.
+// Shared sub-trees are converted once and hash-consing joins the results.
+static std::shared_ptr<BoolExpr> convertByLevels(
+    const SNLTruthTableTree& tree,
+    const std::vector<VarID>& varNames,
+    SharedConeCache* cache) {
+  using Node = SNLTruthTableTree::Node;
+  constexpr int32_t kUnvisited = -1;
+  constexpr int32_t kVisiting = -2;
+  const Node* root = tree.getRoot().get();
+  std::vector<int32_t> height(tree.getMaxID() + 1, kUnvisited);
+  std::vector<std::vector<const Node*>> levels;
+  using Frame = std::pair<const Node*, bool>;
+  std::vector<Frame> stack;
+  stack.emplace_back(root, false);
+  while (!stack.empty()) {
+    auto [node, visited] = stack.back();
+    stack.pop_back();
+    int32_t& h = height[node->nodeID];
+    if (!visited) {
+      if (h != kUnvisited) continue;
+      h = kVisiting;
+      stack.emplace_back(node, true);
+      if (node->type != Node::Type::Input) {
+        for (const auto& c : node->childrenIds) {
+          stack.emplace_back(tree.nodeFromId(c).get(), false);
+        }
+      }
+      continue;
+    }
+    h = 0;
+    if (node->type != Node::Type::Input) {
+      for (const auto& c : node->childrenIds) {
+        h = std::max(h, height[c] + 1);
+      }
+    }
+    if (levels.size() <= static_cast<size_t>(h)) {
+      levels.resize(h + 1);
+    }
+    levels[h].push_back(node);
+  }
+
+  std::vector<std::shared_ptr<BoolExpr>> memo(tree.getMaxID() + 1);
+  // Isolated: a waiting worker must not pick another conversion that would
+  // reuse its per-thread buffers.
+  tbb::this_task_arena::isolate([&]() {
+    for (const auto& level : levels) {
+      tbb::parallel_for(
+          tbb::blocked_range<size_t>(0, level.size()),
+          [&](const tbb::blocked_range<size_t>& r) {
+            initChildFETS();
+            initRelevantETS();
+            initTermsETS();
+            for (size_t i = r.begin(); i < r.end(); ++i) {
+              const Node* node = level[i];
+              memo[node->nodeID] =
+                  node->type == Node::Type::Input
+                      ? inputToExpr(node, varNames, cache)
+                      : tableNodeToExpr(node, cache, [&](size_t cid) {
+                          return memo[cid];
+                        });
+            }
+          });
+    }
+  });
+  return memo[root->nodeID];
+}
+
 std::shared_ptr<BoolExpr> Tree2BoolExpr::convert(
-  const SNLTruthTableTree& tree, const std::vector<size_t>& varNames) {
+  const SNLTruthTableTree& tree, const std::vector<VarID>& varNames,
+  SharedConeCache* cache) {
 
   initChildFETS();
   initMemoETS();
@@ -394,6 +621,9 @@ std::shared_ptr<BoolExpr> Tree2BoolExpr::convert(
 
   const auto root = tree.getRoot();
   if (!root) return nullptr;
+  if (tree.getNumNodes() >= parallelThreshold_) {
+    return convertByLevels(tree, varNames, cache);
+  }
 
   // 1) find maxID
   // size_t maxID = 0;
@@ -441,110 +671,13 @@ std::shared_ptr<BoolExpr> Tree2BoolExpr::convert(
         stack.emplace_back(node, true);
         for (const auto& c : node->childrenIds) stack.emplace_back(node->tree->nodeFromId(c).get(), false);
       } else {
-        assert(node->type == SNLTruthTableTree::Node::Type::Input);
-        if (node->parentIds.size() > 1) {
-          #ifdef DEBUG_PRINTS
-          for (const auto& pid : node->parentIds) {
-            DEBUG_LOG("%s\n", naja::DNL::get()->getDNLTerminalFromID(tree.nodeFromId(pid)->data.termid)
-                     .getSnlBitTerm()->getString().c_str());
-            DEBUG_LOG("of model %s\n", naja::DNL::get()->getDNLTerminalFromID(tree.nodeFromId(pid)->data.termid)
-                   .getDNLInstance().getSNLModel()->getString().c_str());
-          }
-          #endif
-        }
-        if (node->parentIds.empty()) { 
-          // LCOV_EXCL_START
-          throw std::runtime_error("Input node has no parent"); 
-          // LCOV_EXCL_STOP
-        }
-        assert(node->parentIds.size() == 1);
-        auto parent = node->tree->nodeFromId(node->parentIds[0]);
-        assert(parent && parent->type == SNLTruthTableTree::Node::Type::P);
-        if (parent->data.termid >= varNames.size()) {
-          DEBUG_LOG("varNames size: %zu, parent data.termid: %zu\n", varNames.size(), (size_t)parent->data.termid);
-          assert(parent->data.termid < varNames.size());
-        }
-        if (varNames[parent->data.termid] == (size_t)-1) {
-          // LCOV_EXCL_START
-          throw std::runtime_error("Input variable index is SIZE_MAX");
-          // LCOV_EXCL_STOP
-        }
-        if (varNames[parent->data.termid] == 0) {
-           setMemoETS(id, BoolExpr::createFalse());
-        } else if (varNames[parent->data.termid] == 1) {
-           setMemoETS(id, BoolExpr::createTrue());
-        } else {
-          setMemoETS(id, BoolExpr::Var(varNames[parent->data.termid]));
-        }
+        setMemoETS(id, inputToExpr(node, varNames, cache));
       }
     } else {
       // post-visit for Table / P
-      const SNLTruthTable& tbl = node->getTruthTable();
-      uint32_t k = tbl.size();
-      uint64_t rows = uint64_t{1} << k;
-
-      if (tbl.all0()) {
-        setMemoETS(id, BoolExpr::createFalse());
-      } else if (tbl.all1()) {
-        setMemoETS(id, BoolExpr::createTrue());
-      } else {
-        // gather children
-        clearChildFETS();
-        reserveChildFETS(k);
-        for (uint32_t i = 0; i < k; ++i) {
-          size_t cid = node->tree->nodeFromId(node->childrenIds[i])->nodeID;
-          setChildFETS(i, getMemoETS(cid));
-        }
-
-        // find which inputs actually matter
-        clearRelevantETS();
-        reserveRelevantETSwithFalse(k);
-        for (uint32_t j = 0; j < k; ++j) {
-          for (uint64_t m = 0; m < rows; ++m) {
-            bool b0 = tbl.bits().bit(m);
-            bool b1 = tbl.bits().bit(m ^ (uint64_t{1} << j));
-            if (b0 != b1) { setRelevantETS(j, true); break; }
-          }
-        }
-
-        // collect the indices of relevant vars
-        std::vector<uint32_t, tbb::tbb_allocator<uint32_t>> relIdx;
-        for (uint32_t j = 0; j < k; ++j) { if (getRelevantETS(j)) relIdx.push_back(j); }
-
-        // if nothing matters, fall back to constant-false
-        if (relIdx.empty()) {
-          setMemoETS(id, BoolExpr::createFalse());
-        } else {
-          // build the DNF terms
-          clearTermsETS();
-          reserveTermsETS(static_cast<size_t>(rows));
-          for (uint64_t m = 0; m < rows; ++m) {
-            if (!tbl.bits().bit(m)) continue;
-            std::shared_ptr<BoolExpr> term = nullptr;
-            bool firstLit = true;
-            std::shared_ptr<BoolExpr> lit = nullptr;
-            for (uint32_t j : relIdx) {
-              bool bit1 = ((m >> j) & 1) != 0;
-              lit = bit1 ? getChildFETS(j) : BoolExpr::Not(getChildFETS(j));
-              if (firstLit) { term = lit; firstLit = false; }
-              else { assert(term != nullptr); assert(lit != nullptr); term = BoolExpr::And(term, lit); }
-            }
-            // only push if we actually got a literal
-            if (term) { pushBackTermsETS(std::move(term)); }
-          }
-
-          // guard against an empty terms list
-          if (emptyTermsETS()) { setMemoETS(id, BoolExpr::createFalse()); }
-          else {
-            // fold into OR
-            std::shared_ptr<BoolExpr> expr = getTErmsETS().first[0];
-            for (size_t t = 1; t < sizeOfTermsETS(); ++t) {
-              expr = BoolExpr::Or(expr, getTErmsETS().first[t]);
-            }
-            setMemoETS(id, expr);
-          }
-        }
-      }
+      setMemoETS(id, tableNodeToExpr(node, cache, [](size_t cid) {
+        return getMemoETS(cid);
+      }));
     }
   }
 
@@ -9,14 +9,32 @@
 
 #include "BoolExpr.h"
 #include "SNLTruthTableTree.h"
+#include "SharedConeCache.h"
 
 namespace KEPLER_FORMAL {
 
 /// Convert a truth-table tree directly into a BoolExpr
 class Tree2BoolExpr {
  public:
-  static std::shared_ptr<BoolExpr> convert(const SNLTruthTableTree& tree,
-                                           const std::vector<size_t>& varNames);
+  /// With a cache, P leaves without a variable are resolved from it, and the
+  /// expressions of Table nodes driving a candidate net are published to it.
+  /// Trees of at least getParallelThreshold() nodes are converted level by
+  /// level in parallel instead of in one sequential post-order walk.
+  static std::shared_ptr<BoolExpr> convert(
+      const SNLTruthTableTree& tree,
+      const std::vector<VarID>& varNames,
+      SharedConeCache* cache = nullptr);
+  /// Convert a single truth table whose input i is inputs[i]. Uses the same
+  /// per-thread buffers as convert, so it must run inside a task arena.
+  static std::shared_ptr<BoolExpr> convertTable(
+      const naja::NL::SNLTruthTable& table,
+      const std::vector<std::shared_ptr<BoolExpr>>& inputs);
+
+  static size_t getParallelThreshold() { return parallelThreshold_; }
+  static void setParallelThreshold(size_t nodes) { parallelThreshold_ = nodes; }
+
+ private:
+  static size_t parallelThreshold_;
 };
 
 }  // namespace KEPLER_FORMAL
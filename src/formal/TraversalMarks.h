@@ -0,0 +1,44 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace KEPLER_FORMAL {
+
+/// Visited marks over a dense ID space (DNLIDs, iso IDs, ...). A mark is the
+/// generation stamp of the traversal that set it, so starting a traversal is
+/// O(1) instead of clearing a set. Keep one instance per worker (e.g. in an
+/// enumerable_thread_specific) and reuse it from one traversal to the next.
+class TraversalMarks {
+ public:
+  /// Start a new traversal over IDs in [0, size).
+  void reset(size_t size) {
+    if (stamps_.size() < size) {
+      stamps_.resize(size, 0);
+    }
+    if (++epoch_ == 0) {
+      // generation counter wrapped: forget every stamp once
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      epoch_ = 1;
+    }
+  }
+  bool isMarked(size_t id) const { return stamps_[id] == epoch_; }
+  /// Mark `id`; returns false when it was already marked in this traversal.
+  bool mark(size_t id) {
+    if (stamps_[id] == epoch_) {
+      return false;
+    }
+    stamps_[id] = epoch_;
+    return true;
+  }
+
+ private:
+  std::vector<uint32_t> stamps_;
+  uint32_t epoch_ = 0;
+};
+
+}  // namespace KEPLER_FORMAL
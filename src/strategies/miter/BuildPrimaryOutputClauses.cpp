@@ -2,9 +2,26 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "BuildPrimaryOutputClauses.h"
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
 #include "DNL.h"
+#include "DNLConstantPropagation.h"
+#include "DNLModelClasses.h"
+#include "NLUniverse.h"
+#include "ParallelSchedule.h"
 #include "SNLDesignModeling.h"
 #include "SNLLogicCloud.h"
+#include "SNLLogicCloudDump.h"
+#include "SNLLogicDAG.h"
+#include "TraversalMarks.h"
 #include "Tree2BoolExpr.h"
 #include "SNLPath.h"
 
@@ -21,349 +38,218 @@ using namespace KEPLER_FORMAL;
 using namespace naja::DNL;
 using namespace naja::NL;
 
-std::vector<DNLID> BuildPrimaryOutputClauses::collectInputs() {
-  std::vector<DNLID> inputs;
-  auto dnl = get();
-  DNLInstanceFull top = dnl->getTop();
-
-  for (DNLID termId = top.getTermIndexes().first;
-       termId != DNLID_MAX && termId <= top.getTermIndexes().second; termId++) {
-    const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-    if (term.getSnlBitTerm()->getDirection() != SNLBitTerm::Direction::Output) {
-      DEBUG_LOG("Collecting input %s\n",
-                term.getSnlBitTerm()->getName().getString().c_str());
-      assert(termId < naja::DNL::get()->getDNLTerms().size());
-      inputs.push_back(termId);
+namespace {
+
+constexpr PathTrie::PathID kNoPath = std::numeric_limits<PathTrie::PathID>::max();
+
+// Drivers counted at most by the cone size estimate: enough to tell the
+// large cones from the small ones without walking the large ones.
+constexpr size_t kConeCostCap = 1024;
+
+// Per-worker scratch of estimateConeCost, reused from one PO to the next.
+struct ConeCostScratch {
+  TraversalMarks visited;
+  std::vector<DNLID> stack;
+};
+tbb::enumerable_thread_specific<ConeCostScratch> coneCostScratchETS;
+
+// Number of distinct drivers in the fan-in of `po` down to the PIs and the
+// constant drivers, capped at kConeCostCap. With bypassBuffers, buffers and
+// inverters are skipped as in SNLLogicCloud and not counted.
+size_t estimateConeCost(DNLID po,
+                        const DNLFaninGraph& graph,
+                        const DNLTermSet& piSet,
+                        const DNLConstantPropagation& constants,
+                        bool bypassBuffers) {
+  ConeCostScratch& scratch = coneCostScratchETS.local();
+  TraversalMarks& visited = scratch.visited;
+  std::vector<DNLID>& stack = scratch.stack;
+  visited.reset(graph.getNumTerms());
+  stack.clear();
+  size_t numVisited = 0;
+  auto isStop = [&](DNLID term) {
+    return piSet.contains(term) || constants.isConstant(term);
+  };
+  auto push = [&](DNLID term) {
+    if (piSet.contains(term)) {
+      return;
+    }
+    for (DNLID driver : graph.getDrivers(term)) {
+      if (bypassBuffers) {
+        bool negated = false;
+        driver = graph.skipPassthrough(driver, negated, isStop);
+      }
+      if (!isStop(driver) && visited.mark(driver)) {
+        ++numVisited;
+        stack.push_back(driver);
+      }
+    }
+  };
+  push(po);
+  while (!stack.empty() && numVisited < kConeCostCap) {
+    const DNLID driver = stack.back();
+    stack.pop_back();
+    for (DNLID input : graph.getDriverInputs(driver)) {
+      push(input);
     }
   }
+  return std::min(numVisited, kConeCostCap);
+}
 
-  for (DNLID leaf : dnl->getLeaves()) {
-    DNLInstanceFull instance = dnl->getDNLInstanceFromID(leaf);
-    size_t numberOfInputs = 0, numberOfOutputs = 0;
-    for (DNLID termId = instance.getTermIndexes().first;
-         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-         termId++) {
-      const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-      if (term.getSnlBitTerm()->getDirection() != SNLBitTerm::Direction::Output)
-        numberOfInputs++;
-      if (term.getSnlBitTerm()->getDirection() != SNLBitTerm::Direction::Input)
-        numberOfOutputs++;
+// Interned keys of the terminals of the current DNL; the instance path of a
+// terminal is interned once per instance.
+class TermKeys {
+ public:
+  TermKeys(const DNLFull& dnl, PathTrie& paths)
+      : dnl_(dnl),
+        paths_(paths),
+        instancePaths_(dnl.getDNLInstances().size(), kNoPath) {}
+
+  TermPathKey operator()(DNLID term) {
+    const DNLTerminalFull& terminal = dnl_.getDNLTerminalFromID(term);
+    if (terminal.isNull()) {
+      // LCOV_EXCL_START
+      throw std::runtime_error("Terminal is null");
+      // LCOV_EXCL_STOP
     }
-
-    if (numberOfInputs == 0 && numberOfOutputs > 1) {
-      for (DNLID termId = instance.getTermIndexes().first;
-           termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-           termId++) {
-        const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Input) {
-          assert(termId < naja::DNL::get()->getDNLTerms().size());
-          inputs.push_back(termId);
-          DEBUG_LOG(
-              "Collecting input %s of model %s\n",
-              term.getSnlBitTerm()->getName().getString().c_str(),
-              term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
-        }
-      }
-      continue;
+    const DNLInstanceFull& instance = terminal.getDNLInstance();
+    PathTrie::PathID& path = instancePaths_[instance.getID()];
+    if (path == kNoPath) {
+      path = paths_.intern(instance.getPath().getPathNames());
     }
+    return {path, terminal.getSnlBitTerm()->getID(),
+            static_cast<int32_t>(terminal.getSnlBitTerm()->getBit())};
+  }
 
-    bool isSequential = false;
-    std::vector<SNLBitTerm*> seqBitTerms;
-    for (DNLID termId = instance.getTermIndexes().first;
-         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-         termId++) {
-      const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-      auto related =
-          SNLDesignModeling::getClockRelatedOutputs(term.getSnlBitTerm());
-      if (!related.empty()) {
-        isSequential = true;
-        for (auto bitTerm : related) {
-          seqBitTerms.push_back(bitTerm);
-        }
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Input) {
-          assert(termId < naja::DNL::get()->getDNLTerms().size());
-          inputs.push_back(termId);
-          DEBUG_LOG(
-              "Collecting seq input %s of model %s\n",
-              term.getSnlBitTerm()->getName().getString().c_str(),
-              term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
-        }
-      }
-    }
-    if (!isSequential) {
-      for (DNLID termId = instance.getTermIndexes().first;
-           termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-           termId++) {
-        const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Input) {
-          auto deps =
-              SNLDesignModeling::getCombinatorialInputs(term.getSnlBitTerm());
-          const auto& tt = SNLDesignModeling::getTruthTable(term.getSnlBitTerm()->getDesign(), 
-              term.getSnlBitTerm()->getOrderID());
-          if (!tt.isInitialized()) {
-            assert(termId < naja::DNL::get()->getDNLTerms().size());
-            inputs.push_back(termId);
-            DEBUG_LOG("Collecting input %s of model %s\n",
-                      term.getSnlBitTerm()->getName().getString().c_str(),
-                      term.getSnlBitTerm()
-                          ->getDesign()
-                          ->getName()
-                          .getString()
-                          .c_str());
-          }
-          
-          if (tt.all0() ||
-              tt.all1()) {
-            assert(termId < naja::DNL::get()->getDNLTerms().size());
-            inputs.push_back(termId);
-            DEBUG_LOG("Collecting constant input %s of model %s\n",
-                      term.getSnlBitTerm()->getName().getString().c_str(),
-                      term.getSnlBitTerm()
-                          ->getDesign()
-                          ->getName()
-                          .getString()
-                          .c_str());
+ private:
+  const DNLFull& dnl_;
+  PathTrie& paths_;
+  std::vector<PathTrie::PathID> instancePaths_;
+};
+
+// Stable, design independent key of a terminal: instance path names, then
+// the bit term ID and bit.
+std::string pathKey(const PathTrie& paths,
+                    const std::unordered_map<TermID, TermPathKey>& keys,
+                    TermID term) {
+  auto it = keys.find(term);
+  if (it == keys.end())
+    return "dnlid:" + std::to_string(term);
+  return paths.getString(it->second.path, '/') +
+         std::to_string(it->second.termID) + "." +
+         std::to_string(it->second.bit);
+}
+
+// Mark the leaf terminals whose model flags intersect `mask`. Leaves own
+// disjoint term ranges, so the scan runs in parallel on a byte per term.
+void pickLeafTerms(const DNLFull& dnl,
+                   const DNLModelClasses& classes,
+                   uint8_t mask,
+                   std::vector<uint8_t>& picked) {
+  const auto& leaves = dnl.getLeaves();
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, leaves.size()),
+      [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+          const DNLInstanceFull& instance = dnl.getDNLInstanceFromID(leaves[i]);
+          const uint32_t model = classes.getModelIndex(leaves[i]);
+          const auto [first, last] = instance.getTermIndexes();
+          for (DNLID termId = first; termId != DNLID_MAX && termId <= last;
+               termId++) {
+            if (classes.getFlags(model, termId - first) & mask) {
+              picked[termId] = 1;
+            }
           }
         }
-      }
-      continue;
+      });
+}
+
+// Marked terminals in increasing DNLID order.
+std::vector<TermID> pickedTerms(const std::vector<uint8_t>& picked) {
+  std::vector<TermID> terms;
+  for (DNLID termId = 0; termId < picked.size(); ++termId) {
+    if (picked[termId]) {
+      terms.push_back(toTermID(termId));
     }
-    for (DNLID termId = instance.getTermIndexes().first;
-         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-         termId++) {
-      const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-      if (term.getSnlBitTerm()->getDirection() !=
-          SNLBitTerm::Direction::Input) {
-        if (std::find(seqBitTerms.begin(), seqBitTerms.end(),
-                      term.getSnlBitTerm()) != seqBitTerms.end()) {
-          assert(termId < naja::DNL::get()->getDNLTerms().size());
-          inputs.push_back(termId);
-          DEBUG_LOG(
-              "Collecting seq input %s of model %s\n",
-              term.getSnlBitTerm()->getName().getString().c_str(),
-              term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
-        }
-      }
+  }
+  return terms;
+}
+
+}  // namespace
+
+std::vector<TermID> BuildPrimaryOutputClauses::collectInputs(
+    const DNLModelClasses& classes) {
+  const DNLFull* dnl = dnl_;
+  DNLInstanceFull top = dnl->getTop();
+  std::vector<uint8_t> picked(dnl->getNBterms(), 0);
+
+  for (DNLID termId = top.getTermIndexes().first;
+       termId != DNLID_MAX && termId <= top.getTermIndexes().second; termId++) {
+    const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
+    if (term.getSnlBitTerm()->getDirection() != SNLBitTerm::Direction::Output) {
+      DEBUG_LOG("Collecting input %s\n",
+                term.getSnlBitTerm()->getName().getString().c_str());
+      picked[termId] = 1;
     }
   }
-  std::set<DNLID> inputSet(inputs.begin(), inputs.end());
-  inputs.clear();
-  inputs.assign(inputSet.begin(), inputSet.end());
+  pickLeafTerms(*dnl, classes, DNLModelClasses::kPrimaryInput, picked);
+  auto inputs = pickedTerms(picked);
   DEBUG_LOG("Collected %zu inputs\n", inputs.size());
   return inputs;
 }
 
-std::vector<DNLID> BuildPrimaryOutputClauses::collectOutputs() {
-  std::vector<DNLID> outputs;
-  std::set<DNLID> outputsSet;
-  auto dnl = get();
+std::vector<TermID> BuildPrimaryOutputClauses::collectOutputs(
+    const DNLModelClasses& classes) {
+  const DNLFull* dnl = dnl_;
   DNLInstanceFull top = dnl->getTop();
+  std::vector<uint8_t> picked(dnl->getNBterms(), 0);
 
   for (DNLID termId = top.getTermIndexes().first;
        termId != DNLID_MAX && termId <= top.getTermIndexes().second; termId++) {
     const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
     if (term.getSnlBitTerm()->getDirection() != SNLBitTerm::Direction::Input) {
-      outputsSet.insert(termId);
+      picked[termId] = 1;
       DEBUG_LOG(
           "Collecting top output %s of model %s\n",
           term.getSnlBitTerm()->getName().getString().c_str(),
           term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
     }
   }
-  for (DNLID leaf : dnl->getLeaves()) {
-    DNLInstanceFull instance = dnl->getDNLInstanceFromID(leaf);
-    bool isSequential = false;
-    std::vector<SNLBitTerm*> seqBitTerms;
-
-    for (DNLID termId = instance.getTermIndexes().first;
-         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-         termId++) {
-      const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-      auto related =
-          SNLDesignModeling::getClockRelatedInputs(term.getSnlBitTerm());
-      if (!related.empty()) {
-        isSequential = true;
-        for (auto bitTerm : related) {
-          seqBitTerms.push_back(bitTerm);
-        }
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Output) {
-          outputsSet.insert(termId);
-          DEBUG_LOG(
-              "Collecting seq output %s of model %s\n",
-              term.getSnlBitTerm()->getName().getString().c_str(),
-              term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
-        }
-      }
-    }
-
-    if (!isSequential) {
-      for (DNLID termId = instance.getTermIndexes().first;
-           termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-           termId++) {
-        const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Output) {
-          auto deps =
-              SNLDesignModeling::getCombinatorialOutputs(term.getSnlBitTerm());
-          // Collect all tt on the model
-          std::vector<SNLTruthTable> tts;
-          for (DNLID tId = instance.getTermIndexes().first;
-               tId != DNLID_MAX && tId <= instance.getTermIndexes().second;
-               tId++) {
-            const DNLTerminalFull& tTerm = dnl->getDNLTerminalFromID(tId);
-            // If direction is input, skip
-            if (tTerm.getSnlBitTerm()->getDirection() ==
-                SNLBitTerm::Direction::Input) {
-              continue;
-            }
-            const auto& tt = SNLDesignModeling::getTruthTable(tTerm.getSnlBitTerm()->getDesign(), 
-              tTerm.getSnlBitTerm()->getOrderID());
-            if (tt.isInitialized()) {
-              tts.push_back(tt);
-              // print deps
-              for (const auto& d : tt.getDependencies()) {
-                DEBUG_LOG("TT deps: %llu\n", d);
-              }
-            } else if (tt.all0() || tt.all1()) {
-              tts.push_back(tt);
-            }
-          }
-          bool inTermInTTDeps = false;
-          for (const auto& tt : tts) {
-            const auto& ttDeps =
-                tt.getDependencies();  // expect std::vector<uint64_t>
-            uint64_t orderID =
-                term.getSnlBitTerm()->getOrderID();  // assume 0-based
-
-            // If orderID is 1-based, uncomment:
-            // if (orderID > 0) --orderID;
-
-            for (size_t index = 0; index < ttDeps.size(); ++index) {
-              uint64_t d = ttDeps[index];
-
-              uint64_t blockMin = index * 64ULL;     // inclusive
-              uint64_t blockMax = blockMin + 64ULL;  // exclusive
-
-              // If orderID is before this block, nothing more to find
-              if (orderID < blockMin) {
-                break;
-              }
-
-              // Skip if orderID beyond this block
-              if (orderID >= blockMax) {
-                continue;
-              }
-
-              uint64_t localBit = orderID - blockMin;  // 0..63
-
-              // std::printf("TT deps: %llu\n", static_cast<unsigned long
-              // long>(d)); std::printf("d = %llu, orderID = %llu, index = %zu,
-              // localBit = %llu\n",
-              //  static_cast<unsigned long long>(d),
-              //  static_cast<unsigned long long>(orderID),
-              //  index,
-              //  static_cast<unsigned long long>(localBit));
-
-              // Defensive: check localBit < 64
-              if (localBit >= 64) {
-                // std::fprintf(stderr, "localBit out of range: %llu\n",
-                //             static_cast<unsigned long long>(localBit));
-                break;
-              }
-
-              // Correct shift using 1ULL and parentheses
-              uint64_t mask = (1ULL << localBit);
-              // std::printf("mask = 0x%llx\n", static_cast<unsigned long
-              // long>(mask));
-
-              if ((d & mask) != 0ULL) {
-                inTermInTTDeps = true;
-              }
-
-              // we handled the block which contains orderID; stop scanning
-              // ttDeps
-              break;
-            }
-
-            if (inTermInTTDeps) {
-              // Found — act and break outer loop if that's desired
-              // std::puts("Found matching bit in this TT deps");
-              break;
-            }
-          }
-          if (/*deps.empty() &&*/ !inTermInTTDeps) {
-            outputsSet.insert(termId);
-            DEBUG_LOG("Collecting output %s of model %s\n",
-                      term.getSnlBitTerm()->getName().getString().c_str(),
-                      term.getSnlBitTerm()
-                          ->getDesign()
-                          ->getName()
-                          .getString()
-                          .c_str());
-          }
-        }
-      }
-      continue;
-    }
-    for (DNLID termId = instance.getTermIndexes().first;
-         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
-         termId++) {
-      const DNLTerminalFull& term = dnl->getDNLTerminalFromID(termId);
-      if (term.getSnlBitTerm()->getDirection() !=
-          SNLBitTerm::Direction::Output) {
-        if (std::find(seqBitTerms.begin(), seqBitTerms.end(),
-                      term.getSnlBitTerm()) != seqBitTerms.end())
-          outputsSet.insert(termId);
-        DEBUG_LOG(
-            "Collecting seq output %s of model %s\n",
-            term.getSnlBitTerm()->getName().getString().c_str(),
-            term.getSnlBitTerm()->getDesign()->getName().getString().c_str());
-      }
-    }
-  }
-  outputs.clear();
-  outputs.assign(outputsSet.begin(), outputsSet.end());
+  pickLeafTerms(*dnl, classes, DNLModelClasses::kPrimaryOutput, picked);
+  auto outputs = pickedTerms(picked);
+  DEBUG_LOG("Collected %zu outputs\n", outputs.size());
   return outputs;
 }
 
-void BuildPrimaryOutputClauses::collect() {
-  inputs_ = collectInputs();
+void BuildPrimaryOutputClauses::collect(const DNLFull& dnl) {
+  dnl_ = &dnl;
+  checkTermIDs(dnl);
+  // Terminal roles only depend on the cell model: classify every model once.
+  const DNLModelClasses classes(dnl);
+  TermKeys keys(dnl, *paths_);
+  inputs_ = collectInputs(classes);
+  inputs2inputsIDs_.clear();
+  inputs2inputsIDs_.reserve(inputs_.size());
+  for (const auto& input : inputs_) {
+    inputs2inputsIDs_[input] = keys(input);
+  }
   sortInputs();
+  inputsMap_.clear();
   for (const auto& input : inputs_) {
-    std::vector<NLName> path = naja::DNL::get()->getDNLTerminalFromID(input).getDNLInstance().getPath().getPathNames();
-    auto pathIDs = naja::DNL::get()->getDNLTerminalFromID(input).getFullPathIDs();
-    using KeyT = std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>;
-
-    std::vector<NLID::DesignObjectID> ids = {
-         (NLID::DesignObjectID)pathIDs[pathIDs.size()-2],
-          (NLID::DesignObjectID)pathIDs[pathIDs.size()-1] 
-    };
-
-    KeyT key{ path, std::move(ids) };
-    inputsMap_[std::move(key)]  =
-            input;
+    inputsMap_[inputs2inputsIDs_.at(input)] = input;
+  }
+  outputs_ = collectOutputs(classes);
+  outputs2outputsIDs_.clear();
+  outputs2outputsIDs_.reserve(outputs_.size());
+  for (const auto& output : outputs_) {
+    outputs2outputsIDs_[output] = keys(output);
   }
-  outputs_ = collectOutputs();
   sortOutputs();
+  outputsMap_.clear();
   for (const auto& output : outputs_) {
-    std::vector<NLName> path = naja::DNL::get()->getDNLTerminalFromID(output).getDNLInstance().getPath().getPathNames();
-    auto pathIDs = naja::DNL::get()->getDNLTerminalFromID(output).getFullPathIDs();
-    using KeyT = std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>;
-
-    std::vector<NLID::DesignObjectID> ids = {
-         (NLID::DesignObjectID)pathIDs[pathIDs.size()-2],
-          (NLID::DesignObjectID)pathIDs[pathIDs.size()-1] 
-    };
-
-    KeyT key{ path, std::move(ids) };
-    outputsMap_[std::move(key)]  =
-            output;
-    DEBUG_LOG("Output collected: %s\n", naja::DNL::get()
-                                         ->getDNLTerminalFromID(output)
+    outputsMap_[outputs2outputsIDs_.at(output)] = output;
+    DEBUG_LOG("Output collected: %s\n", dnl
+                                         .getDNLTerminalFromID(output)
                                          .getSnlBitTerm()
                                          ->getName()
                                          .getString()
@@ -372,15 +258,13 @@ void BuildPrimaryOutputClauses::collect() {
   POs_.resize(outputs_.size());
 }
 
-void BuildPrimaryOutputClauses::initVarNames() {
-  termDNLID2varID_.resize(naja::DNL::get()->getDNLTerms().size(), (size_t)-1);
+void BuildPrimaryOutputClauses::initVarNames(
+    const DNLTermAttributes& attributes) {
+  termDNLID2varID_.resize(dnl_->getDNLTerms().size(), kNoVarID);
   for (size_t i = 0; i < inputs_.size(); ++i) {
-    // Get Truth Table for terminal
-    const DNLTerminalFull& tTerm = naja::DNL::get()->getDNLTerminalFromID(inputs_[i]);
     // If direction is input, skip
-    if (!tTerm.isTopPort()) {
-      const auto& tt = SNLDesignModeling::getTruthTable(tTerm.getSnlBitTerm()->getDesign(), 
-      tTerm.getSnlBitTerm()->getOrderID());
+    if (!attributes.isTopPort(inputs_[i])) {
+      const auto& tt = attributes.getTruthTable(inputs_[i]);
       if (tt.isInitialized()) {
         if (tt.all0()) {
           termDNLID2varID_[inputs_[i]] = 0;
@@ -394,13 +278,110 @@ void BuildPrimaryOutputClauses::initVarNames() {
     termDNLID2varID_[inputs_[i]] =
         i + 2;  // +2 to avoid 0 and 1 which are reserved for constants
   }
+  // Case analysis on PIs: the constrained input becomes the constant itself.
+  for (const auto& [driver, value] : caseDrivers_) {
+    if (termDNLID2varID_[driver] != kNoVarID) {
+      termDNLID2varID_[driver] = value ? 1 : 0;
+    }
+  }
+}
+
+std::vector<std::pair<DNLID, bool>>
+BuildPrimaryOutputClauses::resolveCaseConstants(
+    const DNLFaninGraph& graph,
+    const DNLTermSet& piSet) const {
+  std::vector<std::pair<DNLID, bool>> drivers;
+  if (caseConstants_.empty()) {
+    return drivers;
+  }
+  // instance path ("" for the top) -> (terminal name, index in caseConstants_)
+  std::map<std::string, std::vector<std::pair<std::string, size_t>>> byInstance;
+  for (size_t i = 0; i < caseConstants_.size(); ++i) {
+    const std::string& pin = caseConstants_[i].first;
+    const size_t slash = pin.rfind('/');
+    if (slash == std::string::npos) {
+      byInstance[""].emplace_back(pin, i);
+    } else {
+      byInstance[pin.substr(0, slash)].emplace_back(pin.substr(slash + 1), i);
+    }
+  }
+  std::vector<bool> matched(caseConstants_.size(), false);
+  const DNLFull* dnl = dnl_;
+  for (const auto& instance : dnl->getDNLInstances()) {
+    std::string path;
+    for (const auto& name : instance.getPath().getPathNames()) {
+      if (!path.empty()) {
+        path += '/';
+      }
+      path += name.getString();
+    }
+    auto it = byInstance.find(path);
+    if (it == byInstance.end()) {
+      continue;
+    }
+    for (DNLID termId = instance.getTermIndexes().first;
+         termId != DNLID_MAX && termId <= instance.getTermIndexes().second;
+         termId++) {
+      const SNLBitTerm* bitTerm = dnl->getDNLTerminalFromID(termId).getSnlBitTerm();
+      const std::string name = bitTerm->getName().getString();
+      const std::string bitName =
+          name + "[" + std::to_string(bitTerm->getBit()) + "]";
+      for (const auto& [pin, index] : it->second) {
+        if (pin != name && pin != bitName) {
+          continue;
+        }
+        matched[index] = true;
+        // A PI is its own driver, any other pin is held by its net driver.
+        DNLID driver = termId;
+        if (!piSet.contains(termId)) {
+          const auto isoDrivers = graph.getDrivers(termId);
+          if (isoDrivers.size() != 1) {
+            // LCOV_EXCL_START
+            throw std::runtime_error("Case analysis pin '" +
+                                     caseConstants_[index].first +
+                                     "' does not have a single driver");
+            // LCOV_EXCL_STOP
+          }
+          driver = isoDrivers.front();
+        }
+        drivers.emplace_back(driver, caseConstants_[index].second);
+      }
+    }
+  }
+  for (size_t i = 0; i < caseConstants_.size(); ++i) {
+    if (!matched[i]) {
+      throw std::runtime_error("Case analysis pin '" + caseConstants_[i].first +
+                               "' not found in design");
+    }
+  }
+  std::sort(drivers.begin(), drivers.end());
+  for (size_t i = 1; i < drivers.size(); ++i) {
+    if (drivers[i].first == drivers[i - 1].first) {
+      throw std::runtime_error(
+          "Case analysis forces the same net to both 0 and 1");
+    }
+  }
+  return drivers;
 }
 
 void BuildPrimaryOutputClauses::build() {
-  naja::DNL::get();
+  build(*naja::DNL::get());
+  destroy();  // Clean up DNL instance
+}
+
+void BuildPrimaryOutputClauses::build(const DNLFull& dnl, bool deferConvert) {
+  dnl_ = &dnl;
+  clouds_.clear();
+  poCosts_.clear();
   POs_.clear();
   POs_ = tbb::concurrent_vector<std::shared_ptr<BoolExpr>>(outputs_.size());
-  initVarNames();
+  // Flattened fan-in of the DNL and PI/PO membership, shared read-only by
+  // all the traversals
+  const DNLFaninGraph faninGraph(dnl);
+  const DNLTermSet piSet(dnl.getNBterms(), inputs_);
+  const DNLTermSet poSet(dnl.getNBterms(), outputs_);
+  caseDrivers_ = resolveCaseConstants(faninGraph, piSet);
+  initVarNames(faninGraph.getAttributes());
   // Init var names(counting on the fact that normalization happened before)
 
   // inputs_ = collectInputs();
@@ -408,100 +389,98 @@ void BuildPrimaryOutputClauses::build() {
   // outputs_ = collectOutputs();
   // sortOutputs();
   size_t processedOutputs = 0;
-  // tbb::task_arena arena(20);
-  //  init arena with automatic number of threads
-  tbb::task_arena arena(40);
+  tbb::task_arena arena(static_cast<int>(resolveThreadCount(threads_)));
+  // Nets made constant by tie cells or by the case analysis: cones stop
+  // there and the logic they control away is never expanded.
+  DNLConstantPropagation constants(dnl, faninGraph, piSet);
+  for (const auto& [driver, value] : caseDrivers_) {
+    constants.setConstant(driver, value);
+  }
+  constants.run();
+  constants.bindVarNames(termDNLID2varID_);
+  DEBUG_LOG("Constant drivers: %zu\n", constants.getConstants().size());
+  // KEPLER_SHARED_DAG converts every driver of the netlist once into a shared
+  // expression DAG instead of building one cloud per PO.
+  if (getenv("KEPLER_SHARED_DAG")) {
+    SNLLogicDAG dag(inputs_, outputs_, termDNLID2varID_, &faninGraph);
+    dag.setConstants(&constants);
+    arena.execute([&]() { dag.compute(); });
+    DEBUG_LOG("Shared DAG: %zu drivers on %zu levels\n", dag.getNumDrivers(),
+              dag.getNumLevels());
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      POs_[i] = dag.getPOExpr(i);
+    }
+    return;
+  }
+  // KEPLER_KEEP_BUFFERS expands buffers and inverters as Table nodes instead
+  // of skipping them, to measure what the bypass saves.
+  const bool keepBuffers = getenv("KEPLER_KEEP_BUFFERS") != nullptr;
+  // Cheap cone size estimate, used to start the largest cones first.
+  poCosts_.assign(outputs_.size(), 0);
+  arena.execute([&]() {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, outputs_.size()),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i < r.end(); ++i) {
+                          poCosts_[i] = estimateConeCost(
+                              outputs_[i], faninGraph, piSet, constants,
+                              !keepBuffers);
+                        }
+                      });
+  });
+  // KEPLER_DUMP_CLOUDS=<dir> writes every cone to <dir>/<top>_<index>.kcloud
+  // for offline replay with kepler-replay; KEPLER_DUMP_PO=<text> restricts
+  // the dump to the POs whose path key contains <text>.
+  const char* dumpDir = getenv("KEPLER_DUMP_CLOUDS");
+  const char* dumpFilter = getenv("KEPLER_DUMP_PO");
+  // KEPLER_COLLAPSE_TABLES merges small Table subtrees into composite tables
+  // before conversion (dumps keep the uncollapsed cone).
+  const bool collapseTables = getenv("KEPLER_COLLAPSE_TABLES") != nullptr;
+  // KEPLER_CONE_CACHE[=<fanout>] shares the converted sub-cones of drivers
+  // with more than <fanout> readers (default 4) between PO clouds. Dumped
+  // clouds must be self-contained, so the cache is off while dumping.
+  std::unique_ptr<SharedConeCache> coneCache;
+  if (const char* minFanout = getenv("KEPLER_CONE_CACHE");
+      minFanout != nullptr && dumpDir == nullptr) {
+    coneCache = std::make_unique<SharedConeCache>(
+        faninGraph,
+        *minFanout != '\0' ? std::strtoull(minFanout, nullptr, 10) : 4);
+    deferConvert = false;
+  }
+  if (deferConvert) {
+    clouds_.resize(outputs_.size());
+  }
   auto processOutput = [&](size_t i) {
     DNLID out = outputs_[i];
     DEBUG_LOG("Procssing output %zu/%zu: %s\n", ++processedOutputs,
            outputs_.size(),
-           get()
-               ->getDNLTerminalFromID(out)
+           dnl.getDNLTerminalFromID(out)
                .getSnlBitTerm()
                ->getName()
                .getString()
                .c_str());
 
-    SNLLogicCloud cloud(out, inputs_, outputs_);
+    SNLLogicCloud cloud(out, piSet, poSet, faninGraph, coneCache.get());
+    cloud.setBypassBuffers(!keepBuffers);
+    cloud.setConstants(&constants);
     cloud.compute();
-    // //cloud.getTruthTable().print();
-    // std::vector<DNLID> test1;
-    // std::vector<DNLID> test2;
-    // for (auto in : cloud.getAllInputs()) {
-    //   printf("Input in tree cloud: %lu\n", in);
-    //   // if (in >= cloud.getInputs().size()) {
-    //   //   printf("size of inputs in cloud: %lu\n",
-    //   cloud.getInputs().size());
-    //   //   //assert(false && "Input in cloud is out of range");
-    //   // }
-    //  test1.push_back(in);
-    // }
-    // for (auto in : cloud.getInputs()) {
-    //   printf("Input in cloud: %lu\n", in);
-    //   test2.push_back(in);
-    // }
-    // std::sort(test1.begin(), test1.end());
-    // std::sort(test2.begin(), test2.end());
-    // assert(test1 == test2);
-    // std::vector<std::string> varNames;
-    /*for (auto input : cloud.getInputs()) {
-      DNLTerminalFull term = get()->getDNLTerminalFromID(input);
-      if (term.getSnlTerm() != nullptr) {
-        auto net = term.getSnlTerm()->getNet();
-        if (net != nullptr) {
-          if (net->isConstant0()) {
-            varNames.push_back("0");
-            continue;
-          } else if (net->isConstant1()) {
-            varNames.push_back("1");
-            continue;
-          }
-        }
-        auto model = const_cast<SNLDesign*>(
-            term.getSnlBitTerm()->getDesign());
-        auto tt = model->getTruthTable(term.getSnlBitTerm()->getOrderID());
-        if (tt.isInitialized()) {
-          if (tt.all0()) {
-            varNames.push_back("0");
-            continue;
-          } else if (tt.all1()) {
-            varNames.push_back("1");
-            continue;
-          }
-        }
-      }
-      // find the index of input in inputs_
-      auto it = std::find(inputs_.begin(), inputs_.end(), input);
-      // printf("Input: %s\n",
-      //
-    get()->getDNLTerminalFromID(input).getSnlBitTerm()->getName().getString().c_str());
-      // printf("Model: %s\n",
-      //
-    get()->getDNLTerminalFromID(input).getSnlBitTerm()->getDesign()->getName().getString().c_str());
-      assert(it != inputs_.end());
-      size_t index = std::distance(inputs_.begin(), it);
-      varNames.push_back(std::to_string(index + 2)); // +2 to avoid 0 and 1
-    which are reserved for constants
-    }*/
 #ifdef DEBUG_CHECKS
     assert(cloud.getTruthTable().isInitialized());
 #endif
-    // DEBUG_LOG("Truth Table: %s\n",
-    //           cloud.getTruthTable().print().c_str());
-    /*std::shared_ptr<BoolExpr> expr = Tree2BoolExpr::convert(
-        cloud.getTruthTable(), varNames);*/
-    // BoolExpr::getMutex().lock();
-    //  if (POs_.size() - 1 < i) {
-    //    for (size_t j = POs_.size(); j <= i; ++j) {
-    //      POs_.push_back(nullptr);
-    //    }
-    //  }
     assert(POs_.size() - 1 >= i);
     cloud.getTruthTable().finalize();
-    POs_[i] = Tree2BoolExpr::convert(cloud.getTruthTable(), termDNLID2varID_);
+    if (dumpDir != nullptr) {
+      dumpCloud(std::string(dumpDir), dumpFilter, i, cloud.getTruthTable());
+    }
+    if (collapseTables) {
+      cloud.getTruthTable().collapse();
+    }
+    if (deferConvert) {
+      clouds_[i] = std::move(cloud.getTruthTable());
+      return;
+    }
+    POs_[i] = Tree2BoolExpr::convert(cloud.getTruthTable(), termDNLID2varID_,
+                                     coneCache.get());
     cloud.destroy();
-    // BoolExpr::getMutex().unlock();
-    // printf("size of expr: %lu\n", POs_.back()->size());
   };
 
   if (getenv("KEPLER_NO_MT")) {
@@ -509,69 +488,64 @@ void BuildPrimaryOutputClauses::build() {
       processOutput(i);
     }
   } else {
-    tbb::parallel_for(tbb::blocked_range<DNLID>(0, outputs_.size(), 100),
-                      [&](const tbb::blocked_range<DNLID>& r) {
-                        for (DNLID i = r.begin(); i < r.end(); ++i) {
-                          processOutput(i);
-                        }
-                      });
+    runInOrder(arena, largestFirst(poCosts_), processOutput);
   }
-  destroy();  // Clean up DNL instance
 }
 
-void BuildPrimaryOutputClauses::setInputs2InputsIDs() {
-  inputs2inputsIDs_.clear();
-  for (const auto& input : inputs_) {
-    if (get()->getDNLTerminalFromID(input).isNull()) {
-      throw std::runtime_error("Input terminal is null");
-    }
-    DNLInstanceFull currentInstance =
-        get()->getDNLTerminalFromID(input).getDNLInstance();
-   
-    std::vector<NLID::DesignObjectID> termIDs;
-    termIDs.push_back(
-        get()->getDNLTerminalFromID(input).getSnlBitTerm()->getID());
-    termIDs.push_back(
-        get()->getDNLTerminalFromID(input).getSnlBitTerm()->getBit());
-    std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>
-      pair;
-    pair.first = currentInstance.getPath().getPathNames();
-    pair.second = termIDs;
-    inputs2inputsIDs_[input] = pair;
+void BuildPrimaryOutputClauses::convertPO(size_t index) {
+  POs_[index] = Tree2BoolExpr::convert(clouds_[index], termDNLID2varID_);
+  clouds_[index].destroy();
+}
+
+void BuildPrimaryOutputClauses::dumpCloud(const std::string& dir,
+                                          const char* filter,
+                                          size_t outputIndex,
+                                          const SNLTruthTableTree& tree) const {
+  std::string name =
+      pathKey(*paths_, outputs2outputsIDs_, outputs_[outputIndex]);
+  if (filter != nullptr && name.find(filter) == std::string::npos)
+    return;
+  std::string top = NLUniverse::get()->getTopDesign()->getName().getString();
+  std::string fileName =
+      dir + "/" + top + "_" + std::to_string(outputIndex) + ".kcloud";
+  std::ofstream out(fileName, std::ios::binary);
+  if (!out) {
+    // LCOV_EXCL_START
+    throw std::runtime_error("Cannot open cloud dump file " + fileName);
+    // LCOV_EXCL_STOP
   }
+  SNLLogicCloudDump::write(out, name, tree, termDNLID2varID_,
+                           [this](DNLID term) {
+                             return pathKey(*paths_, inputs2inputsIDs_,
+                                            toTermID(term));
+                           });
+}
+
+void BuildPrimaryOutputClauses::setInputs2InputsIDs() {
+  // Keys were computed by collect; keep those of the retained inputs.
+  const std::unordered_set<TermID> retained(inputs_.begin(), inputs_.end());
+  std::erase_if(inputs2inputsIDs_,
+                [&](const auto& entry) { return !retained.contains(entry.first); });
 }
 
 void BuildPrimaryOutputClauses::setOutputs2OutputsIDs() {
-  outputs2outputsIDs_.clear();
-  for (const auto& output : outputs_) {
-    std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>> path;
-    std::vector<NLID::DesignObjectID> termIDs;
-    DNLInstanceFull currentInstance =
-        get()->getDNLTerminalFromID(output).getDNLInstance();
-    termIDs.push_back(
-        get()->getDNLTerminalFromID(output).getSnlBitTerm()->getID());
-    termIDs.push_back(
-        get()->getDNLTerminalFromID(output).getSnlBitTerm()->getBit());
-    std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>
-      pair;
-    pair.first = currentInstance.getPath().getPathNames();
-    pair.second = termIDs;
-    outputs2outputsIDs_[output] = pair;
-  }
+  const std::unordered_set<TermID> retained(outputs_.begin(), outputs_.end());
+  std::erase_if(outputs2outputsIDs_,
+                [&](const auto& entry) { return !retained.contains(entry.first); });
 }
 
 void BuildPrimaryOutputClauses::sortInputs() {
-  // Sort based on inputs2inputsIDs_ content
+  // Sort on the interned keys: integer comparisons only
   std::sort(inputs_.begin(), inputs_.end(),
-            [this](const DNLID& a, const DNLID& b) {
-              return inputs2inputsIDs_[a].first < inputs2inputsIDs_[b].first;
+            [this](TermID a, TermID b) {
+              return inputs2inputsIDs_.at(a) < inputs2inputsIDs_.at(b);
             });
 }
 
 void BuildPrimaryOutputClauses::sortOutputs() {
-  // Sort based on outputs2outputsIDs_ content
-  std::sort(
-      outputs_.begin(), outputs_.end(), [this](const DNLID& a, const DNLID& b) {
-        return outputs2outputsIDs_[a].first < outputs2outputsIDs_[b].first;
-      });
-}
\ No newline at end of file
+  // Sort on the interned keys: integer comparisons only
+  std::sort(outputs_.begin(), outputs_.end(),
+            [this](TermID a, TermID b) {
+              return outputs2outputsIDs_.at(a) < outputs2outputsIDs_.at(b);
+            });
+}
@@ -2,76 +2,133 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include <tbb/concurrent_vector.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "BoolExpr.h"
 #include "DNL.h"
+#include "PathTrie.h"
+#include "SNLTruthTableTree.h"
+#include "TermID.h"
 
 #pragma once
 
 namespace KEPLER_FORMAL {
 
+class DNLFaninGraph;
+class DNLModelClasses;
+class DNLTermAttributes;
+class DNLTermSet;
+
 class BuildPrimaryOutputClauses {
  public:
+  /// Case analysis: pins held at a constant value. A pin is named by its
+  /// instance path and terminal name ("scan_en", "u_core/u_mux/S"), with an
+  /// optional "[bit]"; a bus name alone covers all its bits.
+  using CaseConstants = std::vector<std::pair<std::string, bool>>;
+  using TermKeyMap = std::unordered_map<TermPathKey, TermID, TermPathKeyHash>;
+
   BuildPrimaryOutputClauses() = default;
-  void collect();
+  /// build forces the net driving each pin; constrained PIs get the 0/1
+  /// variable slots and the constants are propagated before the cones are
+  /// built. Every pin must exist in the design.
+  void setCaseConstants(const CaseConstants& constants) {
+    caseConstants_ = constants;
+  }
+  /// Worker count of build, 0 (default) for resolveThreadCount().
+  void setThreads(size_t threads) { threads_ = threads; }
+  /// Collect the PIs and POs of `dnl` and their path keys. `dnl` must be the
+  /// current naja::DNL (terminal to instance lookups go through it).
+  void collect(const naja::DNL::DNLFull& dnl);
+  /// Build the PO expressions on `dnl`, the DNL collect ran on or a rebuild
+  /// of the same design; it is left alive for the caller.
+  void build(const naja::DNL::DNLFull& dnl) { build(dnl, false); }
+  /// Like build(dnl) but only the PO clouds are computed; convertPO then
+  /// turns them into the POs without the DNL, so the POs of several builders
+  /// can be converted in one parallel pool. With KEPLER_SHARED_DAG or
+  /// KEPLER_CONE_CACHE (the cache needs each conversion before the next
+  /// clouds) the POs are built right away and nothing is deferred.
+  void prepare(const naja::DNL::DNLFull& dnl) { build(dnl, true); }
+  size_t getNumDeferredPOs() const { return clouds_.size(); }
+  /// Estimated cone size of each PO (capped), computed by build/prepare.
+  const std::vector<size_t>& getPOCosts() const { return poCosts_; }
+  /// Convert deferred cloud `index` into getPOs()[index] and free it. Distinct
+  /// indexes can be converted concurrently, inside a task arena.
+  void convertPO(size_t index);
+  /// Same on naja::DNL::get(); build() then destroys the DNL.
+  void collect() { collect(*naja::DNL::get()); }
   void build();
 
   const tbb::concurrent_vector<std::shared_ptr<BoolExpr>>& getPOs() const {
     return POs_;
   }
-  const std::vector<naja::DNL::DNLID>& getInputs() const { return inputs_; }
-  const std::vector<naja::DNL::DNLID>& getOutputs() const { return outputs_; }
-  const std::map<naja::DNL::DNLID,
-                 std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>>&
-  getInputs2InputsIDs() const {
+  const std::vector<TermID>& getInputs() const { return inputs_; }
+  const std::vector<TermID>& getOutputs() const { return outputs_; }
+  /// Terminal -> interned path key, for the inputs and the outputs.
+  const std::unordered_map<TermID, TermPathKey>& getInputs2InputsIDs() const {
     return inputs2inputsIDs_;
   }
-  const std::map<naja::DNL::DNLID,
-                 std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>>&
-  getOutputs2OutputsIDs() const {
+  const std::unordered_map<TermID, TermPathKey>& getOutputs2OutputsIDs()
+      const {
     return outputs2outputsIDs_;
   }
-  void setInputs(const std::vector<naja::DNL::DNLID>& inputs) {
+  /// Replace the inputs/outputs by a subset of the collected ones (e.g. after
+  /// normalization); no DNL is needed.
+  void setInputs(const std::vector<TermID>& inputs) {
     inputs_ = inputs; /*sortInputs();*/
     setInputs2InputsIDs();
   }
-  void setOutputs(const std::vector<naja::DNL::DNLID>& outputs) {
+  void setOutputs(const std::vector<TermID>& outputs) {
     outputs_ = outputs; /*sortOutputs();*/
     setOutputs2OutputsIDs();
   }
-  const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-  getInputsMap() const {
-    return inputsMap_;
-  }
-  const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-  getOutputsMap() const {
-    return outputsMap_;
-  }
+  /// Interned path key -> terminal, for the inputs and the outputs.
+  const TermKeyMap& getInputsMap() const { return inputsMap_; }
+  const TermKeyMap& getOutputsMap() const { return outputsMap_; }
+  /// Trie the path keys are interned in. Builders of the two designs of a
+  /// miter share one, so that equal paths get equal keys; set it before
+  /// collect.
+  void setPathTrie(std::shared_ptr<PathTrie> paths) { paths_ = std::move(paths); }
+  const PathTrie& getPathTrie() const { return *paths_; }
   naja::DNL::DNLID getDNLIDforOutput(size_t index) const {
-    return outputs_[index];
+    return toDNLID(outputs_[index]);
   }
 
  private:
-  std::vector<naja::DNL::DNLID> collectInputs();
+  std::vector<TermID> collectInputs(const DNLModelClasses& classes);
   void setInputs2InputsIDs();
   void sortInputs();
-  std::vector<naja::DNL::DNLID> collectOutputs();
+  std::vector<TermID> collectOutputs(const DNLModelClasses& classes);
   void setOutputs2OutputsIDs();
   void sortOutputs();
-  void initVarNames();
+  void initVarNames(const DNLTermAttributes& attributes);
+  void build(const naja::DNL::DNLFull& dnl, bool deferConvert);
+  // Driver terminals of the case analysis pins with their values.
+  std::vector<std::pair<naja::DNL::DNLID, bool>> resolveCaseConstants(
+      const DNLFaninGraph& graph,
+      const DNLTermSet& piSet) const;
+  void dumpCloud(const std::string& dir,
+                 const char* filter,
+                 size_t outputIndex,
+                 const SNLTruthTableTree& tree) const;
 
+  const naja::DNL::DNLFull* dnl_ = nullptr;  // DNL of the running phase
   tbb::concurrent_vector<std::shared_ptr<BoolExpr>> POs_;
-  std::vector<naja::DNL::DNLID> inputs_;
-  std::vector<naja::DNL::DNLID> outputs_;
-  std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID> inputsMap_;
-  std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID> outputsMap_;
-  std::map<naja::DNL::DNLID,
-           std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>>
-      inputs2inputsIDs_;
-  std::map<naja::DNL::DNLID,
-           std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>>
-      outputs2outputsIDs_;
-  std::vector<size_t> termDNLID2varID_;  // Only for PIs
+  std::vector<TermID> inputs_;
+  std::vector<TermID> outputs_;
+  std::shared_ptr<PathTrie> paths_ = std::make_shared<PathTrie>();
+  TermKeyMap inputsMap_;
+  TermKeyMap outputsMap_;
+  std::unordered_map<TermID, TermPathKey> inputs2inputsIDs_;
+  std::unordered_map<TermID, TermPathKey> outputs2outputsIDs_;
+  std::vector<VarID> termDNLID2varID_;  // Only for PIs
+  std::vector<SNLTruthTableTree> clouds_;  // deferred by prepare
+  std::vector<size_t> poCosts_;
+  size_t threads_ = 0;
+  CaseConstants caseConstants_;
+  std::vector<std::pair<naja::DNL::DNLID, bool>> caseDrivers_;
 };
 
 }  // namespace KEPLER_FORMAL
\ No newline at end of file
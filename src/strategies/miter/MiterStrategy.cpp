@@ -4,9 +4,12 @@
 #include "MiterStrategy.h"
 #include "BoolExpr.h"
 #include "BuildPrimaryOutputClauses.h"
+#include "DNLFaninGraph.h"
 #include "NLUniverse.h"
+#include "ParallelSchedule.h"
 #include "SNLDesignModeling.h"
 #include "SNLLogicCloud.h"
+#include "TseitinEncoder.h"
 
 // include Glucose headers (adjust path to your checkout)
 #include "core/Solver.h"
@@ -20,8 +23,14 @@
 #include "SNLPath.h"
 
 // For executeCommand
+#include <algorithm>
+#include <array>
 #include <cstdlib>
+#include <numeric>
 #include <stack>
+#include <unordered_set>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 // spdlog
 #include <spdlog/sinks/basic_file_sink.h>
@@ -142,216 +151,172 @@ void ensureLoggerInitialized() {
 //   }
 // }
 
-//
-// A tiny Tseitin-translator from BoolExpr -> Glucose CNF.
-//
-// Returns a Glucose::Lit that stands for `e`, and adds
-// all necessary clauses to S so that Lit ↔ (e) holds.
-//
-// node2var      caches each subformula’s fresh variable index.
-// varName2idx   coalesces all inputs of the same name to one var.
-//
-
-Glucose::Lit tseitinEncode(
-    Glucose::SimpSolver& S,
-    std::shared_ptr<BoolExpr> root,
-    std::unordered_map<std::shared_ptr<BoolExpr>, int>& node2var,
-    std::unordered_map<std::string, int>& varName2idx) {
-  ensureLoggerInitialized();
-  logger->debug("Starting Tseitin encode for root expr");
-
-  auto getOrCreateVar = [&](const std::string& key) -> int {
-    auto it = varName2idx.find(key);
-    if (it != varName2idx.end())
-      return it->second;
-    int v = S.newVar();
-    varName2idx[key] = v;
-    logger->trace("Created new var {} for key '{}'", v, key);
-    return v;
-  };
+}  // namespace
 
-  auto constLit = [&](bool value) -> Glucose::Lit {
-    const std::string key = value ? "$__CONST_TRUE__" : "$__CONST_FALSE__";
-    int v = getOrCreateVar(key);
-    Glucose::Lit lv = Glucose::mkLit(v);
-    S.addClause(value ? lv : ~lv);
-    logger->trace("Added constant clause for {} as var {}", value, v);
-    return lv;
-  };
+ MiterStrategy::MiterStrategy(naja::NL::SNLDesign* top0, naja::NL::SNLDesign* top1, const std::string& logFileName, const std::string& prefix)
+      : prefix_(prefix) {
+    top0_ = top0;
+    top1_ = top1;
+    logFileName_ = logFileName;
+  }
 
-  struct Frame {
-    std::shared_ptr<BoolExpr> expr;
-    bool visited = false;
-    Glucose::Lit leftLit, rightLit;
-  };
+namespace {
 
-  std::stack<Frame> stk;
-  stk.push({root, false, {}, {}});
-  std::unordered_map<std::shared_ptr<BoolExpr>, Glucose::Lit> result;
+// Keys of `map` also in `other` (common) or not (diff), each sorted.
+void joinKeys(const BuildPrimaryOutputClauses::TermKeyMap& map,
+              const BuildPrimaryOutputClauses::TermKeyMap& other,
+              std::vector<TermPathKey>* common,
+              std::vector<TermPathKey>& diff) {
+  for (const auto& [key, term] : map) {
+    if (other.contains(key)) {
+      if (common != nullptr)
+        common->push_back(key);
+    } else {
+      diff.push_back(key);
+    }
+  }
+  if (common != nullptr)
+    std::sort(common->begin(), common->end());
+  std::sort(diff.begin(), diff.end());
+}
 
-  while (!stk.empty()) {
-    Frame& fr = stk.top();
-    std::shared_ptr<BoolExpr> e = fr.expr;
+std::string keyString(const PathTrie& paths, const TermPathKey& key) {
+  return paths.getString(key.path, '.') + std::to_string(key.termID) + "." +
+         std::to_string(key.bit);
+}
 
-    // If already encoded, reuse
-    if (node2var.count(e)) {
-      result[e] = Glucose::mkLit(node2var[e]);
-      stk.pop();
-      continue;
-    }
+using Exprs = tbb::concurrent_vector<std::shared_ptr<BoolExpr>>;
+
+// Rough Glucose footprint of one encoded expression node (variable, 3 to 4
+// clauses, watches), used to size the solvers against the memory budget.
+constexpr size_t kSolverBytesPerNode = 256;
+
+struct POCheck {
+  std::vector<size_t> differing;  // differing POs, in order
+  size_t numSolves = 0;
+};
+
+// Check the PO pairs `pos` in one incremental solver. The XOR of each pair
+// is Tseitin-encoded once and its literal is frozen so that it can be
+// assumed; the "any PO differs" clause is guarded by an activation literal
+// that is only assumed in the first solve. Learnt clauses carry over between
+// the checks. A model proves every PO it sets different, so each solve
+// settles a batch of POs and only the POs no model has split yet are solved
+// alone.
+POCheck checkPOs(const std::vector<size_t>& pos,
+                 const Exprs& POs0,
+                 const Exprs& POs1) {
+  POCheck check;
+  Glucose::SimpSolver solver;
+  TseitinEncoder encoder(solver);
+  std::vector<Glucose::Lit> diffs;
+  diffs.reserve(pos.size());
+  const Glucose::Lit anyDiff = Glucose::mkLit(solver.newVar());
+  solver.setFrozen(Glucose::var(anyDiff), true);
+  Glucose::vec<Glucose::Lit> miterClause;
+  miterClause.push(~anyDiff);
+  for (size_t po : pos) {
+    diffs.push_back(encoder.encode(BoolExpr::Xor(POs0[po], POs1[po])));
+    solver.setFrozen(Glucose::var(diffs.back()), true);
+    miterClause.push(diffs.back());
+  }
+  solver.addClause(miterClause);
 
-    // Leaf VAR or CONST
-    if (!fr.visited && e->getOp() == Op::VAR) {
-      const std::string& name = e->getName();
-      Glucose::Lit lit;
-      if (name == "0" || name == "false" || name == "False" || name == "FALSE")
-        lit = constLit(false);
-      else if (name == "1" || name == "true" || name == "True" ||
-               name == "TRUE")
-        lit = constLit(true);
-      else {
-        int v = getOrCreateVar(name);
-        lit = Glucose::mkLit(v);
+  Glucose::vec<Glucose::Lit> assumptions;
+  assumptions.push(anyDiff);
+  ++check.numSolves;
+  if (!solver.solve(assumptions)) {
+    return check;
+  }
+  std::vector<uint8_t> differs(diffs.size(), 0);
+  auto collectDiffs = [&]() {
+    for (size_t j = 0; j < diffs.size(); ++j) {
+      if (solver.modelValue(diffs[j]) == l_True) {
+        differs[j] = 1;
       }
-      node2var[e] = Glucose::var(lit);
-      result[e] = lit;
-      stk.pop();
-      continue;
     }
+  };
+  collectDiffs();
+  for (size_t j = 0; j < diffs.size(); ++j) {
+    if (!differs[j]) {
+      assumptions.clear();
+      assumptions.push(diffs[j]);
+      ++check.numSolves;
+      if (solver.solve(assumptions)) {
+        collectDiffs();
+      }
+    }
+    if (differs[j]) {
+      check.differing.push_back(pos[j]);
+    }
+  }
+  return check;
+}
 
-    // First time we see this node, push children
-    if (!fr.visited) {
-      fr.visited = true;
-      if (e->getRight())
-        stk.push({e->getRight(), false, {}, {}});
-      if (e->getLeft())
-        stk.push({e->getLeft(), false, {}, {}});
+// Support (variable ids, constants excluded) and node count of a XOR b.
+void collectSupport(const std::shared_ptr<BoolExpr>& a,
+                    const std::shared_ptr<BoolExpr>& b,
+                    std::vector<size_t>& support,
+                    size_t& numNodes) {
+  std::unordered_set<const BoolExpr*> seen;
+  std::vector<const BoolExpr*> stk = {a.get(), b.get()};
+  while (!stk.empty()) {
+    const BoolExpr* e = stk.back();
+    stk.pop_back();
+    if (e == nullptr || !seen.insert(e).second) {
       continue;
     }
-
-    // Children have been processed; retrieve their lits
-    if (e->getLeft())
-      fr.leftLit = result[e->getLeft()];
-    if (e->getRight())
-      fr.rightLit = result[e->getRight()];
-
-    // Create fresh var for this gate
-    int v = S.newVar();
-    Glucose::Lit lit_v = Glucose::mkLit(v);
-    node2var[e] = v;
-    result[e] = lit_v;
-
-    logger->trace("Encoding node op={} as var {}", static_cast<int>(e->getOp()),
-                  v);
-
-    // Emit Tseitin clauses
-    switch (e->getOp()) {
-      case Op::NOT:
-        S.addClause(~lit_v, ~fr.leftLit);
-        S.addClause(lit_v, fr.leftLit);
-        break;
-      case Op::AND:
-        S.addClause(~lit_v, fr.leftLit);
-        S.addClause(~lit_v, fr.rightLit);
-        S.addClause(lit_v, ~fr.leftLit, ~fr.rightLit);
-        break;
-      case Op::OR:
-        S.addClause(~fr.leftLit, lit_v);
-        S.addClause(~fr.rightLit, lit_v);
-        S.addClause(~lit_v, fr.leftLit, fr.rightLit);
-        break;
-      case Op::XOR:
-        S.addClause(~lit_v, ~fr.leftLit, ~fr.rightLit);
-        S.addClause(~lit_v, fr.leftLit, fr.rightLit);
-        S.addClause(lit_v, ~fr.leftLit, fr.rightLit);
-        S.addClause(lit_v, fr.leftLit, ~fr.rightLit);
-        break;
-      default:
-        logger->warn("Unhandled operator in tseitinEncode: {}",
-                     static_cast<int>(e->getOp()));
-        break;
+    if (e->getOp() == Op::VAR) {
+      if (e->getId() > 1) {
+        support.push_back(e->getId());
+      }
+      continue;
     }
-
-    stk.pop();
+    stk.push_back(e->getLeft().get());
+    stk.push_back(e->getRight().get());
   }
-
-  logger->debug("Finished Tseitin encode");
-  return result.at(root);
+  numNodes = seen.size() + 1;
 }
 
 }  // namespace
 
- MiterStrategy::MiterStrategy(naja::NL::SNLDesign* top0, naja::NL::SNLDesign* top1, const std::string& logFileName, const std::string& prefix)
-      : prefix_(prefix) {
-    top0_ = top0;
-    top1_ = top1;
-    logFileName_ = logFileName;
-  }
-
 void MiterStrategy::normalizeInputs(
-    std::vector<naja::DNL::DNLID>& inputs0,
-    std::vector<naja::DNL::DNLID>& inputs1,
-    const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-        inputs0Map,
-    const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-        inputs1Map) {
+    std::vector<TermID>& inputs0,
+    std::vector<TermID>& inputs1,
+    const BuildPrimaryOutputClauses::TermKeyMap& inputs0Map,
+    const BuildPrimaryOutputClauses::TermKeyMap& inputs1Map,
+    const PathTrie& paths) {
   ensureLoggerInitialized();
   logger->info("normalizeInputs: starting");
 
-  // find the intersection of inputs0 and inputs1 based on the getFullPathIDs of
-  // DNLTerminal and the diffs
-  
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths0;
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths1;
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> pathsCommon;
-
-  for (const auto& [path0, input0] : inputs0Map) {
-    paths0.insert(path0);
+  // Hash join of the two designs on the interned path keys: common inputs
+  // first, in key order, then the inputs of a single design.
+  std::vector<TermPathKey> pathsCommon;
+  std::vector<TermPathKey> diff0Keys;
+  std::vector<TermPathKey> diff1Keys;
+  joinKeys(inputs0Map, inputs1Map, &pathsCommon, diff0Keys);
+  joinKeys(inputs1Map, inputs0Map, nullptr, diff1Keys);
+  std::vector<TermID> diff0;
+  for (const auto& key : diff0Keys) {
+    diff0.push_back(inputs0Map.at(key));
+    logger->info("diff0 input: {}", paths.getString(key.path, '.'));
   }
-  for (const auto& [path1, input1] : inputs1Map) {
-    paths1.insert(path1);
-  }
-  size_t index = 0;
-  for (const auto& [path0, input0] : inputs0Map) {
-    if (paths1.find(path0) != paths1.end()) {
-      pathsCommon.insert(path0 );
-    }
-  }
-  std::vector<naja::DNL::DNLID> diff0;
-  for (const auto& [path0, input0] : inputs0Map) {
-    if (pathsCommon.find(path0) == pathsCommon.end()) {
-      diff0.push_back(input0);
-      auto pathInstance = path0;
-      std::string pathString = "";
-      for (const auto& name : pathInstance.first) {
-        pathString += name.getString() + ".";
-      }
-      logger->info("diff0 input: {}", pathString);
-    }
-  }
-  std::vector<naja::DNL::DNLID> diff1;
-  for (const auto& [path1, input1] : inputs1Map) {
-    if (pathsCommon.find(path1) == pathsCommon.end()) {
-      diff1.push_back(input1);
-      auto pathInstance = path1;
-      std::string pathString = "";
-      for (const auto& name : pathInstance.first) {
-        pathString += name.getString() + ".";
-      }
-      logger->info("diff1 input: {}", pathString);
-    }
+  std::vector<TermID> diff1;
+  for (const auto& key : diff1Keys) {
+    diff1.push_back(inputs1Map.at(key));
+    logger->info("diff1 input: {}", paths.getString(key.path, '.'));
   }
   inputs0.clear();
-  for (const auto& path : pathsCommon) {
-    inputs0.push_back(inputs0Map.at(path));
+  for (const auto& key : pathsCommon) {
+    inputs0.push_back(inputs0Map.at(key));
   }
   inputs0.insert(inputs0.end(), diff0.begin(), diff0.end());
   for (size_t i = 0; i < inputs0.size(); ++i) {
     logger->info("normalized input0[{}]: DNLID {}", i, inputs0[i]);
   }
   inputs1.clear();
-  for (const auto& path : pathsCommon) {
-    inputs1.push_back(inputs1Map.at(path));
+  for (const auto& key : pathsCommon) {
+    inputs1.push_back(inputs1Map.at(key));
   }
   inputs1.insert(inputs1.end(), diff1.begin(), diff1.end());
   for (size_t i = 0; i < inputs1.size(); ++i) {
@@ -363,126 +328,74 @@ void MiterStrategy::normalizeInputs(
 }
 
 void MiterStrategy::normalizeOutputs(
-    std::vector<naja::DNL::DNLID>& outputs0,
-    std::vector<naja::DNL::DNLID>& outputs1,
-    const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-        outputs0Map,
-    const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>&
-        outputs1Map) {
+    std::vector<TermID>& outputs0,
+    std::vector<TermID>& outputs1,
+    const BuildPrimaryOutputClauses::TermKeyMap& outputs0Map,
+    const BuildPrimaryOutputClauses::TermKeyMap& outputs1Map,
+    const PathTrie& paths) {
   ensureLoggerInitialized();
   logger->debug("normalizeOutputs: starting");
 
-  // find the intersection of outputs0 and outputs1 based on the getFullPathIDs
-  // of DNLTerminal and the diffs
-  
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths0;
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths1;
-  std::set<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> pathsCommon;
-  for (const auto& [path1, output1] : outputs1Map) {
-    paths1.insert(path1);
-  }
-  size_t index = 0;
-  for (const auto& [path0, output0] : outputs0Map) {
-    if (paths1.find(path0) != paths1.end()) {
-      pathsCommon.insert(path0 );
-    }
+  // Hash join on the interned path keys; outputs of a single design are not
+  // compared.
+  std::vector<TermPathKey> pathsCommon;
+  std::vector<TermPathKey> diff0;
+  std::vector<TermPathKey> diff1;
+  joinKeys(outputs0Map, outputs1Map, &pathsCommon, diff0);
+  joinKeys(outputs1Map, outputs0Map, nullptr, diff1);
+  for (const auto& key : diff0) {
+    logger->info("Will ignore the analysis for: {} from netlist 0 as it does not exist in netlist 1", keyString(paths, key));
   }
-  std::vector<naja::DNL::DNLID> diff0;
-  for (const auto& [path0, output0] : outputs0Map) {
-    if (pathsCommon.find(path0) == pathsCommon.end()) {
-      diff0.push_back(output0);
-      std::string fullName;
-      for (const auto& name : path0.first) {
-        fullName += name.getString() + ".";
-      }
-      fullName += std::to_string(path0.second[0]) + ".";
-      fullName += std::to_string(path0.second[1]);
-      logger->info("Will ignore the analysis for: {} from netlist 0 as it does not exist in netlist 1", fullName);
-    }
-  }
-  std::vector<naja::DNL::DNLID> diff1;
-  for (const auto& [path1, output1] : outputs1Map) {
-    if (pathsCommon.find(path1) == pathsCommon.end()) {
-      std::string fullName;
-      for (const auto& name : path1.first) {
-        fullName += name.getString() + ".";
-      }
-      fullName += std::to_string(path1.second[0]) + ".";
-      fullName += std::to_string(path1.second[1]);
-      logger->info("Will ignore the analysis for: {} from netlist 1 as it does not exist in netlist 0", fullName);
-      diff1.push_back(output1);
-    }
+  for (const auto& key : diff1) {
+    logger->info("Will ignore the analysis for: {} from netlist 1 as it does not exist in netlist 0", keyString(paths, key));
   }
+  // Both lists follow the same key order, so outputs0[i] and outputs1[i]
+  // always share their path.
   outputs0.clear();
-  for (const auto& path : pathsCommon) {
-    outputs0.push_back(outputs0Map.at(path));
-  }
-  //outputs0.insert(outputs0.end(), diff0.begin(), diff0.end());
   outputs1.clear();
-  for (const auto& path : pathsCommon) {
-    outputs1.push_back(outputs1Map.at(path));
+  for (const auto& key : pathsCommon) {
+    outputs0.push_back(outputs0Map.at(key));
+    outputs1.push_back(outputs1Map.at(key));
   }
-  //outputs1.insert(outputs1.end(), diff1.begin(), diff1.end());
   logger->debug("size of common outputs: {}", pathsCommon.size());
   logger->debug("size of diff0 outputs: {}", diff0.size());
   logger->debug("size of diff1 outputs: {}", diff1.size());
-  if (outputs0.size() == outputs1.size()) {
-    if (outputs0 != outputs1) {
-      // build the paths vector for outputs0 and outputs1
-      std::vector<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths0;
-      std::vector<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>> paths1;
-      for (const auto& output0 : outputs0) {
-        std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>> path;
-        for (const auto& [path0, output0m] : outputs0Map) {
-          if (output0m == output0) {
-            path = path0;
-            break;
-          }
-        }
-        paths0.push_back(path);
-      }
-      for (const auto& output1 : outputs1) {
-        std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>> path;
-        for (const auto& [path1, output1m] : outputs1Map) {
-          if (output1m == output1) {
-            path = path1;
-            break;
-          }
-        }
-        paths1.push_back(path);
-      }
-      if (paths0 != paths1) {
-        logger->error("Miter outputs must match in order");
-        // for (size_t i = 0; i < paths0.size(); ++i) {
-        //   naja::NL::SNLPath p0 = naja::NL::SNLPath(
-        //       top0_, paths0[i]);
-        //   naja::NL::SNLPath p1 = naja::NL::SNLPath(
-        //       top1_, paths1[i]);
-        //   throw std::runtime_error("Output " + std::to_string(i) +
-        //                            " mismatch: " + p0.getString() + " vs " +
-        //                            p1.getString());
-        // }
-        assert(false && "Miter outputs must match in order");
-      }
-    }
-  }
 }
 
 bool MiterStrategy::run() {
   ensureLoggerInitialized();
   logger->info("MiterStrategy::run starting");
 
-  // build both sets of POs
+  // Every phase works on the DNL of one design, which is only rebuilt when
+  // the design changes: collect 0 | collect 1, normalize, build 1 |
+  // build 0, miter, diagnose 0 | diagnose 1 (only when a PO differs).
   topInit_ = NLUniverse::get()->getTopDesign();
   NLUniverse* univ = NLUniverse::get();
-  naja::DNL::destroy();
-  univ->setTopDesign(top0_);
+  size_t liveDesign = 2;  // design of the live DNL, 2 for none
+  size_t dnlBuilds = 0;
+  auto useDesign = [&](size_t j) -> naja::DNL::DNLFull& {
+    if (liveDesign != j) {
+      naja::DNL::destroy();
+      univ->setTopDesign(j == 0 ? top0_ : top1_);
+      liveDesign = j;
+      ++dnlBuilds;
+    }
+    return *naja::DNL::get();
+  };
+
+  // build both sets of POs
+  // One trie for both designs: equal paths get equal keys.
+  auto paths = std::make_shared<PathTrie>();
   BuildPrimaryOutputClauses builder0;
-  builder0.collect();
-  naja::DNL::destroy();
-  univ->setTopDesign(top1_);
+  builder0.setPathTrie(paths);
+  builder0.setCaseConstants(caseConstants_);
+  builder0.setThreads(threads_);
+  builder0.collect(useDesign(0));
   BuildPrimaryOutputClauses builder1;
-  builder1.collect();
+  builder1.setPathTrie(paths);
+  builder1.setCaseConstants(caseConstants_);
+  builder1.setThreads(threads_);
+  builder1.collect(useDesign(1));
 
   // normalize inputs and outputs
   auto inputs0sort = builder0.getInputs();
@@ -494,327 +407,172 @@ bool MiterStrategy::run() {
   logger->info("size of POs in circuit 0: {}", outputs0sort.size());
   logger->info("size of POs in circuit 1: {}", outputs1sort.size());
   normalizeInputs(inputs0sort, inputs1sort, builder0.getInputsMap(),
-                  builder1.getInputsMap());
+                  builder1.getInputsMap(), *paths);
   normalizeOutputs(outputs0sort, outputs1sort, builder0.getOutputsMap(),
-                   builder1.getOutputsMap());
-  // return false;
-  naja::DNL::destroy();
-  univ->setTopDesign(top0_);
+                   builder1.getOutputsMap(), *paths);
   builder0.setInputs(inputs0sort);
   builder0.setOutputs(outputs0sort);
-  naja::DNL::destroy();
-  univ->setTopDesign(top1_);
   builder1.setInputs(inputs1sort);
   builder1.setOutputs(outputs1sort);
-  naja::DNL::destroy();
-  univ->setTopDesign(top0_);
-  builder0.build();
+  // design 1 is still live: compute its clouds first
+  builder1.prepare(useDesign(1));
+  builder0.prepare(useDesign(0));
+  // Convert the clouds of both designs as one pool of (design, PO) pairs,
+  // largest cones first, so that the tail of one design overlaps the other.
+  const size_t deferred0 = builder0.getNumDeferredPOs();
+  const size_t deferred1 = builder1.getNumDeferredPOs();
+  logger->info("Converting {} + {} PO clouds", deferred0, deferred1);
+  auto convertPO = [&](size_t p) {
+    if (p < deferred0) {
+      builder0.convertPO(p);
+    } else {
+      builder1.convertPO(p - deferred0);
+    }
+  };
+  if (getenv("KEPLER_NO_MT")) {
+    for (size_t p = 0; p < deferred0 + deferred1; ++p) {
+      convertPO(p);
+    }
+  } else if (deferred0 + deferred1 != 0) {
+    std::vector<size_t> costs = builder0.getPOCosts();
+    costs.insert(costs.end(), builder1.getPOCosts().begin(),
+                 builder1.getPOCosts().end());
+    tbb::task_arena arena(static_cast<int>(resolveThreadCount(threads_)));
+    runInOrder(arena, largestFirst(costs), convertPO);
+  }
   const auto& PIs0 = builder0.getInputs();
   const auto& POs0 = builder0.getPOs();
-  auto outputs0 = builder0.getOutputs();
-  auto inputs2inputsIDs0 = builder0.getInputs2InputsIDs();
-  auto outputs2outputsIDs0 = builder0.getOutputs2OutputsIDs();
-  naja::DNL::destroy();
-  univ->setTopDesign(top1_);
-  builder1.build();
+  const auto& outputs0 = builder0.getOutputs();
   const auto& PIs1 = builder1.getInputs();
   const auto& POs1 = builder1.getPOs();
-  auto outputs1 = builder1.getOutputs();
-  auto inputs2inputsIDs1 = builder1.getInputs2InputsIDs();
-  auto outputs2outputsIDs1 = builder1.getOutputs2OutputsIDs();
-
-  std::vector<naja::DNL::DNLID> outputs2DnlIds = builder1.getOutputs();
-
-  if (topInit_ != nullptr) {
-    univ->setTopDesign(topInit_);
-  }
+  const auto& outputs1 = builder1.getOutputs();
 
   if (POs0.empty() || POs1.empty()) {
     logger->warn(
         "No primary outputs found on one of the designs; aborting run");
+    if (topInit_ != nullptr) {
+      univ->setTopDesign(topInit_);
+    }
     return false;
   }
 
-  // build the Boolean-miter expression
-  auto miter = buildMiter(POs0, POs1);
-
-  // Now SAT check via Glucose
-  Glucose::SimpSolver solver;
-
-  // mappings for Tseitin encoding
-  std::unordered_map<std::shared_ptr<BoolExpr>, int> node2var;
-  std::unordered_map<std::string, int> varName2idx;
-
-  // Tseitin-encode & get the literal for the root
-  Glucose::Lit rootLit = tseitinEncode(solver, miter, node2var, varName2idx);
-
-  // Assert root == true
-  solver.addClause(rootLit);
-
-  // solve with no assumptions
+  if (POs0.size() != POs1.size()) {
+    logger->warn("Miter different number of outputs: {} vs {}", POs0.size(),
+                 POs1.size());
+  }
+  const size_t numPOs = std::min(POs0.size(), POs1.size());
   logger->info("Started Glucose solving");
-  bool sat = solver.solve();
-  logger->info("Finished Glucose solving: {}", sat ? "SAT" : "UNSAT");
+  failedPOs_.clear();
+  numSolves_ = 0;
+  if (parallelSAT_ && !getenv("KEPLER_NO_MT")) {
+    // PO pairs sharing support go to the same solver, so that the shared
+    // logic is encoded and learnt once; each group gets its own solver on
+    // the pool, largest first, within the solver memory budget.
+    const size_t threads = resolveThreadCount(threads_);
+    tbb::task_arena arena(static_cast<int>(threads));
+    std::vector<std::vector<size_t>> supports(numPOs);
+    std::vector<size_t> costs(numPOs);
+    arena.execute([&]() {
+      tbb::parallel_for(size_t(0), numPOs, [&](size_t i) {
+        collectSupport(POs0[i], POs1[i], supports[i], costs[i]);
+      });
+    });
+    const size_t totalCost =
+        std::accumulate(costs.begin(), costs.end(), size_t(0));
+    const size_t maxCost = *std::max_element(costs.begin(), costs.end());
+    const auto groups = groupBySharedKeys(
+        supports, costs, std::max(maxCost, totalCost / threads));
+    std::vector<size_t> groupCosts(groups.size(), 0);
+    for (size_t g = 0; g < groups.size(); ++g) {
+      for (size_t po : groups[g]) {
+        groupCosts[g] += costs[po];
+      }
+    }
+    logger->info("Checking {} POs in {} solver groups", numPOs, groups.size());
+    std::vector<POCheck> checks(groups.size());
+    MemoryGate gate(solverMemoryBudget_);
+    runInOrder(arena, largestFirst(groupCosts), [&](size_t g) {
+      const size_t bytes = groupCosts[g] * kSolverBytesPerNode;
+      gate.acquire(bytes);
+      checks[g] = checkPOs(groups[g], POs0, POs1);
+      gate.release(bytes);
+    });
+    for (const auto& check : checks) {
+      failedPOs_.insert(failedPOs_.end(), check.differing.begin(),
+                        check.differing.end());
+      numSolves_ += check.numSolves;
+    }
+    std::sort(failedPOs_.begin(), failedPOs_.end());
+  } else {
+    std::vector<size_t> pos(numPOs);
+    std::iota(pos.begin(), pos.end(), 0);
+    POCheck check = checkPOs(pos, POs0, POs1);
+    failedPOs_.assign(check.differing.begin(), check.differing.end());
+    numSolves_ = check.numSolves;
+  }
+  const bool sat = !failedPOs_.empty();
+  logger->info("Finished Glucose solving: {} ({} solves)",
+               sat ? "SAT" : "UNSAT", numSolves_);
 
   if (sat) {
     logger->warn("Miter found a difference -> moving to analyze individual POs");
-    for (size_t i = 0; i < POs0.size(); ++i) {
+    for (size_t i = 0; i < numPOs; ++i) {
       if (builder0.getOutputs2OutputsIDs().at(builder0.getDNLIDforOutput(i)) !=
           builder1.getOutputs2OutputsIDs().at(builder1.getDNLIDforOutput(i))) {
         // LCOV_EXCL_START
         auto path0 = builder0.getOutputs2OutputsIDs().at(builder0.getDNLIDforOutput(i));
         auto path1 = builder1.getOutputs2OutputsIDs().at(builder1.getDNLIDforOutput(i));
-        // print path0
-        for (const auto& name : path0.first) {
-          logger->info("%s.", name.getString().c_str());
-        }
-        for (const auto& id : path0.second) {
-          logger->info("%lu.", id);
-        }
-        logger->info("\n");
-        // print path1
-        for (const auto& name : path1.first) {
-          logger->info("%s.", name.getString().c_str());
-        }
-        for (const auto& id : path1.second) {
-          logger->info("%lu.", id);
-        }
-        logger->info("\n");
+        logger->info("{}", keyString(*paths, path0));
+        logger->info("{}", keyString(*paths, path1));
         throw std::runtime_error("Miter PO index " + std::to_string(i) +
                                  " DNLIDs do not match");
         // LCOV_EXCL_STOP
       }
-      tbb::concurrent_vector<std::shared_ptr<BoolExpr>> singlePOs0S;
-      singlePOs0S.push_back(POs0[i]);
-      tbb::concurrent_vector<std::shared_ptr<BoolExpr>> singlePOs1S;
-      singlePOs1S.push_back(POs1[i]);
-      auto singleMiter = buildMiter(singlePOs0S, singlePOs1S);
-
-      std::unordered_map<std::shared_ptr<BoolExpr>, int> singleNode2var;
-      std::unordered_map<std::string, int> singleVarName2idx;
-      // Tseitin-encode the single miter
-      Glucose::SimpSolver singleSolver;
-      Glucose::Lit singleRootLit = tseitinEncode(
-          singleSolver, singleMiter, singleNode2var, singleVarName2idx);
-
-      singleSolver.addClause(singleRootLit);
-      if (singleSolver.solve()) {
-        failedPOs_.push_back(i);
-        logger->info("Found difference for PO: {}", i);
-        // logger->info("Clause 0 {}", POs0[i]->toString());
-        // logger->info("Clause 1 {}", POs1[i]->toString());
-        // print path of index i
-        auto path0 = builder0.getOutputs2OutputsIDs().at(builder0.getDNLIDforOutput(i));
-        std::string pathString = "";
-        for (const auto& name : path0.first) {
-          pathString += name.getString() + ".";
-        }
-        for (const auto& id : path0.second) {
-          pathString += std::to_string(id) + ".";
-        }
-        logger->info("Path of differing PO {}: {}", i, pathString);
-        auto path1 = builder1.getOutputs2OutputsIDs().at(builder1.getDNLIDforOutput(i));
-        std::string pathString1 = "";
-        for (const auto& name : path1.first) {
-          pathString1 += name.getString() + ".";
-        }
-        for (const auto& id : path1.second) {
-          pathString1 += std::to_string(id) + ".";
-        }
-        logger->info("Path of differing PO {}: {}", i, pathString1);
-        std::vector<naja::NL::SNLDesign*> topModels;
-        topModels.push_back(top0_);
-        topModels.push_back(top1_);
-        std::vector<std::vector<naja::DNL::DNLID>> PIs;
-        PIs.push_back(PIs0);
-        PIs.push_back(PIs1);
-        naja::NL::SNLEquipotential::Terms terms0;
-        naja::NL::SNLEquipotential::Terms terms1;
-        naja::NL::SNLEquipotential::InstTermOccurrences insTerms0;
-        naja::NL::SNLEquipotential::InstTermOccurrences insTerms1;
-        for (size_t j = 0; j < topModels.size(); ++j) {
-          DNL::destroy();
-          NLUniverse::get()->setTopDesign(topModels[j]);
-          // if (j == 0) {
-          //   //logger->info("$$$ 0 term {} of model {}",
-          //   naja::DNL::get()->getDNLTerminalFromID(outputs0[i]).getSnlBitTerm()->getName().getString().c_str(),
-          //   naja::DNL::get()->getDNLTerminalFromID(outputs0[i]).getSnlBitTerm()->getDesign()->getName().getString().c_str());
-          // } else {
-          //   //logger->info("### 0 term {} of model {}",
-          //   naja::DNL::get()->getDNLTerminalFromID(outputs1[i]).getSnlBitTerm()->getName().getString().c_str(),
-          //   naja::DNL::get()->getDNLTerminalFromID(outputs1[i]).getSnlBitTerm()->getDesign()->getName().getString().c_str());
-
-          // }
-          if (dnls_.size() <= j) {
-            dnls_.push_back(*naja::DNL::get());
-          }
-          SNLLogicCone cone(j == 0 ? outputs0[i] : outputs1[i], PIs[j],
-                            &dnls_[j]);
-          cone.run();
-          // std::string dotFileNameEquis(
-          //     std::string(prefix_ + "_" +
-          //     DNL::get()->getDNLTerminalFromID(outputs0[i]).getSnlBitTerm()->getName().getString()
-          //     + std::to_string(outputs0[i]) + "_" +std::to_string(j) +
-          //     std::string(".dot")));
-          // std::string svgFileNameEquis(
-          //     std::string(prefix_ + "_" +
-          //     DNL::get()->getDNLTerminalFromID(outputs0[i]).getSnlBitTerm()->getName().getString()
-          //     + std::to_string(outputs0[i]) + "_" + std::to_string(j) +
-          //     std::string(".svg")));
-          // SnlVisualiser snl2(topModels[j], cone.getEquipotentials());
-          for (const auto& equi : cone.getEquipotentials()) {
-            for (const auto& term : equi.getTerms()) {
-              if (j == 0) {
-                terms0.insert(term);
-                // logger->info("$$$ Term 0: {}", term->getString().c_str());
-              } else {
-                terms1.insert(term);
-                // logger->info("### Term 1: {}", term->getString().c_str());
-              }
-            }
-            for (const auto& termOcc : equi.getInstTermOccurrences()) {
-              if (j == 0) {
-                insTerms0.insert(termOcc);
-                // logger->info("$$$ Inst Term 0: {}",
-                // termOcc.getString().c_str());
-              } else {
-                insTerms1.insert(termOcc);
-                // logger->info("### Inst Term 1: {}",
-                // termOcc.getString().c_str());
-              }
-            }
-          }
-          // snl2.process();
-          // snl2.getNetlistGraph().dumpDotFile(dotFileNameEquis.c_str());
-          // executeCommand(std::string(std::string("dot -Tsvg ") +
-          //                            dotFileNameEquis + std::string(" -o ") +
-          //                            svgFileNameEquis).c_str());
-          // logger->info("svg file name: {}", svgFileNameEquis);
-        }
+    }
+    for (size_t i : failedPOs_) {
+      logger->info("Found difference for PO: {}", i);
+      // print path of index i
+      auto path0 = builder0.getOutputs2OutputsIDs().at(builder0.getDNLIDforOutput(i));
+      logger->info("Path of differing PO {}: {}", i, keyString(*paths, path0));
+      auto path1 = builder1.getOutputs2OutputsIDs().at(builder1.getDNLIDforOutput(i));
+      logger->info("Path of differing PO {}: {}", i, keyString(*paths, path1));
+    }
 
-        // find intersection and diff of terms0 and terms1
-        naja::NL::SNLEquipotential::Terms termsCommon;
-        naja::NL::SNLEquipotential::Terms termsDiff;
-        for (const auto& term0 : terms0) {
-          bool found = false;
-          for (const auto& term1 : terms1) {
-            if (term0->getID() == term1->getID() &&
-                term0->getBit() == term1->getBit()) {
-              found = true;
-              break;
-            }
-          }
-          if (found) {
-            termsCommon.insert(term0);
-          } else {
-            termsDiff.insert(term0);
-            if (term0->getDirection() ==
-                naja::NL::SNLBitTerm::Direction::Output) {
-              continue;
-            }
-            logger->info("Diff 0 term: {}", term0->getString());
-          }
-        }
-        for (const auto& term1 : terms1) {
-          bool found = false;
-          for (const auto& term0 : terms0) {
-            if (term0->getID() == term1->getID() &&
-                term0->getBit() == term1->getBit()) {
-              found = true;
-              break;
-            }
-          }
-          if (!found) {
-            termsDiff.insert(term1);
-            if (term1->getDirection() ==
-                naja::NL::SNLBitTerm::Direction::Output) {
-              continue;
-            }
-            logger->info("Diff 1 term: {}", term1->getString());
-          }
-        }
-        // print termsDiff
-        // for (const auto& term : termsDiff) {
-        //   if (term->getDirection() ==
-        //   naja::NL::SNLBitTerm::Direction::Output) {
-        //     continue;
-        //   }
-        //   logger->info("Diff term: {}", term->getString());
-        // }
-        // find intersection and diff of insTerms0 and insTerms1
-        naja::NL::SNLEquipotential::InstTermOccurrences insTermsCommon;
-        naja::NL::SNLEquipotential::InstTermOccurrences insTermsDiff;
-        for (const auto& term0 : insTerms0) {
-          bool found = false;
-          for (const auto& term1 : insTerms1) {
-            if (term0.getPath().getPathNames() == term1.getPath().getPathNames() &&
-                term0.getInstTerm()->getInstance()->getName() ==
-                    term1.getInstTerm()->getInstance()->getName() &&
-                term0.getInstTerm()->getBitTerm()->getID() ==
-                    term1.getInstTerm()->getBitTerm()->getID() &&
-                term0.getInstTerm()->getBitTerm()->getBit() ==
-                    term1.getInstTerm()->getBitTerm()->getBit()) {
-              found = true;
-              break;
-            }
-          }
-          if (found) {
-            insTermsCommon.insert(term0);
-          } else {
-            insTermsDiff.insert(term0);
-            if (term0.getInstTerm()->getDirection() ==
-                    naja::NL::SNLInstTerm::Direction::Input ||
-                !term0.getInstTerm()
-                     ->getInstance()
-                     ->getModel()
-                     ->getInstances()
-                     .empty()) {
-              continue;
-            }
-            logger->info("Diff 0 inst term {} with direction {}",
-                         term0.getString(),
-                         term0.getInstTerm()->getDirection().getString());
-          }
-        }
-        for (const auto& term1 : insTerms1) {
-          bool found = false;
-          for (const auto& term0 : insTerms0) {
-            if (term0.getPath().getPathNames() == term1.getPath().getPathNames() &&
-                term0.getInstTerm()->getInstance()->getName() ==
-                    term1.getInstTerm()->getInstance()->getName() &&
-                term0.getInstTerm()->getBitTerm()->getID() ==
-                    term1.getInstTerm()->getBitTerm()->getID() &&
-                term0.getInstTerm()->getBitTerm()->getBit() ==
-                    term1.getInstTerm()->getBitTerm()->getBit()) {
-              found = true;
-              break;
-            }
+    // Cones of the differing POs, one design at a time, starting with the
+    // design whose DNL is live.
+    std::vector<std::array<naja::NL::SNLEquipotential::Terms, 2>> coneTerms(
+        failedPOs_.size());
+    std::vector<
+        std::array<naja::NL::SNLEquipotential::InstTermOccurrences, 2>>
+        coneInsTerms(failedPOs_.size());
+    for (size_t j : {liveDesign, 1 - liveDesign}) {
+      if (failedPOs_.empty()) {
+        break;
+      }
+      naja::DNL::DNLFull& dnl = useDesign(j);
+      const DNLFaninGraph graph(dnl);
+      const auto& PIs = j == 0 ? PIs0 : PIs1;
+      const auto& outputs = j == 0 ? outputs0 : outputs1;
+      for (size_t k = 0; k < failedPOs_.size(); ++k) {
+        SNLLogicCone cone(outputs[failedPOs_[k]], PIs, &dnl, &graph);
+        cone.run();
+        for (const auto& equi : cone.getEquipotentials()) {
+          for (const auto& term : equi.getTerms()) {
+            coneTerms[k][j].insert(term);
           }
-          if (!found) {
-            insTermsDiff.insert(term1);
-            if (term1.getInstTerm()->getDirection() ==
-                    naja::NL::SNLInstTerm::Direction::Input ||
-                !term1.getInstTerm()
-                     ->getInstance()
-                     ->getModel()
-                     ->getInstances()
-                     .empty()) {
-              continue;
-            }
-            logger->info("Diff 1 inst term {} with direction {}",
-                         term1.getString(),
-                         term1.getInstTerm()->getDirection().getString());
+          for (const auto& termOcc : equi.getInstTermOccurrences()) {
+            coneInsTerms[k][j].insert(termOcc);
           }
         }
-
-        logger->debug("size of intersection of terms: {}", termsCommon.size());
-        logger->debug("size of diff of terms: {}", termsDiff.size());
-        logger->debug("size of intersection of inst terms: {}",
-                      insTermsCommon.size());
-        logger->debug("size of diff of inst terms: {}", insTermsDiff.size());
       }
     }
+    for (size_t k = 0; k < failedPOs_.size(); ++k) {
+      logger->info("Cone differences of PO {}", failedPOs_[k]);
+      reportConeDiff(coneTerms[k][0], coneTerms[k][1], coneInsTerms[k][0],
+                     coneInsTerms[k][1]);
+    }
   }
+  logger->info("DNL built {} times", dnlBuilds);
   if (topInit_ != nullptr) {
     univ->setTopDesign(topInit_);
   }
@@ -823,32 +581,121 @@ bool MiterStrategy::run() {
   return !sat;
 }
 
-std::shared_ptr<BoolExpr> MiterStrategy::buildMiter(
-    const tbb::concurrent_vector<std::shared_ptr<BoolExpr>>& A,
-    const tbb::concurrent_vector<std::shared_ptr<BoolExpr>>& B) const {
-  ensureLoggerInitialized();
-  logger->debug("buildMiter: A.size={} B.size={}", A.size(), B.size());
-
-  // Empty miter = always-false (no outputs to compare)
-  if (A.empty()) {
-    logger->error("buildMiter called with empty A");
-    assert(false);
-    return BoolExpr::createFalse();
+void MiterStrategy::reportConeDiff(
+    const naja::NL::SNLEquipotential::Terms& terms0,
+    const naja::NL::SNLEquipotential::Terms& terms1,
+    const naja::NL::SNLEquipotential::InstTermOccurrences& insTerms0,
+    const naja::NL::SNLEquipotential::InstTermOccurrences& insTerms1) const {
+  // find intersection and diff of terms0 and terms1
+  naja::NL::SNLEquipotential::Terms termsCommon;
+  naja::NL::SNLEquipotential::Terms termsDiff;
+  for (const auto& term0 : terms0) {
+    bool found = false;
+    for (const auto& term1 : terms1) {
+      if (term0->getID() == term1->getID() &&
+          term0->getBit() == term1->getBit()) {
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      termsCommon.insert(term0);
+    } else {
+      termsDiff.insert(term0);
+      if (term0->getDirection() ==
+          naja::NL::SNLBitTerm::Direction::Output) {
+        continue;
+      }
+      logger->info("Diff 0 term: {}", term0->getString());
+    }
   }
-
-  // Start with the first XOR
-  auto miter = BoolExpr::Xor(A[0], B[0]);
-
-  // OR in the rest
-  for (size_t i = 1; i < A.size(); ++i) {
-    if (B.size() <= i) {
-      logger->warn("Miter different number of outputs: {} vs {}", A.size(),
-                   B.size());
-      break;
+  for (const auto& term1 : terms1) {
+    bool found = false;
+    for (const auto& term0 : terms0) {
+      if (term0->getID() == term1->getID() &&
+          term0->getBit() == term1->getBit()) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      termsDiff.insert(term1);
+      if (term1->getDirection() ==
+          naja::NL::SNLBitTerm::Direction::Output) {
+        continue;
+      }
+      logger->info("Diff 1 term: {}", term1->getString());
     }
-    auto diff = BoolExpr::Xor(A[i], B[i]);
-    miter = BoolExpr::Or(miter, diff);
   }
-  // logger->trace("buildMiter produced expression: {}", miter->toString());
-  return miter;
+  // find intersection and diff of insTerms0 and insTerms1
+  naja::NL::SNLEquipotential::InstTermOccurrences insTermsCommon;
+  naja::NL::SNLEquipotential::InstTermOccurrences insTermsDiff;
+  for (const auto& term0 : insTerms0) {
+    bool found = false;
+    for (const auto& term1 : insTerms1) {
+      if (term0.getPath().getPathNames() == term1.getPath().getPathNames() &&
+          term0.getInstTerm()->getInstance()->getName() ==
+              term1.getInstTerm()->getInstance()->getName() &&
+          term0.getInstTerm()->getBitTerm()->getID() ==
+              term1.getInstTerm()->getBitTerm()->getID() &&
+          term0.getInstTerm()->getBitTerm()->getBit() ==
+              term1.getInstTerm()->getBitTerm()->getBit()) {
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      insTermsCommon.insert(term0);
+    } else {
+      insTermsDiff.insert(term0);
+      if (term0.getInstTerm()->getDirection() ==
+              naja::NL::SNLInstTerm::Direction::Input ||
+          !term0.getInstTerm()
+               ->getInstance()
+               ->getModel()
+               ->getInstances()
+               .empty()) {
+        continue;
+      }
+      logger->info("Diff 0 inst term {} with direction {}",
+                   term0.getString(),
+                   term0.getInstTerm()->getDirection().getString());
+    }
+  }
+  for (const auto& term1 : insTerms1) {
+    bool found = false;
+    for (const auto& term0 : insTerms0) {
+      if (term0.getPath().getPathNames() == term1.getPath().getPathNames() &&
+          term0.getInstTerm()->getInstance()->getName() ==
+              term1.getInstTerm()->getInstance()->getName() &&
+          term0.getInstTerm()->getBitTerm()->getID() ==
+              term1.getInstTerm()->getBitTerm()->getID() &&
+          term0.getInstTerm()->getBitTerm()->getBit() ==
+              term1.getInstTerm()->getBitTerm()->getBit()) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      insTermsDiff.insert(term1);
+      if (term1.getInstTerm()->getDirection() ==
+              naja::NL::SNLInstTerm::Direction::Input ||
+          !term1.getInstTerm()
+               ->getInstance()
+               ->getModel()
+               ->getInstances()
+               .empty()) {
+        continue;
+      }
+      logger->info("Diff 1 inst term {} with direction {}",
+                   term1.getString(),
+                   term1.getInstTerm()->getDirection().getString());
+    }
+  }
+
+  logger->debug("size of intersection of terms: {}", termsCommon.size());
+  logger->debug("size of diff of terms: {}", termsDiff.size());
+  logger->debug("size of intersection of inst terms: {}",
+                insTermsCommon.size());
+  logger->debug("size of diff of inst terms: {}", insTermsDiff.size());
 }
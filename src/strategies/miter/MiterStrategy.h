@@ -1,9 +1,13 @@
 // Copyright 2024-2026 keplertech.io
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <string>
+#include <utility>
 #include <vector>
 #include "BoolExpr.h"
+#include "BuildPrimaryOutputClauses.h"
 #include "DNL.h"
+#include "SNLEquipotential.h"
 #include <tbb/concurrent_vector.h>
 
 #pragma once
@@ -20,33 +24,67 @@ class MiterStrategy {
  public:
   MiterStrategy(naja::NL::SNLDesign* top0, naja::NL::SNLDesign* top1, const std::string& logFileName = "", const std::string& prefix = "");
 
+  /// Pins held at 0/1 in both designs during the check (case analysis), see
+  /// BuildPrimaryOutputClauses::setCaseConstants.
+  void setCaseConstants(const std::vector<std::pair<std::string, bool>>& constants) {
+    caseConstants_ = constants;
+  }
+
+  /// Worker count of the PO builds, 0 (default) for resolveThreadCount().
+  void setThreads(size_t threads) { threads_ = threads; }
+
+  /// Check the POs with one solver per group of POs sharing support, the
+  /// groups running in parallel on setThreads workers, instead of one
+  /// solver for all the POs.
+  void setParallelSAT(bool parallel) { parallelSAT_ = parallel; }
+  /// Estimated memory of the solvers running at the same time in parallel
+  /// SAT mode, 0 (default) for no limit. A group larger than the budget
+  /// runs alone.
+  void setSolverMemoryBudget(size_t bytes) { solverMemoryBudget_ = bytes; }
+
   bool run();
 
-  void normalizeInputs(std::vector<naja::DNL::DNLID>& inputs0,
-                       std::vector<naja::DNL::DNLID>& inputs1,
-                        const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>& inputs0Map,
-                        const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>& inputs1Map);
+  /// Indexes of the differing POs found by the last run, in increasing
+  /// order (POs are numbered in normalized output order).
+  const std::vector<naja::DNL::DNLID>& getFailedPOs() const {
+    return failedPOs_;
+  }
+  /// SAT solves of the last run, all solvers included.
+  size_t getNumSolves() const { return numSolves_; }
+
+  void normalizeInputs(std::vector<TermID>& inputs0,
+                       std::vector<TermID>& inputs1,
+                       const BuildPrimaryOutputClauses::TermKeyMap& inputs0Map,
+                       const BuildPrimaryOutputClauses::TermKeyMap& inputs1Map,
+                       const PathTrie& paths);
 
-  void normalizeOutputs(std::vector<naja::DNL::DNLID>& outputs0,
-                        std::vector<naja::DNL::DNLID>& outputs1,
-                        const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>& outputs0Map,
-                        const std::map<std::pair<std::vector<NLName>, std::vector<NLID::DesignObjectID>>, naja::DNL::DNLID>& outputs1Map);
+  void normalizeOutputs(std::vector<TermID>& outputs0,
+                        std::vector<TermID>& outputs1,
+                        const BuildPrimaryOutputClauses::TermKeyMap& outputs0Map,
+                        const BuildPrimaryOutputClauses::TermKeyMap& outputs1Map,
+                        const PathTrie& paths);
   
   static std::string logFileName_;
  private:
-  std::shared_ptr<BoolExpr> buildMiter(
-      const tbb::concurrent_vector<std::shared_ptr<BoolExpr>>& A,
-      const tbb::concurrent_vector<std::shared_ptr<BoolExpr>>& B) const;
+  // Log the cone terminals of a differing PO found in only one design.
+  void reportConeDiff(
+      const naja::NL::SNLEquipotential::Terms& terms0,
+      const naja::NL::SNLEquipotential::Terms& terms1,
+      const naja::NL::SNLEquipotential::InstTermOccurrences& insTerms0,
+      const naja::NL::SNLEquipotential::InstTermOccurrences& insTerms1) const;
   
   static naja::NL::SNLDesign* top0_;
   static naja::NL::SNLDesign* top1_;
   tbb::concurrent_vector<BoolExpr> POs0_;
   tbb::concurrent_vector<BoolExpr> POs1_;
   std::vector<naja::DNL::DNLID> failedPOs_;
-  BoolExpr miterClause_;
+  size_t numSolves_ = 0;
   std::string prefix_;
   naja::NL::SNLDesign* topInit_ = nullptr;
-  std::vector<naja::DNL::DNLFull> dnls_;
+  std::vector<std::pair<std::string, bool>> caseConstants_;
+  size_t threads_ = 0;
+  bool parallelSAT_ = false;
+  size_t solverMemoryBudget_ = 0;
 };
 
 }  // namespace KEPLER_FORMAL
\ No newline at end of file
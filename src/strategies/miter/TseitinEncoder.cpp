@@ -0,0 +1,109 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TseitinEncoder.h"
+#include <algorithm>
+#include <stack>
+#include <stdexcept>
+
+using namespace KEPLER_FORMAL;
+
+Glucose::Lit TseitinEncoder::leafLit(size_t varID) {
+  if (varID <= 1) {
+    if (trueVar_ < 0) {
+      trueVar_ = solver_.newVar();
+      solver_.addClause(Glucose::mkLit(trueVar_));
+    }
+    return Glucose::mkLit(trueVar_, varID == 0);
+  }
+  if (varID >= varID2var_.size()) {
+    varID2var_.resize(std::max(varID + 1, 2 * varID2var_.size()), -1);
+  }
+  int& v = varID2var_[varID];
+  if (v < 0) {
+    v = solver_.newVar();
+  }
+  return Glucose::mkLit(v);
+}
+
+Glucose::Lit TseitinEncoder::encode(const std::shared_ptr<BoolExpr>& root) {
+  struct Frame {
+    std::shared_ptr<BoolExpr> expr;
+    bool visited = false;
+    Glucose::Lit leftLit, rightLit;
+  };
+
+  std::stack<Frame> stk;
+  stk.push({root, false, {}, {}});
+
+  while (!stk.empty()) {
+    Frame& fr = stk.top();
+    std::shared_ptr<BoolExpr> e = fr.expr;
+
+    // If already encoded, reuse
+    if (node2lit_.count(e)) {
+      stk.pop();
+      continue;
+    }
+
+    // Leaf VAR or CONST
+    if (!fr.visited && e->getOp() == Op::VAR) {
+      node2lit_[e] = leafLit(e->getId());
+      stk.pop();
+      continue;
+    }
+
+    // First time we see this node, push children
+    if (!fr.visited) {
+      fr.visited = true;
+      if (e->getRight())
+        stk.push({e->getRight(), false, {}, {}});
+      if (e->getLeft())
+        stk.push({e->getLeft(), false, {}, {}});
+      continue;
+    }
+
+    // Children have been processed; retrieve their lits
+    if (e->getLeft())
+      fr.leftLit = node2lit_.at(e->getLeft());
+    if (e->getRight())
+      fr.rightLit = node2lit_.at(e->getRight());
+
+    // Create fresh var for this gate
+    int v = solver_.newVar();
+    Glucose::Lit lit_v = Glucose::mkLit(v);
+    node2lit_[e] = lit_v;
+
+    // Emit Tseitin clauses
+    switch (e->getOp()) {
+      case Op::NOT:
+        solver_.addClause(~lit_v, ~fr.leftLit);
+        solver_.addClause(lit_v, fr.leftLit);
+        break;
+      case Op::AND:
+        solver_.addClause(~lit_v, fr.leftLit);
+        solver_.addClause(~lit_v, fr.rightLit);
+        solver_.addClause(lit_v, ~fr.leftLit, ~fr.rightLit);
+        break;
+      case Op::OR:
+        solver_.addClause(~fr.leftLit, lit_v);
+        solver_.addClause(~fr.rightLit, lit_v);
+        solver_.addClause(~lit_v, fr.leftLit, fr.rightLit);
+        break;
+      case Op::XOR:
+        solver_.addClause(~lit_v, ~fr.leftLit, ~fr.rightLit);
+        solver_.addClause(~lit_v, fr.leftLit, fr.rightLit);
+        solver_.addClause(lit_v, ~fr.leftLit, fr.rightLit);
+        solver_.addClause(lit_v, fr.leftLit, ~fr.rightLit);
+        break;
+      default:
+        // LCOV_EXCL_START
+        throw std::logic_error("TseitinEncoder: unhandled operator");
+        // LCOV_EXCL_STOP
+    }
+
+    stk.pop();
+  }
+
+  return node2lit_.at(root);
+}
@@ -0,0 +1,41 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "BoolExpr.h"
+
+#include "simp/SimpSolver.h"
+
+namespace KEPLER_FORMAL {
+
+/// A tiny Tseitin translator from BoolExpr to Glucose CNF.
+///
+/// encode() returns a literal standing for the expression and adds all the
+/// clauses needed for lit <-> expr. Sub-expressions are encoded once per
+/// encoder: the node -> variable cache lives as long as the encoder, and all
+/// the leaves of the same variable ID share one solver variable, found in a
+/// dense table indexed by ID. The constants 0 and 1 map to the two
+/// polarities of one variable held at true.
+class TseitinEncoder {
+ public:
+  explicit TseitinEncoder(Glucose::SimpSolver& solver) : solver_(solver) {}
+
+  Glucose::Lit encode(const std::shared_ptr<BoolExpr>& root);
+
+  size_t getNumEncodedNodes() const { return node2lit_.size(); }
+
+ private:
+  Glucose::Lit leafLit(size_t varID);
+
+  Glucose::SimpSolver& solver_;
+  std::unordered_map<std::shared_ptr<BoolExpr>, Glucose::Lit> node2lit_;
+  std::vector<int> varID2var_;  // -1: no solver variable yet
+  int trueVar_ = -1;
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,94 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "DNLFaninGraph.h"
+#include <vector>
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+using namespace naja::NL;
+
+DNLFaninGraph::DNLFaninGraph(const DNLFull& dnl) : attributes_(dnl) {
+  const size_t numTerms = dnl.getNBterms();
+  instOf_.resize(numTerms);
+  outputBits_.assign((numTerms + 63) / 64, 0);
+  for (const auto& inst : dnl.getDNLInstances()) {
+    const auto [first, last] = inst.getTermIndexes();
+    for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+      instOf_[term] = inst.getID();
+    }
+  }
+  for (DNLID term = 0; term < numTerms; ++term) {
+    if (attributes_.isOutput(term)) {
+      outputBits_[term >> 6] |= uint64_t{1} << (term & 63);
+    }
+  }
+
+  const auto& isoDB = dnl.getDNLIsoDB();
+  const size_t numIsos = isoDB.getNumIsos();
+  isoDriverStart_.reserve(numIsos + 1);
+  isoDriverStart_.push_back(0);
+  isoNumReaders_.reserve(numIsos);
+  for (DNLID iso = 0; iso < numIsos; ++iso) {
+    const auto& dnlIso = isoDB.getIsoFromIsoIDconst(iso);
+    const auto& drivers = dnlIso.getDrivers();
+    isoDrivers_.insert(isoDrivers_.end(), drivers.begin(), drivers.end());
+    isoDriverStart_.push_back(isoDrivers_.size());
+    isoNumReaders_.push_back(
+        static_cast<uint32_t>(dnlIso.getReaders().size()));
+  }
+
+  const auto& instances = dnl.getDNLInstances();
+  instInputStart_.reserve(instances.size() + 1);
+  instInputStart_.push_back(0);
+  for (const auto& inst : instances) {
+    const auto [first, last] = inst.getTermIndexes();
+    for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+      if (!isOutputTerm(term)) {
+        instInputs_.push_back(term);
+      }
+    }
+    instInputStart_.push_back(instInputs_.size());
+  }
+
+  // Buffers and inverters: outputs of single-input cells with a 1-input
+  // identity (10) or negation (01) table, classified once per model output.
+  bufferBits_.assign(outputBits_.size(), 0);
+  inverterBits_.assign(outputBits_.size(), 0);
+  std::vector<Passthrough> kinds(attributes_.getNumTables(), Passthrough::None);
+  std::vector<bool> classified(attributes_.getNumTables(), false);
+  for (const auto& inst : instances) {
+    const DNLID id = inst.getID();
+    if (!inst.isLeaf() || instInputStart_[id + 1] - instInputStart_[id] != 1) {
+      continue;
+    }
+    const auto [first, last] = inst.getTermIndexes();
+    for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+      if (!isOutputTerm(term)) {
+        continue;
+      }
+      const uint32_t index = attributes_.getTableIndex(term);
+      if (index == DNLTermAttributes::kNoTable) {
+        continue;
+      }
+      if (!classified[index]) {
+        classified[index] = true;
+        const SNLTruthTable& table = attributes_.getTruthTable(term);
+        if (table.isInitialized() && table.size() == 1) {
+          const bool row0 = table.bits().bit(0);
+          const bool row1 = table.bits().bit(1);
+          if (!row0 && row1) {
+            kinds[index] = Passthrough::Buffer;
+          } else if (row0 && !row1) {
+            kinds[index] = Passthrough::Inverter;
+          }
+        }
+      }
+      if (kinds[index] == Passthrough::Buffer) {
+        bufferBits_[term >> 6] |= uint64_t{1} << (term & 63);
+      } else if (kinds[index] == Passthrough::Inverter) {
+        inverterBits_[term >> 6] |= uint64_t{1} << (term & 63);
+      }
+    }
+  }
+}
@@ -0,0 +1,138 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "DNL.h"
+#include "DNLTermAttributes.h"
+
+namespace KEPLER_FORMAL {
+
+/// Flat, read-only view of the combinational connectivity of a DNL, built
+/// once and shared by every cone traversal (and every TBB worker):
+/// - the iso of each terminal, the driver terminals of each iso (CSR) and
+///   its number of readers,
+/// - the non-output terminals of each instance (CSR), in terminal order, so
+///   in the input order of the model truth tables,
+/// - a direction bit per terminal,
+/// - the output terminals of 1-input buffer and inverter cells, recognized
+///   from their truth tables,
+/// - the DNLTermAttributes of every terminal (model, truth table, ...).
+/// A traversal step then costs a few array reads instead of a chain of
+/// terminal -> iso -> instance -> bit term lookups.
+class DNLFaninGraph {
+ public:
+  /// Function of a single-input cell output seen from its input.
+  enum class Passthrough : uint8_t { None, Buffer, Inverter };
+
+  explicit DNLFaninGraph(const naja::DNL::DNLFull& dnl);
+
+  size_t getNumTerms() const { return attributes_.getNumTerms(); }
+  const DNLTermAttributes& getAttributes() const { return attributes_; }
+  /// Iso of `term`, DNLID_MAX when the terminal is not connected.
+  naja::DNL::DNLID getIsoID(naja::DNL::DNLID term) const {
+    return attributes_.getIsoID(term);
+  }
+  std::span<const naja::DNL::DNLID> getIsoDrivers(naja::DNL::DNLID iso) const {
+    return {isoDrivers_.data() + isoDriverStart_[iso],
+            isoDrivers_.data() + isoDriverStart_[iso + 1]};
+  }
+  size_t getNumIsoReaders(naja::DNL::DNLID iso) const {
+    return isoNumReaders_[iso];
+  }
+  /// Drivers of the iso `term` is connected to (empty when unconnected).
+  std::span<const naja::DNL::DNLID> getDrivers(naja::DNL::DNLID term) const {
+    const naja::DNL::DNLID iso = attributes_.getIsoID(term);
+    if (iso == naja::DNL::DNLID_MAX) {
+      return {};
+    }
+    return getIsoDrivers(iso);
+  }
+  naja::DNL::DNLID getInstanceID(naja::DNL::DNLID term) const {
+    return instOf_[term];
+  }
+  /// Non-output terminals of the instance owning `term`.
+  std::span<const naja::DNL::DNLID> getDriverInputs(
+      naja::DNL::DNLID term) const {
+    return getInstanceInputs(instOf_[term]);
+  }
+  /// Non-output terminals of instance `inst`.
+  std::span<const naja::DNL::DNLID> getInstanceInputs(
+      naja::DNL::DNLID inst) const {
+    return {instInputs_.data() + instInputStart_[inst],
+            instInputs_.data() + instInputStart_[inst + 1]};
+  }
+  bool isOutputTerm(naja::DNL::DNLID term) const {
+    return testBit(outputBits_, term);
+  }
+  /// Buffer/Inverter when `term` is the output of a cell with a single
+  /// input whose truth table is the identity/negation; the input is then
+  /// getDriverInputs(term)[0].
+  Passthrough getPassthrough(naja::DNL::DNLID term) const {
+    if (testBit(bufferBits_, term)) {
+      return Passthrough::Buffer;
+    }
+    return testBit(inverterBits_, term) ? Passthrough::Inverter
+                                        : Passthrough::None;
+  }
+  /// First driver behind the chain of buffers/inverters starting at driver
+  /// `driver`, stopping at a terminal for which isStop holds (a PI, or a
+  /// constant or cached driver, which must not be bypassed), `driver`
+  /// included, or at a cell input that has no single driver. Toggles
+  /// `negated` on every inverter crossed.
+  template <typename IsStop>
+  naja::DNL::DNLID skipPassthrough(naja::DNL::DNLID driver,
+                                   bool& negated,
+                                   IsStop&& isStop) const {
+    if (isStop(driver)) {
+      return driver;
+    }
+    size_t steps = 0;
+    for (auto kind = getPassthrough(driver); kind != Passthrough::None;
+         kind = getPassthrough(driver)) {
+      naja::DNL::DNLID next = getDriverInputs(driver)[0];
+      if (!isStop(next)) {
+        const auto drivers = getDrivers(next);
+        if (drivers.size() != 1) {
+          break;
+        }
+        next = drivers.front();
+      }
+      if (++steps > getNumTerms()) {
+        // LCOV_EXCL_START
+        throw std::runtime_error("DNLFaninGraph: loop of buffers/inverters");
+        // LCOV_EXCL_STOP
+      }
+      negated ^= kind == Passthrough::Inverter;
+      driver = next;
+      if (isStop(driver)) {
+        break;
+      }
+    }
+    return driver;
+  }
+
+ private:
+  static bool testBit(const std::vector<uint64_t>& bits,
+                      naja::DNL::DNLID term) {
+    return ((bits[term >> 6] >> (term & 63)) & 1u) != 0;
+  }
+
+  DNLTermAttributes attributes_;
+  std::vector<naja::DNL::DNLID> instOf_;
+  std::vector<uint64_t> outputBits_;
+  std::vector<uint64_t> bufferBits_;
+  std::vector<uint64_t> inverterBits_;
+  std::vector<size_t> isoDriverStart_;
+  std::vector<naja::DNL::DNLID> isoDrivers_;
+  std::vector<uint32_t> isoNumReaders_;
+  std::vector<size_t> instInputStart_;
+  std::vector<naja::DNL::DNLID> instInputs_;
+};
+
+}  // namespace KEPLER_FORMAL
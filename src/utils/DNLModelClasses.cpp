@@ -0,0 +1,152 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "DNLModelClasses.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include "SNLDesignModeling.h"
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+using namespace naja::NL;
+
+namespace {
+
+constexpr uint32_t kNoModel = std::numeric_limits<uint32_t>::max();
+
+bool isInputDir(const SNLBitTerm* bitTerm) {
+  return bitTerm->getDirection() == SNLBitTerm::Direction::Input;
+}
+
+bool isOutputDir(const SNLBitTerm* bitTerm) {
+  return bitTerm->getDirection() == SNLBitTerm::Direction::Output;
+}
+
+// True when bit `orderID` is set in the dependency words of `table`.
+bool dependsOn(const SNLTruthTable& table, uint64_t orderID) {
+  const auto& deps = table.getDependencies();
+  const size_t word = orderID / 64;
+  return word < deps.size() && (deps[word] >> (orderID % 64)) & 1ULL;
+}
+
+}  // namespace
+
+DNLModelClasses::DNLModelClasses(const DNLFull& dnl) {
+  modelOf_.assign(dnl.getDNLInstances().size(), kNoModel);
+  std::unordered_map<const SNLDesign*, uint32_t> indexOf;
+  for (DNLID leaf : dnl.getLeaves()) {
+    const SNLDesign* design = dnl.getDNLInstanceFromID(leaf).getSNLModel();
+    auto [it, inserted] =
+        indexOf.emplace(design, static_cast<uint32_t>(models_.size()));
+    if (inserted) {
+      models_.push_back({design, leaf, false, {}});
+    }
+    modelOf_[leaf] = it->second;
+  }
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, models_.size()),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      for (size_t m = r.begin(); m < r.end(); ++m) {
+                        classify(dnl, models_[m]);
+                      }
+                    });
+}
+
+void DNLModelClasses::classify(const DNLFull& dnl, Model& model) {
+  const auto [first, last] =
+      dnl.getDNLInstanceFromID(model.sample).getTermIndexes();
+  std::vector<SNLBitTerm*> bitTerms;
+  for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+    bitTerms.push_back(dnl.getDNLTerminalFromID(term).getSnlBitTerm());
+  }
+  model.flags.assign(bitTerms.size(), 0);
+  size_t numberOfInputs = 0, numberOfOutputs = 0;
+  for (const auto* bitTerm : bitTerms) {
+    if (!isOutputDir(bitTerm))
+      numberOfInputs++;
+    if (!isInputDir(bitTerm))
+      numberOfOutputs++;
+  }
+
+  // Input side: what the cones stop at.
+  if (numberOfInputs == 0 && numberOfOutputs > 1) {
+    for (size_t p = 0; p < bitTerms.size(); ++p) {
+      if (!isInputDir(bitTerms[p]))
+        model.flags[p] |= SourceOutput;
+    }
+  } else {
+    std::vector<SNLBitTerm*> seqBitTerms;
+    bool sequentialSource = false;
+    for (size_t p = 0; p < bitTerms.size(); ++p) {
+      auto related = SNLDesignModeling::getClockRelatedOutputs(bitTerms[p]);
+      if (!related.empty()) {
+        sequentialSource = true;
+        seqBitTerms.insert(seqBitTerms.end(), related.begin(), related.end());
+        if (!isInputDir(bitTerms[p]))
+          model.flags[p] |= SeqOutput;
+      }
+    }
+    for (size_t p = 0; p < bitTerms.size(); ++p) {
+      const SNLBitTerm* bitTerm = bitTerms[p];
+      if (isInputDir(bitTerm))
+        continue;
+      if (sequentialSource) {
+        if (std::find(seqBitTerms.begin(), seqBitTerms.end(), bitTerm) !=
+            seqBitTerms.end())
+          model.flags[p] |= SeqOutput;
+        continue;
+      }
+      const auto& tt = SNLDesignModeling::getTruthTable(
+          bitTerm->getDesign(), bitTerm->getOrderID());
+      if (!tt.isInitialized())
+        model.flags[p] |= UnmodeledOutput;
+      if (tt.all0() || tt.all1())
+        model.flags[p] |= ConstantOutput;
+    }
+    model.sequential = sequentialSource;
+  }
+
+  // Output side: what the miter compares.
+  std::vector<SNLBitTerm*> seqBitTerms;
+  bool sequentialSink = false;
+  for (size_t p = 0; p < bitTerms.size(); ++p) {
+    auto related = SNLDesignModeling::getClockRelatedInputs(bitTerms[p]);
+    if (!related.empty()) {
+      sequentialSink = true;
+      seqBitTerms.insert(seqBitTerms.end(), related.begin(), related.end());
+      if (!isOutputDir(bitTerms[p]))
+        model.flags[p] |= SeqInput;
+    }
+  }
+  model.sequential = model.sequential || sequentialSink;
+  if (sequentialSink) {
+    for (size_t p = 0; p < bitTerms.size(); ++p) {
+      if (!isOutputDir(bitTerms[p]) &&
+          std::find(seqBitTerms.begin(), seqBitTerms.end(), bitTerms[p]) !=
+              seqBitTerms.end())
+        model.flags[p] |= SeqInput;
+    }
+    return;
+  }
+  // Tables of the model outputs, shared by all its inputs.
+  std::vector<SNLTruthTable> tts;
+  for (const auto* bitTerm : bitTerms) {
+    if (isInputDir(bitTerm))
+      continue;
+    const auto& tt = SNLDesignModeling::getTruthTable(bitTerm->getDesign(),
+                                                      bitTerm->getOrderID());
+    if (tt.isInitialized() || tt.all0() || tt.all1())
+      tts.push_back(tt);
+  }
+  for (size_t p = 0; p < bitTerms.size(); ++p) {
+    if (isOutputDir(bitTerms[p]))
+      continue;
+    const uint64_t orderID = bitTerms[p]->getOrderID();
+    if (std::none_of(tts.begin(), tts.end(), [&](const SNLTruthTable& tt) {
+          return dependsOn(tt, orderID);
+        }))
+      model.flags[p] |= UnusedInput;
+  }
+}
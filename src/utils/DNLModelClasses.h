@@ -0,0 +1,66 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DNL.h"
+
+namespace KEPLER_FORMAL {
+
+/// Role of every terminal of the leaf cell models of a DNL in the miter
+/// boundary, computed once per SNLDesign instead of once per leaf instance.
+///
+/// Flags are stored per model and per terminal position, the position being
+/// the offset of the terminal in the instance term range (the same for all
+/// the instances of a model). The precedence of collectInputs and
+/// collectOutputs is already applied: a model with no input and several
+/// outputs only gets SourceOutput, a sequential model only gets the
+/// Seq* flags of its side.
+class DNLModelClasses {
+ public:
+  enum Flag : uint8_t {
+    SourceOutput = 1 << 0,     // output of a cell without inputs
+    SeqOutput = 1 << 1,        // clock related output (or its clock)
+    ConstantOutput = 1 << 2,   // tie cell output (all0/all1 table)
+    UnmodeledOutput = 1 << 3,  // output without truth table
+    SeqInput = 1 << 4,         // clock related input (or its clock)
+    UnusedInput = 1 << 5,      // input no output table depends on
+  };
+  /// Terminals cutting the cones on the input side (PIs).
+  static constexpr uint8_t kPrimaryInput =
+      SourceOutput | SeqOutput | ConstantOutput | UnmodeledOutput;
+  /// Terminals checked by the miter (POs).
+  static constexpr uint8_t kPrimaryOutput = SeqInput | UnusedInput;
+
+  /// Classify the model of every leaf of `dnl`, distinct models in parallel.
+  explicit DNLModelClasses(const naja::DNL::DNLFull& dnl);
+
+  size_t getNumModels() const { return models_.size(); }
+  /// Model index of leaf instance `leaf` (a DNL instance ID).
+  uint32_t getModelIndex(naja::DNL::DNLID leaf) const {
+    return modelOf_[leaf];
+  }
+  bool isSequential(uint32_t model) const { return models_[model].sequential; }
+  /// Flags of the terminal at `position` in the term range of the instances
+  /// of `model`.
+  uint8_t getFlags(uint32_t model, size_t position) const {
+    return models_[model].flags[position];
+  }
+
+ private:
+  struct Model {
+    const naja::NL::SNLDesign* design = nullptr;
+    naja::DNL::DNLID sample = naja::DNL::DNLID_MAX;  // a leaf of the model
+    bool sequential = false;
+    std::vector<uint8_t> flags;
+  };
+  static void classify(const naja::DNL::DNLFull& dnl, Model& model);
+
+  std::vector<Model> models_;
+  std::vector<uint32_t> modelOf_;  // DNL instance ID -> index in models_
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,86 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "DNLTermAttributes.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <unordered_map>
+#include "SNLDesignModeling.h"
+#include "TermID.h"
+
+using namespace KEPLER_FORMAL;
+using namespace naja::DNL;
+using namespace naja::NL;
+
+DNLTermAttributes::DNLTermAttributes(const DNLFull& dnl) {
+  // every structure built on this DNL stores TermIDs
+  checkTermIDs(dnl);
+  const size_t numTerms = dnl.getNBterms();
+  directions_.resize(numTerms);
+  models_.resize(numTerms);
+  orderIDs_.resize(numTerms);
+  topPorts_.resize(numTerms);
+  isoOf_.resize(numTerms);
+  tableOf_.assign(numTerms, kNoTable);
+  tbb::parallel_for(
+      tbb::blocked_range<DNLID>(0, numTerms),
+      [&](const tbb::blocked_range<DNLID>& r) {
+        for (DNLID term = r.begin(); term < r.end(); ++term) {
+          const DNLTerminalFull& t = dnl.getDNLTerminalFromID(term);
+          const SNLBitTerm* bitTerm = t.getSnlBitTerm();
+          directions_[term] = static_cast<uint8_t>(
+              static_cast<SNLBitTerm::Direction::DirectionEnum>(
+                  bitTerm->getDirection()));
+          models_[term] = t.getDNLInstance().getSNLModel();
+          orderIDs_[term] = static_cast<uint32_t>(bitTerm->getOrderID());
+          topPorts_[term] = t.isTopPort() ? 1 : 0;
+          isoOf_[term] = t.getIsoID();
+        }
+      });
+
+  // One table slot per terminal of each leaf model: the first instance of a
+  // model allocates its slots, the tables are read once per model.
+  std::unordered_map<const SNLDesign*, uint32_t> baseOf;
+  std::vector<DNLID> samples;  // one leaf per model, in slot order
+  std::vector<uint32_t> leafBase;
+  const auto& leaves = dnl.getLeaves();
+  leafBase.reserve(leaves.size());
+  uint32_t numTables = 0;
+  for (DNLID leaf : leaves) {
+    const DNLInstanceFull& inst = dnl.getDNLInstanceFromID(leaf);
+    auto [it, inserted] = baseOf.emplace(inst.getSNLModel(), numTables);
+    if (inserted) {
+      const auto [first, last] = inst.getTermIndexes();
+      if (first != DNLID_MAX) {
+        numTables += static_cast<uint32_t>(last - first + 1);
+      }
+      samples.push_back(leaf);
+    }
+    leafBase.push_back(it->second);
+  }
+  tables_.resize(numTables);
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, samples.size()),
+      [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t s = r.begin(); s < r.end(); ++s) {
+          const DNLInstanceFull& inst = dnl.getDNLInstanceFromID(samples[s]);
+          const auto [first, last] = inst.getTermIndexes();
+          const uint32_t base = baseOf.at(inst.getSNLModel());
+          for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+            tables_[base + (term - first)] = SNLDesignModeling::getTruthTable(
+                inst.getSNLModel(), orderIDs_[term]);
+          }
+        }
+      });
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, leaves.size()),
+      [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t l = r.begin(); l < r.end(); ++l) {
+          const auto [first, last] =
+              dnl.getDNLInstanceFromID(leaves[l]).getTermIndexes();
+          for (DNLID term = first; term != DNLID_MAX && term <= last; ++term) {
+            tableOf_[term] = leafBase[l] + static_cast<uint32_t>(term - first);
+          }
+        }
+      });
+}
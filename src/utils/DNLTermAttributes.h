@@ -0,0 +1,66 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "DNL.h"
+#include "SNLTruthTable.h"
+
+namespace KEPLER_FORMAL {
+
+/// Dense attributes of every terminal of a DNL, indexed by terminal ID and
+/// built once, in parallel: direction, model of the owning instance, order
+/// ID of the bit term, truth table, top port flag and iso. The hot paths
+/// read these arrays instead of walking terminal -> instance -> model ->
+/// bit term -> SNLDesignModeling for every lookup. Truth tables are stored
+/// once per model terminal and shared by all the instances of the model.
+class DNLTermAttributes {
+ public:
+  explicit DNLTermAttributes(const naja::DNL::DNLFull& dnl);
+
+  size_t getNumTerms() const { return models_.size(); }
+  naja::NL::SNLBitTerm::Direction getDirection(naja::DNL::DNLID term) const {
+    return static_cast<naja::NL::SNLBitTerm::Direction::DirectionEnum>(
+        directions_[term]);
+  }
+  bool isOutput(naja::DNL::DNLID term) const {
+    return getDirection(term) == naja::NL::SNLBitTerm::Direction::Output;
+  }
+  /// Model of the instance owning `term` (the top design for top ports).
+  const naja::NL::SNLDesign* getModel(naja::DNL::DNLID term) const {
+    return models_[term];
+  }
+  uint32_t getOrderID(naja::DNL::DNLID term) const { return orderIDs_[term]; }
+  bool isTopPort(naja::DNL::DNLID term) const { return topPorts_[term] != 0; }
+  /// Iso of `term`, DNLID_MAX when the terminal is not connected.
+  naja::DNL::DNLID getIsoID(naja::DNL::DNLID term) const {
+    return isoOf_[term];
+  }
+  /// Truth table of `term` in its leaf model, uninitialized for the
+  /// terminals of hierarchical instances and for the top ports.
+  const naja::NL::SNLTruthTable& getTruthTable(naja::DNL::DNLID term) const {
+    return tableOf_[term] == kNoTable ? noTable_ : tables_[tableOf_[term]];
+  }
+  /// Index of the truth table of `term`, equal for the same terminal of
+  /// all the instances of a model; kNoTable without a table.
+  uint32_t getTableIndex(naja::DNL::DNLID term) const { return tableOf_[term]; }
+  size_t getNumTables() const { return tables_.size(); }
+
+  static constexpr uint32_t kNoTable = std::numeric_limits<uint32_t>::max();
+
+ private:
+  std::vector<uint8_t> directions_;
+  std::vector<const naja::NL::SNLDesign*> models_;
+  std::vector<uint32_t> orderIDs_;
+  std::vector<uint8_t> topPorts_;
+  std::vector<naja::DNL::DNLID> isoOf_;
+  std::vector<uint32_t> tableOf_;
+  std::vector<naja::NL::SNLTruthTable> tables_;
+  naja::NL::SNLTruthTable noTable_;
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,111 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "ParallelSchedule.h"
+#include <tbb/info.h>
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+
+using namespace KEPLER_FORMAL;
+
+namespace {
+
+// ceil(quota / period), 0 for a missing or unlimited quota.
+size_t quotaCPUs(long long quota, long long period) {
+  if (quota <= 0 || period <= 0) {
+    return 0;
+  }
+  return static_cast<size_t>((quota + period - 1) / period);
+}
+
+}  // namespace
+
+size_t KEPLER_FORMAL::getCgroupCPUQuota() {
+  // cgroup v2: "<quota> <period>", quota being "max" when unlimited
+  if (std::ifstream cpuMax("/sys/fs/cgroup/cpu.max"); cpuMax) {
+    std::string quota;
+    long long period = 0;
+    if (cpuMax >> quota >> period && quota != "max") {
+      return quotaCPUs(std::stoll(quota), period);
+    }
+    return 0;
+  }
+  // cgroup v1: quota is -1 when unlimited
+  std::ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+  std::ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+  long long quota = 0, period = 0;
+  if (quotaFile >> quota && periodFile >> period) {
+    return quotaCPUs(quota, period);
+  }
+  return 0;
+}
+
+size_t KEPLER_FORMAL::resolveThreadCount(size_t requested) {
+  if (requested != 0) {
+    return requested;
+  }
+  size_t threads =
+      static_cast<size_t>(std::max(1, tbb::info::default_concurrency()));
+  if (const size_t quota = getCgroupCPUQuota(); quota != 0) {
+    threads = std::min(threads, quota);
+  }
+  return threads;
+}
+
+std::vector<size_t> KEPLER_FORMAL::largestFirst(
+    const std::vector<size_t>& costs) {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return costs[a] > costs[b];
+  });
+  return order;
+}
+
+std::vector<std::vector<size_t>> KEPLER_FORMAL::groupBySharedKeys(
+    const std::vector<std::vector<size_t>>& keys,
+    const std::vector<size_t>& costs,
+    size_t maxGroupCost) {
+  const size_t n = keys.size();
+  std::vector<size_t> parent(n);
+  std::iota(parent.begin(), parent.end(), 0);
+  std::vector<size_t> groupCost(costs.begin(), costs.begin() + n);
+  auto find = [&](size_t i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+  // first item seen with each key
+  std::unordered_map<size_t, size_t> owner;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t key : keys[i]) {
+      auto [it, inserted] = owner.emplace(key, i);
+      if (inserted) {
+        continue;
+      }
+      const size_t a = find(it->second);
+      const size_t b = find(i);
+      if (a != b && groupCost[a] + groupCost[b] <= maxGroupCost) {
+        // the root is the smaller item, i.e. the first item of the group
+        parent[std::max(a, b)] = std::min(a, b);
+        groupCost[std::min(a, b)] += groupCost[std::max(a, b)];
+      }
+    }
+  }
+  std::vector<std::vector<size_t>> groups;
+  std::vector<size_t> groupOf(n);
+  for (size_t i = 0; i < n; ++i) {
+    const size_t root = find(i);
+    if (root == i) {
+      groupOf[i] = groups.size();
+      groups.emplace_back();
+    }
+    groups[groupOf[root]].push_back(i);
+  }
+  return groups;
+}
@@ -0,0 +1,91 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace KEPLER_FORMAL {
+
+/// Worker count of the parallel phases: `requested` when non zero, else the
+/// CPUs the process may use, i.e. the TBB default concurrency (affinity
+/// mask) capped by the cgroup CPU quota of a container.
+size_t resolveThreadCount(size_t requested = 0);
+/// CPUs granted by the cgroup quota (v2 cpu.max, v1 cfs quota/period),
+/// rounded up; 0 when unlimited or unknown.
+size_t getCgroupCPUQuota();
+
+/// Indexes of `costs` by decreasing cost, ties in index order.
+std::vector<size_t> largestFirst(const std::vector<size_t>& costs);
+
+/// Run fn(order[k]) for every k inside `arena`. Each worker takes the next
+/// entry of `order` when it is done with the previous one, so with a
+/// largestFirst order the big items start first and the small ones fill the
+/// tail instead of one big item starting last.
+template <typename Fn>
+void runInOrder(tbb::task_arena& arena,
+                const std::vector<size_t>& order,
+                Fn&& fn) {
+  std::atomic<size_t> next{0};
+  arena.execute([&]() {
+    const int workers = tbb::this_task_arena::max_concurrency();
+    tbb::parallel_for(0, workers, [&](int) {
+      for (size_t k = next++; k < order.size(); k = next++) {
+        fn(order[k]);
+      }
+    });
+  });
+}
+
+/// Partition items into groups of items sharing a key (keys[i] are the keys
+/// of item i), by union-find in item order. A merge that would make a group
+/// cost more than maxGroupCost is skipped, so that a key shared by every
+/// item (a clock, a reset) does not serialize everything in one group.
+/// Groups are sorted by first item, items in increasing order.
+std::vector<std::vector<size_t>> groupBySharedKeys(
+    const std::vector<std::vector<size_t>>& keys,
+    const std::vector<size_t>& costs,
+    size_t maxGroupCost);
+
+/// Bounds the memory of the tasks running at the same time: acquire blocks
+/// until `bytes` fit in the budget next to the tasks already admitted. A
+/// task larger than the whole budget runs alone. A budget of 0 is
+/// unlimited.
+class MemoryGate {
+ public:
+  explicit MemoryGate(size_t budget) : budget_(budget) {}
+
+  void acquire(size_t bytes) {
+    if (budget_ == 0) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock,
+                   [&]() { return used_ == 0 || used_ + bytes <= budget_; });
+    used_ += bytes;
+  }
+  void release(size_t bytes) {
+    if (budget_ == 0) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= bytes;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  const size_t budget_;
+  size_t used_ = 0;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+}  // namespace KEPLER_FORMAL
@@ -0,0 +1,47 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "PathTrie.h"
+#include <algorithm>
+
+using namespace KEPLER_FORMAL;
+using namespace naja::NL;
+
+PathTrie::PathTrie() {
+  nodes_.push_back({kRoot, NLName()});
+}
+
+PathTrie::PathID PathTrie::child(PathID parent, const NLName& name) {
+  auto [it, inserted] = children_.emplace(
+      ChildKey{parent, name.getString()}, static_cast<PathID>(nodes_.size()));
+  if (inserted) {
+    nodes_.push_back({parent, name});
+  }
+  return it->second;
+}
+
+PathTrie::PathID PathTrie::intern(const std::vector<NLName>& names) {
+  PathID path = kRoot;
+  for (const auto& name : names) {
+    path = child(path, name);
+  }
+  return path;
+}
+
+std::vector<NLName> PathTrie::getNames(PathID path) const {
+  std::vector<NLName> names;
+  for (; path != kRoot; path = nodes_[path].parent) {
+    names.push_back(nodes_[path].name);
+  }
+  std::reverse(names.begin(), names.end());
+  return names;
+}
+
+std::string PathTrie::getString(PathID path, char separator) const {
+  std::string result;
+  for (const auto& name : getNames(path)) {
+    result += name.getString();
+    result += separator;
+  }
+  return result;
+}
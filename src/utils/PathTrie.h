@@ -0,0 +1,81 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NLName.h"
+
+namespace KEPLER_FORMAL {
+
+/// Interned hierarchical instance paths: each node is one instance name
+/// under its parent path, identified by a 32-bit PathID. Equal name
+/// sequences get the same ID, so paths coming from two designs compare as
+/// integers once interned in the same trie. The root (ID 0) is the top.
+class PathTrie {
+ public:
+  using PathID = uint32_t;
+  static constexpr PathID kRoot = 0;
+
+  PathTrie();
+
+  /// ID of `name` under `parent`, created on first use.
+  PathID child(PathID parent, const naja::NL::NLName& name);
+  /// ID of the path made of `names`, from the top down.
+  PathID intern(const std::vector<naja::NL::NLName>& names);
+
+  size_t size() const { return nodes_.size(); }
+  PathID getParent(PathID path) const { return nodes_[path].parent; }
+  const naja::NL::NLName& getName(PathID path) const {
+    return nodes_[path].name;
+  }
+  /// Instance names from the top down (empty for the root).
+  std::vector<naja::NL::NLName> getNames(PathID path) const;
+  /// Names joined by `separator`, each one followed by it.
+  std::string getString(PathID path, char separator) const;
+
+ private:
+  struct Node {
+    PathID parent;
+    naja::NL::NLName name;
+  };
+  struct ChildKey {
+    PathID parent;
+    std::string name;
+    bool operator==(const ChildKey&) const = default;
+  };
+  struct ChildKeyHash {
+    size_t operator()(const ChildKey& key) const {
+      return std::hash<std::string>()(key.name) ^
+             (static_cast<size_t>(key.parent) * 0x9e3779b97f4a7c15ULL);
+    }
+  };
+
+  std::vector<Node> nodes_;
+  std::unordered_map<ChildKey, PathID, ChildKeyHash> children_;
+};
+
+/// Design independent key of a terminal: interned instance path, bit term
+/// ID and bit. Ordered and hashed as plain integers.
+struct TermPathKey {
+  PathTrie::PathID path = PathTrie::kRoot;
+  uint32_t termID = 0;
+  int32_t bit = 0;
+  auto operator<=>(const TermPathKey&) const = default;
+};
+
+struct TermPathKeyHash {
+  size_t operator()(const TermPathKey& key) const {
+    uint64_t h = (static_cast<uint64_t>(key.path) << 32) | key.termID;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.bit)) *
+         0x9e3779b97f4a7c15ULL;
+    return std::hash<uint64_t>()(h);
+  }
+};
+
+}  // namespace KEPLER_FORMAL
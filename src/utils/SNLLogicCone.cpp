@@ -2,44 +2,60 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "SNLLogicCone.h"
+#include <tbb/enumerable_thread_specific.h>
 #include "SNLEquipotential.h"
+#include "TraversalMarks.h"
 
 using namespace KEPLER_FORMAL;
 using namespace naja::DNL;
 
+namespace {
+
+// Per-worker marks over terminals (PIs) and isos, reused from one cone to
+// the next.
+tbb::enumerable_thread_specific<TraversalMarks> piMarksETS;
+tbb::enumerable_thread_specific<TraversalMarks> isoMarksETS;
+
+}  // namespace
+
 void SNLLogicCone::run() {
+  if (graph_ == nullptr) {
+    ownedGraph_ = std::make_unique<DNLFaninGraph>(*dnl_);
+    graph_ = ownedGraph_.get();
+  }
+  TraversalMarks& piMarks = piMarksETS.local();
+  piMarks.reset(dnl_->getNBterms());
+  for (auto pi : PIs_) {
+    piMarks.mark(pi);
+  }
+  TraversalMarks& isoMarks = isoMarksETS.local();
+  isoMarks.reset(dnl_->getDNLIsoDB().getNumIsos());
+
   std::vector<naja::DNL::DNLID> currentIterationDrivers;
   std::vector<naja::DNL::DNLID> newIterationIsos;
-  newIterationIsos.push_back(
-      dnl_->getDNLTerminalFromID(seedOutputTerm_).getIsoID());
+  DNLID seedIso = graph_->getIsoID(seedOutputTerm_);
+  if (seedIso != naja::DNL::DNLID_MAX) {
+    isoMarks.mark(seedIso);
+    newIterationIsos.push_back(seedIso);
+  }
   while (!newIterationIsos.empty()) {
     currentIterationDrivers.clear();
     for (const auto& isoID : newIterationIsos) {
-      if (isoID != naja::DNL::DNLID_MAX) {
-        coneIsos_.push_back(isoID);
-        for (auto driver :
-             dnl_->getDNLIsoDB().getIsoFromIsoIDconst(isoID).getDrivers()) {
-          currentIterationDrivers.push_back(driver);
-        }
+      coneIsos_.push_back(isoID);
+      for (auto driver : graph_->getIsoDrivers(isoID)) {
+        currentIterationDrivers.push_back(driver);
       }
     }
     newIterationIsos.clear();
     for (auto driver : currentIterationDrivers) {
-      if (std::find(PIs_.begin(), PIs_.end(), driver) != PIs_.end()) {
+      if (piMarks.isMarked(driver)) {
         continue;  // Skip PIs and loops(?)
       }
-      DNLInstanceFull inst =
-          dnl_->getDNLTerminalFromID(driver).getDNLInstance();
-      for (DNLID termID = inst.getTermIndexes().first;
-           termID <= inst.getTermIndexes().second && termID != DNLID_MAX;
-           termID++) {
-        const DNLTerminalFull& term = dnl_->getDNLTerminalFromID(termID);
-        if (term.getSnlBitTerm()->getDirection() !=
-            SNLBitTerm::Direction::Output) {
-          if (std::find(coneIsos_.begin(), coneIsos_.end(), term.getIsoID()) ==
-              coneIsos_.end()) {
-            newIterationIsos.push_back(term.getIsoID());
-          }
+      for (DNLID termID : graph_->getDriverInputs(driver)) {
+        // each iso enters the cone once
+        const DNLID isoID = graph_->getIsoID(termID);
+        if (isoID != naja::DNL::DNLID_MAX && isoMarks.mark(isoID)) {
+          newIterationIsos.push_back(isoID);
         }
       }
     }
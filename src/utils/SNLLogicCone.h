@@ -3,7 +3,11 @@
 
 #pragma once
 
+#include <memory>
+
 #include "DNL.h"
+#include "DNLFaninGraph.h"
+#include "TermID.h"
 
 namespace naja {
 namespace NL {
@@ -16,26 +20,34 @@ namespace KEPLER_FORMAL {
 class SNLLogicCone {
  public:
   SNLLogicCone(naja::DNL::DNLID seedOutputTerm,
-               std::vector<naja::DNL::DNLID> pis)
+               std::vector<TermID> pis)
       : seedOutputTerm_(seedOutputTerm), PIs_(pis) {
     naja::DNL::destroy();
     dnl_ = naja::DNL::get();
   }
+  // `dnl` is used as is and must be the current naja::DNL: the
+  // equipotentials are built through it.
   SNLLogicCone(naja::DNL::DNLID seedOutputTerm,
-               std::vector<naja::DNL::DNLID> pis,
+               std::vector<TermID> pis,
                naja::DNL::DNLFull* dnl)
-      : seedOutputTerm_(seedOutputTerm), PIs_(pis) {
-    naja::DNL::destroy();
-    dnl_ = dnl;
-  }
+      : seedOutputTerm_(seedOutputTerm), PIs_(pis), dnl_(dnl) {}
+  // `graph` must be built on `dnl` and outlive the cone; share it between
+  // the cones of a design.
+  SNLLogicCone(naja::DNL::DNLID seedOutputTerm,
+               std::vector<TermID> pis,
+               naja::DNL::DNLFull* dnl,
+               const DNLFaninGraph* graph)
+      : seedOutputTerm_(seedOutputTerm), PIs_(pis), dnl_(dnl), graph_(graph) {}
   void run();
   std::vector<naja::NL::SNLEquipotential> getEquipotentials() const;
 
  private:
   naja::DNL::DNLID seedOutputTerm_;
   std::vector<naja::DNL::DNLID> coneIsos_;
-  std::vector<naja::DNL::DNLID> PIs_;
+  std::vector<TermID> PIs_;
   naja::DNL::DNLFull* dnl_;
+  std::unique_ptr<DNLFaninGraph> ownedGraph_;
+  const DNLFaninGraph* graph_ = nullptr;
 };
 
 }  // namespace KEPLER_FORMAL
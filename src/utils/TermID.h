@@ -0,0 +1,61 @@
+// Copyright 2024-2026 keplertech.io
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DNL.h"
+
+namespace KEPLER_FORMAL {
+
+/// Terminal handle of the kepler structures (trees, clouds, PI/PO lists,
+/// var names). naja's DNLID is 64 bits but no design has 2^32 terminals, so
+/// the handle is 32 bits unless built with KEPLER_64BIT_TERM_IDS. The range
+/// is checked once per DNL by checkTermIDs; toTermID only asserts.
+#ifdef KEPLER_64BIT_TERM_IDS
+using TermID = uint64_t;
+#else
+using TermID = uint32_t;
+#endif
+constexpr TermID kNoTermID = std::numeric_limits<TermID>::max();
+
+/// Variable bound to a terminal: 0 and 1 are the constants, kNoVarID an
+/// unbound terminal. Var names are indexed by terminal.
+using VarID = TermID;
+constexpr VarID kNoVarID = kNoTermID;
+
+/// DNLID_MAX maps to kNoTermID.
+inline TermID toTermID(naja::DNL::DNLID id) {
+  if (id == naja::DNL::DNLID_MAX) {
+    return kNoTermID;
+  }
+  assert(id < kNoTermID && "DNLID does not fit a TermID");
+  return static_cast<TermID>(id);
+}
+
+inline naja::DNL::DNLID toDNLID(TermID id) {
+  return id == kNoTermID ? naja::DNL::DNLID_MAX
+                         : static_cast<naja::DNL::DNLID>(id);
+}
+
+/// Throw when the terminals or instances of `dnl` do not fit a TermID (the
+/// two top values are kept for kNoTermID and the 0/1 var names).
+inline void checkTermIDs(const naja::DNL::DNLFull& dnl) {
+  const size_t limit = static_cast<size_t>(kNoTermID) - 2;
+  if (dnl.getNBterms() > limit || dnl.getDNLInstances().size() > limit) {
+    // LCOV_EXCL_START
+    throw std::overflow_error(
+        "DNL has " + std::to_string(dnl.getNBterms()) +
+        " terminals: too many for 32-bit TermIDs, reconfigure with "
+        "-DKEPLER_64BIT_TERM_IDS=ON");
+    // LCOV_EXCL_STOP
+  }
+}
+
+}  // namespace KEPLER_FORMAL
@@ -19,7 +19,21 @@
 #include "SNLScalarTerm.h"
 #include "SNLPath.h"
 #include "SNLCapnP.h"
+#include "SNLLogicCloud.h"
+#include "SNLLogicDAG.h"
+#include "SharedConeCache.h"
+#include "Tree2BoolExpr.h"
+#include "tbb/task_arena.h"
 #include "DNL.h"
+#include "DNLConstantPropagation.h"
+#include "DNLFaninGraph.h"
+#include "DNLModelClasses.h"
+#include "DNLTermAttributes.h"
+#include "ParallelSchedule.h"
+#include "PathTrie.h"
+#include "TermID.h"
+#include "TseitinEncoder.h"
+#include "simp/SimpSolver.h"
 
 using namespace naja;
 using namespace naja::NL;
@@ -35,6 +49,181 @@ void executeCommand(const std::string& command) {
   }
 }
 
+// Primitive cells in "nangate45", with the 2-input AND most tests
+// instantiate, and designs in "designs", in a fresh universe.
+struct TestLibraries {
+  NLUniverse* univ = nullptr;
+  NLLibrary* library = nullptr;
+  NLLibrary* designs = nullptr;
+  SNLDesign* andModel = nullptr;
+  SNLScalarTerm* andIn1 = nullptr;
+  SNLScalarTerm* andIn2 = nullptr;
+  SNLScalarTerm* andOut = nullptr;
+};
+
+TestLibraries createTestLibraries() {
+  TestLibraries libs;
+  libs.univ = NLUniverse::create();
+  NLDB* db = NLDB::create(libs.univ);
+  libs.library =
+      NLLibrary::create(db, NLLibrary::Type::Primitives, NLName("nangate45"));
+  libs.designs =
+      NLLibrary::create(db, NLLibrary::Type::Standard, NLName("designs"));
+  libs.andModel = SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                                    NLName("AND"));
+  libs.andIn1 = SNLScalarTerm::create(libs.andModel, SNLTerm::Direction::Input,
+                                      NLName("in1"));
+  libs.andIn2 = SNLScalarTerm::create(libs.andModel, SNLTerm::Direction::Input,
+                                      NLName("in2"));
+  libs.andOut = SNLScalarTerm::create(
+      libs.andModel, SNLTerm::Direction::Output, NLName("out"));
+  SNLDesignModeling::setTruthTable(libs.andModel, SNLTruthTable(2, 8));
+  return libs;
+}
+
+// Single-input primitive: a buffer with mask 2, an inverter with mask 1.
+struct UnaryCell {
+  SNLDesign* model = nullptr;
+  SNLScalarTerm* in = nullptr;
+  SNLScalarTerm* out = nullptr;
+};
+
+UnaryCell createUnaryCell(NLLibrary* library,
+                          const std::string& name,
+                          uint64_t mask) {
+  UnaryCell cell;
+  cell.model =
+      SNLDesign::create(library, SNLDesign::Type::Primitive, NLName(name));
+  cell.in = SNLScalarTerm::create(cell.model, SNLTerm::Direction::Input,
+                                  NLName("in"));
+  cell.out = SNLScalarTerm::create(cell.model, SNLTerm::Direction::Output,
+                                   NLName("out"));
+  SNLDesignModeling::setTruthTable(cell.model, SNLTruthTable(1, mask));
+  return cell;
+}
+
+// Top terminals of `dnl` split into PIs and POs, in terminal order.
+void collectTopTerms(const naja::DNL::DNLFull& dnl,
+                     std::vector<TermID>& PIs,
+                     std::vector<TermID>& POs) {
+  auto topTerms = dnl.getTop().getTermIndexes();
+  for (auto termId = topTerms.first; termId <= topTerms.second; ++termId) {
+    if (dnl.getDNLTerminalFromID(termId).getSnlBitTerm()->getDirection() ==
+        SNLTerm::Direction::Output) {
+      POs.push_back(termId);
+    } else {
+      PIs.push_back(termId);
+    }
+  }
+}
+
+// varNames of `dnl` binding PIs[i] to variable i + 2.
+std::vector<VarID> bindPIs(const naja::DNL::DNLFull& dnl,
+                           const std::vector<TermID>& PIs) {
+  std::vector<VarID> varNames(dnl.getNBterms(), kNoVarID);
+  for (size_t i = 0; i < PIs.size(); ++i) {
+    varNames[PIs[i]] = i + 2;
+  }
+  return varNames;
+}
+
+// out = in0 AND in1 AND ... AND in<depth>, one AND stage per logic level,
+// each stage reading the previous stage and a fresh primary input.
+SNLDesign* createAndChain(NLLibrary* library,
+                          SNLDesign* andModel,
+                          SNLBitTerm* andIn1,
+                          SNLBitTerm* andIn2,
+                          SNLBitTerm* andOut,
+                          size_t depth,
+                          const std::string& name) {
+  SNLDesign* top =
+      SNLDesign::create(library, SNLDesign::Type::Standard, NLName(name));
+  auto out = SNLScalarTerm::create(top, SNLTerm::Direction::Output,
+                                   NLName("out"));
+  auto in0 =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("in0"));
+  SNLNet* prev = SNLScalarNet::create(top, NLName("n0"));
+  in0->setNet(prev);
+  for (size_t k = 1; k <= depth; ++k) {
+    auto in = SNLScalarTerm::create(top, SNLTerm::Direction::Input,
+                                    NLName("in" + std::to_string(k)));
+    SNLNet* inNet = SNLScalarNet::create(top, NLName("i" + std::to_string(k)));
+    in->setNet(inNet);
+    SNLInstance* stage = SNLInstance::create(top, andModel,
+                                             NLName("and" + std::to_string(k)));
+    stage->getInstTerm(andIn1)->setNet(prev);
+    stage->getInstTerm(andIn2)->setNet(inNet);
+    SNLNet* next = SNLScalarNet::create(top, NLName("n" + std::to_string(k)));
+    stage->getInstTerm(andOut)->setNet(next);
+    prev = next;
+  }
+  out->setNet(prev);
+  return top;
+}
+
+// Work of the cone build of a single top output.
+struct ConeBuildWork {
+  size_t numNodes = 0;
+  size_t numSplices = 0;
+};
+
+// Build and convert the cone of the single top output of `top`.
+ConeBuildWork buildChainCone(NLUniverse* univ, SNLDesign* top, size_t depth) {
+  univ->setTopDesign(top);
+  naja::DNL::destroy();
+  auto dnl = naja::DNL::get();
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  collectTopTerms(*dnl, PIs, POs);
+  EXPECT_EQ(POs.size(), 1u);
+  EXPECT_EQ(PIs.size(), depth + 1);
+  std::vector<VarID> varNames = bindPIs(*dnl, PIs);
+
+  // The cloud and converter buffers are indexed by arena slot, so run inside
+  // an arena the same way BuildPrimaryOutputClauses does.
+  ConeBuildWork work;
+  tbb::task_arena arena(1);
+  arena.execute([&]() {
+    SNLLogicCloud cloud(POs[0], PIs, POs);
+    cloud.compute();
+    cloud.getTruthTable().finalize();
+    auto expr = Tree2BoolExpr::convert(cloud.getTruthTable(), varNames);
+
+    EXPECT_NE(expr, nullptr);
+    EXPECT_EQ(cloud.getInputs().size(), depth + 1);
+    EXPECT_EQ(cloud.getTruthTable().getNumBorderLeaves(), 0u);
+    work.numNodes = cloud.getTruthTable().getNumNodes();
+    work.numSplices = cloud.getTruthTable().getNumSplices();
+    cloud.destroy();
+  });
+  naja::DNL::destroy();
+  return work;
+}
+
+// AND chain of `depth` stages whose every stage is also a top output, so all
+// PO cones overlap. Loads it in the DNL and returns its PIs/POs and the
+// matching varNames.
+void loadTappedAndChain(size_t depth,
+                        std::vector<TermID>& PIs,
+                        std::vector<TermID>& POs,
+                        std::vector<VarID>& varNames) {
+  const TestLibraries libs = createTestLibraries();
+
+  SNLDesign* top =
+      createAndChain(libs.designs, libs.andModel, libs.andIn1, libs.andIn2,
+                     libs.andOut, depth, "tapped");
+  for (size_t k = 1; k < depth; ++k) {
+    auto tap = SNLScalarTerm::create(top, SNLTerm::Direction::Output,
+                                     NLName("tap" + std::to_string(k)));
+    tap->setNet(top->getNet(NLName("n" + std::to_string(k))));
+  }
+  libs.univ->setTopDesign(top);
+  naja::DNL::destroy();
+  auto dnl = naja::DNL::get();
+  collectTopTerms(*dnl, PIs, POs);
+  varNames = bindPIs(*dnl, PIs);
+}
+
 }  // namespace
 
 class MiterTests : public ::testing::Test {
@@ -581,6 +770,13 @@ TEST_F(MiterTests, TestMiterAndWithChainedInverter) {
     MiterStrategy MiterS(top, topClone, "CaseC");
     EXPECT_FALSE(MiterS.run());
   }
+  {
+    // one solver per PO group, run one at a time by the memory gate
+    MiterStrategy MiterS(top, topClone, "CaseC");
+    MiterS.setParallelSAT(true);
+    MiterS.setSolverMemoryBudget(1);
+    EXPECT_FALSE(MiterS.run());
+  }
   {
     // dump top to naja_if(CapProto)
     std::filesystem::path outputPath("./topEdited1.capnp");
@@ -620,6 +816,11 @@ TEST_F(MiterTests, TestMiterAndWithChainedInverter) {
     MiterStrategy MiterS(top, topClone, "CaseD");
     EXPECT_TRUE(MiterS.run());
   }
+  {
+    MiterStrategy MiterS(top, topClone, "CaseD");
+    MiterS.setParallelSAT(true);
+    EXPECT_TRUE(MiterS.run());
+  }
   {
     // dump top to naja_if(CapProto)
     std::filesystem::path outputPath("./topEdited2.capnp");
@@ -647,6 +848,885 @@ TEST_F(MiterTests, TestMiterAndWithChainedInverter) {
   
 }
 
+// Regression test: cone building on deep chains must stay linear in the
+// number of logic levels (reached PIs are not re-walked at every level).
+TEST_F(MiterTests, DeepChainConeBuildScalesLinearly) {
+  const TestLibraries libs = createTestLibraries();
+
+  const size_t smallDepth = 1024;
+  const size_t largeDepth = 4 * smallDepth;
+  SNLDesign* smallTop =
+      createAndChain(libs.designs, libs.andModel, libs.andIn1, libs.andIn2,
+                     libs.andOut, smallDepth, "chain1k");
+  SNLDesign* largeTop =
+      createAndChain(libs.designs, libs.andModel, libs.andIn1, libs.andIn2,
+                     libs.andOut, largeDepth, "chain4k");
+
+  const ConeBuildWork small = buildChainCone(libs.univ, smallTop, smallDepth);
+  const ConeBuildWork large = buildChainCone(libs.univ, largeTop, largeDepth);
+  // Each AND stage adds a table, its PI leaf and two splices (previous stage
+  // and PI). Re-walking the reached PIs at every level would make the
+  // splices quadratic in the depth.
+  for (const auto& [work, depth] :
+       {std::pair{small, smallDepth}, std::pair{large, largeDepth}}) {
+    EXPECT_LE(work.numNodes, 4 * (depth + 1)) << "depth " << depth;
+    EXPECT_LE(work.numSplices, 2 * (depth + 1)) << "depth " << depth;
+  }
+  EXPECT_EQ(large.numSplices - small.numSplices,
+            2 * (largeDepth - smallDepth));
+}
+
+// The shared DAG must give every PO the same (hash-consed) expression as its
+// own cloud, while converting each gate only once.
+TEST_F(MiterTests, SharedDagMatchesPerOutputClouds) {
+  const size_t depth = 16;
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  std::vector<VarID> varNames;
+  loadTappedAndChain(depth, PIs, POs, varNames);
+  ASSERT_EQ(POs.size(), depth);
+
+  tbb::task_arena arena(4);
+  arena.execute([&]() {
+    SNLLogicDAG dag(PIs, POs, varNames);
+    dag.compute();
+    EXPECT_EQ(dag.getNumDrivers(), depth);
+    EXPECT_EQ(dag.getNumLevels(), depth);
+    for (size_t i = 0; i < POs.size(); ++i) {
+      SNLLogicCloud cloud(POs[i], PIs, POs);
+      cloud.compute();
+      cloud.getTruthTable().finalize();
+      auto expr = Tree2BoolExpr::convert(cloud.getTruthTable(), varNames);
+      EXPECT_EQ(dag.getPOExpr(i).get(), expr.get()) << "PO " << i;
+      cloud.destroy();
+    }
+  });
+}
+
+// Every stage net has two readers; with a fanout threshold of 1 each PO
+// cloud stops at the stages published by the previous ones.
+TEST_F(MiterTests, SharedConeCacheStopsAtPublishedDrivers) {
+  const size_t depth = 16;
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  std::vector<VarID> varNames;
+  loadTappedAndChain(depth, PIs, POs, varNames);
+
+  tbb::task_arena arena(1);
+  arena.execute([&]() {
+    std::vector<std::shared_ptr<BoolExpr>> reference;
+    for (auto po : POs) {
+      SNLLogicCloud cloud(po, PIs, POs);
+      cloud.compute();
+      cloud.getTruthTable().finalize();
+      reference.push_back(
+          Tree2BoolExpr::convert(cloud.getTruthTable(), varNames));
+      cloud.destroy();
+    }
+
+    DNLFaninGraph graph(*naja::DNL::get());
+    SharedConeCache cache(graph, 1);
+    size_t cachedNodes = 0;
+    for (size_t pass = 0; pass < 2; ++pass) {
+      cachedNodes = 0;
+      for (size_t i = 0; i < POs.size(); ++i) {
+        SNLLogicCloud cloud(POs[i], PIs, POs, &cache);
+        cloud.compute();
+        cloud.getTruthTable().finalize();
+        cachedNodes += cloud.getTruthTable().getNumNodes();
+        auto expr =
+            Tree2BoolExpr::convert(cloud.getTruthTable(), varNames, &cache);
+        EXPECT_EQ(expr.get(), reference[i].get()) << "PO " << i;
+        cloud.destroy();
+      }
+    }
+    // all but the last stage are published: in the second pass every tap is
+    // a P leaf over its Input (2 nodes) and the top output is its AND over
+    // two P leaves (5 nodes)
+    EXPECT_EQ(cache.size(), depth - 1);
+    EXPECT_EQ(cachedNodes, 2 * (POs.size() - 1) + 5);
+  });
+}
+
+// Every PO of the tapped chain is driven by one AND output whose two inputs
+// are listed in terminal order; clouds over a shared graph match standalone
+// ones.
+TEST_F(MiterTests, FaninGraphMatchesDNL) {
+  const size_t depth = 8;
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  std::vector<VarID> varNames;
+  loadTappedAndChain(depth, PIs, POs, varNames);
+  const auto& dnl = *naja::DNL::get();
+  DNLFaninGraph graph(dnl);
+  ASSERT_EQ(graph.getNumTerms(), dnl.getNBterms());
+  for (auto po : POs) {
+    EXPECT_TRUE(graph.isOutputTerm(po));
+    auto drivers = graph.getDrivers(po);
+    ASSERT_EQ(drivers.size(), 1u);
+    const auto& driver = dnl.getDNLTerminalFromID(drivers[0]);
+    EXPECT_TRUE(graph.isOutputTerm(drivers[0]));
+    EXPECT_EQ(graph.getInstanceID(drivers[0]), driver.getDNLInstance().getID());
+    auto inputs = graph.getDriverInputs(drivers[0]);
+    ASSERT_EQ(inputs.size(), 2u);
+    EXPECT_EQ(inputs[0], driver.getDNLInstance().getTermIndexes().first);
+    EXPECT_LT(inputs[0], inputs[1]);
+    for (auto input : inputs) {
+      EXPECT_FALSE(graph.isOutputTerm(input));
+      EXPECT_EQ(graph.getIsoID(input),
+                dnl.getDNLTerminalFromID(input).getIsoID());
+    }
+  }
+  for (auto pi : PIs) {
+    EXPECT_FALSE(graph.isOutputTerm(pi));
+  }
+
+  const DNLTermSet piSet(dnl.getNBterms(), PIs);
+  const DNLTermSet poSet(dnl.getNBterms(), POs);
+  tbb::task_arena arena(1);
+  arena.execute([&]() {
+    for (auto po : POs) {
+      SNLLogicCloud standalone(po, PIs, POs);
+      standalone.compute();
+      standalone.getTruthTable().finalize();
+      SNLLogicCloud shared(po, piSet, poSet, graph);
+      shared.compute();
+      shared.getTruthTable().finalize();
+      EXPECT_EQ(
+          Tree2BoolExpr::convert(shared.getTruthTable(), varNames).get(),
+          Tree2BoolExpr::convert(standalone.getTruthTable(), varNames).get());
+      standalone.destroy();
+      shared.destroy();
+    }
+  });
+}
+
+// out = (INV(INV(INV(BUF... a))) AND b: with the bypass the AND reads a
+// directly, the three inversions folded into its table.
+TEST_F(MiterTests, BufferAndInverterChainsAreBypassed) {
+  const TestLibraries libs = createTestLibraries();
+  const UnaryCell inv = createUnaryCell(libs.library, "INV", 1);
+  const UnaryCell buf = createUnaryCell(libs.library, "BUF", 2);
+
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("buffered"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto b = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("b"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* prev = SNLScalarNet::create(top, NLName("a"));
+  a->setNet(prev);
+  for (size_t k = 0; k < 4; ++k) {
+    const bool isBuffer = k == 3;
+    SNLInstance* cell =
+        SNLInstance::create(top, isBuffer ? buf.model : inv.model,
+                            NLName("cell" + std::to_string(k)));
+    SNLNet* next = SNLScalarNet::create(top, NLName("x" + std::to_string(k)));
+    cell->getInstTerm(isBuffer ? buf.in : inv.in)->setNet(prev);
+    cell->getInstTerm(isBuffer ? buf.out : inv.out)->setNet(next);
+    prev = next;
+  }
+  SNLNet* bNet = SNLScalarNet::create(top, NLName("b"));
+  b->setNet(bNet);
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  out->setNet(outNet);
+  SNLInstance* stage = SNLInstance::create(top, libs.andModel, NLName("and"));
+  stage->getInstTerm(libs.andIn1)->setNet(prev);
+  stage->getInstTerm(libs.andIn2)->setNet(bNet);
+  stage->getInstTerm(libs.andOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  naja::DNL::destroy();
+  auto dnl = naja::DNL::get();
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  collectTopTerms(*dnl, PIs, POs);
+  ASSERT_EQ(PIs.size(), 2u);
+  ASSERT_EQ(POs.size(), 1u);
+  std::vector<VarID> varNames = bindPIs(*dnl, PIs);
+
+  tbb::task_arena arena(1);
+  arena.execute([&]() {
+    std::shared_ptr<BoolExpr> exprs[2];
+    size_t nodes[2];
+    for (int bypass = 0; bypass < 2; ++bypass) {
+      SNLLogicCloud cloud(POs[0], PIs, POs);
+      cloud.setBypassBuffers(bypass != 0);
+      cloud.compute();
+      cloud.getTruthTable().finalize();
+      nodes[bypass] = cloud.getTruthTable().getNumNodes();
+      exprs[bypass] = Tree2BoolExpr::convert(cloud.getTruthTable(), varNames);
+      EXPECT_EQ(cloud.getInputs().size(), 2u);
+      cloud.destroy();
+    }
+    // the four single-input tables and their input leaves are gone
+    EXPECT_EQ(nodes[0], 9u);
+    EXPECT_EQ(nodes[1], 5u);
+    EXPECT_EQ(exprs[0].get(), exprs[1].get());
+    EXPECT_EQ(exprs[1].get(),
+              BoolExpr::And(BoolExpr::Not(BoolExpr::Var(2)), BoolExpr::Var(3))
+                  .get());
+  });
+  naja::DNL::destroy();
+}
+
+// out = (a AND tie0) OR b: the AND is constant, so the cone of out stops
+// there; forcing b to 1 makes out itself constant.
+TEST_F(MiterTests, ConstantPropagationPrunesControlledBranches) {
+  const TestLibraries libs = createTestLibraries();
+  SNLDesign* orModel =
+      SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                        NLName("OR"));
+  auto orIn1 =
+      SNLScalarTerm::create(orModel, SNLTerm::Direction::Input, NLName("in1"));
+  auto orIn2 =
+      SNLScalarTerm::create(orModel, SNLTerm::Direction::Input, NLName("in2"));
+  auto orOut = SNLScalarTerm::create(orModel, SNLTerm::Direction::Output,
+                                     NLName("out"));
+  SNLDesignModeling::setTruthTable(orModel, SNLTruthTable(2, 14));
+  SNLDesign* tieModel =
+      SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                        NLName("TIE0"));
+  auto tieOut = SNLScalarTerm::create(tieModel, SNLTerm::Direction::Output,
+                                      NLName("out"));
+  SNLDesignModeling::setTruthTable(tieModel, SNLTruthTable(0, 0));
+
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("tied"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto b = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("b"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+  SNLNet* bNet = SNLScalarNet::create(top, NLName("b"));
+  SNLNet* zero = SNLScalarNet::create(top, NLName("zero"));
+  SNLNet* andNet = SNLScalarNet::create(top, NLName("and"));
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  a->setNet(aNet);
+  b->setNet(bNet);
+  out->setNet(outNet);
+  SNLInstance* tie = SNLInstance::create(top, tieModel, NLName("tie"));
+  tie->getInstTerm(tieOut)->setNet(zero);
+  SNLInstance* andInst = SNLInstance::create(top, libs.andModel, NLName("and"));
+  andInst->getInstTerm(libs.andIn1)->setNet(aNet);
+  andInst->getInstTerm(libs.andIn2)->setNet(zero);
+  andInst->getInstTerm(libs.andOut)->setNet(andNet);
+  SNLInstance* orInst = SNLInstance::create(top, orModel, NLName("or"));
+  orInst->getInstTerm(orIn1)->setNet(andNet);
+  orInst->getInstTerm(orIn2)->setNet(bNet);
+  orInst->getInstTerm(orOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  // PIs: a, b and the tie output, as collectInputs finds them
+  naja::DNL::destroy();
+  const auto& dnl = *naja::DNL::get();
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  collectTopTerms(dnl, PIs, POs);
+  ASSERT_EQ(PIs.size(), 2u);
+  ASSERT_EQ(POs.size(), 1u);
+  for (auto leaf : dnl.getLeaves()) {
+    const auto& inst = dnl.getDNLInstanceFromID(leaf);
+    if (inst.getSNLModel() == tieModel) {
+      PIs.push_back(inst.getTermIndexes().first);
+    }
+  }
+  ASSERT_EQ(PIs.size(), 3u);
+
+  DNLFaninGraph graph(dnl);
+  const DNLTermSet piSet(dnl.getNBterms(), PIs);
+  const DNLTermSet poSet(dnl.getNBterms(), POs);
+  DNLConstantPropagation constants(dnl, graph, piSet);
+  constants.run();
+  const auto orDriver = graph.getDrivers(POs[0])[0];
+  const auto andDriver =
+      graph.getDrivers(graph.getDriverInputs(orDriver)[0])[0];
+  EXPECT_EQ(constants.getValue(PIs[2]), DNLConstantPropagation::Value::Zero);
+  EXPECT_EQ(constants.getValue(andDriver),
+            DNLConstantPropagation::Value::Zero);
+  EXPECT_FALSE(constants.isConstant(orDriver));
+  EXPECT_EQ(constants.getConstants().size(), 2u);
+
+  std::vector<VarID> varNames = bindPIs(dnl, PIs);
+  constants.bindVarNames(varNames);
+  EXPECT_EQ(varNames[PIs[2]], 0u);
+  EXPECT_EQ(varNames[andDriver], 0u);
+
+  tbb::task_arena arena(1);
+  arena.execute([&]() {
+    size_t nodes[2];
+    for (int pruned = 0; pruned < 2; ++pruned) {
+      SNLLogicCloud cloud(POs[0], piSet, poSet, graph);
+      cloud.setConstants(pruned != 0 ? &constants : nullptr);
+      cloud.compute();
+      cloud.getTruthTable().finalize();
+      nodes[pruned] = cloud.getTruthTable().getNumNodes();
+      auto expr = Tree2BoolExpr::convert(cloud.getTruthTable(), varNames);
+      EXPECT_EQ(expr.get(), BoolExpr::Var(3).get()) << "pruned " << pruned;
+      cloud.destroy();
+    }
+    EXPECT_LT(nodes[1], nodes[0]);
+
+    // b forced to 1: the OR output is constant and the cone is a single leaf
+    DNLConstantPropagation forced(dnl, graph, piSet);
+    forced.setConstant(PIs[1], true);
+    forced.run();
+    EXPECT_EQ(forced.getValue(orDriver), DNLConstantPropagation::Value::One);
+    std::vector<VarID> forcedVarNames = varNames;
+    forced.bindVarNames(forcedVarNames);
+    SNLLogicCloud cloud(POs[0], piSet, poSet, graph);
+    cloud.setConstants(&forced);
+    cloud.compute();
+    cloud.getTruthTable().finalize();
+    EXPECT_EQ(
+        Tree2BoolExpr::convert(cloud.getTruthTable(), forcedVarNames).get(),
+        BoolExpr::createTrue().get());
+    cloud.destroy();
+  });
+  naja::DNL::destroy();
+}
+
+TEST_F(MiterTests, CaseAnalysisConstantsPruneCones) {
+  const TestLibraries libs = createTestLibraries();
+
+  // out = a & se
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("cased"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto se = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("se"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+  SNLNet* seNet = SNLScalarNet::create(top, NLName("se"));
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  a->setNet(aNet);
+  se->setNet(seNet);
+  out->setNet(outNet);
+  SNLInstance* andInst = SNLInstance::create(top, libs.andModel, NLName("and"));
+  andInst->getInstTerm(libs.andIn1)->setNet(aNet);
+  andInst->getInstTerm(libs.andIn2)->setNet(seNet);
+  andInst->getInstTerm(libs.andOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  auto buildPO = [](const BuildPrimaryOutputClauses::CaseConstants& constants) {
+    naja::DNL::destroy();
+    BuildPrimaryOutputClauses builder;
+    builder.setCaseConstants(constants);
+    builder.collect();
+    builder.build();
+    return builder.getPOs()[0];
+  };
+
+  // A top port held at 0 controls the AND away.
+  EXPECT_EQ(buildPO({{"se", false}}).get(), BoolExpr::createFalse().get());
+  // An instance pin is held through the net driving it: and/in1 is port a.
+  auto seOnly = buildPO({{"a", true}});
+  EXPECT_NE(seOnly.get(), BoolExpr::createTrue().get());
+  EXPECT_NE(seOnly.get(), BoolExpr::createFalse().get());
+  EXPECT_EQ(buildPO({{"and/in1", true}}).get(), seOnly.get());
+  // An internal output pin cuts its whole cone.
+  EXPECT_EQ(buildPO({{"and/out", true}}).get(), BoolExpr::createTrue().get());
+
+  EXPECT_THROW(buildPO({{"and/missing", true}}), std::runtime_error);
+  EXPECT_THROW(buildPO({{"a", true}, {"and/in1", false}}), std::runtime_error);
+  naja::DNL::destroy();
+}
+
+// A case constant on a net driven by a buffer or an inverter is pinned on
+// that cell output: the buffer bypass must stop there instead of reaching
+// the free port behind it.
+TEST_F(MiterTests, CaseConstantsHoldOnBufferedNets) {
+  const TestLibraries libs = createTestLibraries();
+  const UnaryCell inv = createUnaryCell(libs.library, "INV", 1);
+  const UnaryCell buf = createUnaryCell(libs.library, "BUF", 2);
+
+  // out = a & cell(se), cell being a buffer or an inverter
+  auto createTop = [&](bool inverter) {
+    SNLDesign* top =
+        SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                          NLName(inverter ? "inverted" : "buffered"));
+    auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+    auto se =
+        SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("se"));
+    auto out =
+        SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+    SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+    SNLNet* seNet = SNLScalarNet::create(top, NLName("se"));
+    SNLNet* cellNet = SNLScalarNet::create(top, NLName("se_cell"));
+    SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+    a->setNet(aNet);
+    se->setNet(seNet);
+    out->setNet(outNet);
+    SNLInstance* cell = SNLInstance::create(
+        top, inverter ? inv.model : buf.model, NLName("cell"));
+    cell->getInstTerm(inverter ? inv.in : buf.in)->setNet(seNet);
+    cell->getInstTerm(inverter ? inv.out : buf.out)->setNet(cellNet);
+    SNLInstance* andInst =
+        SNLInstance::create(top, libs.andModel, NLName("and"));
+    andInst->getInstTerm(libs.andIn1)->setNet(aNet);
+    andInst->getInstTerm(libs.andIn2)->setNet(cellNet);
+    andInst->getInstTerm(libs.andOut)->setNet(outNet);
+    return top;
+  };
+  SNLDesign* buffered = createTop(false);
+  SNLDesign* inverted = createTop(true);
+
+  auto buildPO = [&](SNLDesign* top,
+                     const BuildPrimaryOutputClauses::CaseConstants& constants) {
+    naja::DNL::destroy();
+    libs.univ->setTopDesign(top);
+    BuildPrimaryOutputClauses builder;
+    builder.setCaseConstants(constants);
+    builder.collect();
+    builder.build();
+    return builder.getPOs()[0];
+  };
+
+  // per-PO clouds, then the shared DAG
+  for (bool sharedDag : {false, true}) {
+    if (sharedDag) {
+      setenv("KEPLER_SHARED_DAG", "1", 1);
+    }
+    // and/in2 held at 1 leaves port a alone
+    auto aOnly = buildPO(buffered, {{"and/in2", true}});
+    EXPECT_NE(aOnly.get(), BoolExpr::createTrue().get());
+    EXPECT_NE(aOnly.get(), BoolExpr::createFalse().get());
+    EXPECT_EQ(buildPO(buffered, {{"and/in2", false}}).get(),
+              BoolExpr::createFalse().get())
+        << "shared DAG " << sharedDag;
+    EXPECT_EQ(buildPO(inverted, {{"and/in2", false}}).get(),
+              BoolExpr::createFalse().get())
+        << "shared DAG " << sharedDag;
+    EXPECT_EQ(buildPO(inverted, {{"and/in2", true}}).get(), aOnly.get())
+        << "shared DAG " << sharedDag;
+    // held behind the cell, the constant goes through it
+    EXPECT_EQ(buildPO(inverted, {{"se", true}}).get(),
+              BoolExpr::createFalse().get())
+        << "shared DAG " << sharedDag;
+  }
+  unsetenv("KEPLER_SHARED_DAG");
+  naja::DNL::destroy();
+}
+
+TEST_F(MiterTests, ModelClassesAreComputedOncePerModel) {
+  const TestLibraries libs = createTestLibraries();
+  SNLDesign* tieModel =
+      SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                        NLName("TIE1"));
+  auto tieOut = SNLScalarTerm::create(tieModel, SNLTerm::Direction::Output,
+                                      NLName("out"));
+  SNLDesignModeling::setTruthTable(tieModel, SNLTruthTable(0, 1));
+  // No truth table: its output is a cut point.
+  SNLDesign* boxModel =
+      SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                        NLName("BOX"));
+  auto boxIn =
+      SNLScalarTerm::create(boxModel, SNLTerm::Direction::Input, NLName("in"));
+  auto boxOut = SNLScalarTerm::create(boxModel, SNLTerm::Direction::Output,
+                                      NLName("out"));
+
+  // out = (a & tie1) & box(a)
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("classes"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+  SNLNet* oneNet = SNLScalarNet::create(top, NLName("one"));
+  SNLNet* and0Net = SNLScalarNet::create(top, NLName("and0"));
+  SNLNet* boxNet = SNLScalarNet::create(top, NLName("box"));
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  a->setNet(aNet);
+  out->setNet(outNet);
+  SNLInstance* tie = SNLInstance::create(top, tieModel, NLName("tie"));
+  tie->getInstTerm(tieOut)->setNet(oneNet);
+  SNLInstance* box = SNLInstance::create(top, boxModel, NLName("box"));
+  box->getInstTerm(boxIn)->setNet(aNet);
+  box->getInstTerm(boxOut)->setNet(boxNet);
+  SNLInstance* and0 = SNLInstance::create(top, libs.andModel, NLName("and0"));
+  and0->getInstTerm(libs.andIn1)->setNet(aNet);
+  and0->getInstTerm(libs.andIn2)->setNet(oneNet);
+  and0->getInstTerm(libs.andOut)->setNet(and0Net);
+  SNLInstance* and1 = SNLInstance::create(top, libs.andModel, NLName("and1"));
+  and1->getInstTerm(libs.andIn1)->setNet(and0Net);
+  and1->getInstTerm(libs.andIn2)->setNet(boxNet);
+  and1->getInstTerm(libs.andOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  naja::DNL::destroy();
+  const auto& dnl = *naja::DNL::get();
+  DNLModelClasses classes(dnl);
+  EXPECT_EQ(classes.getNumModels(), 3u);
+  std::map<const SNLDesign*, uint32_t> modelOf;
+  for (auto leaf : dnl.getLeaves()) {
+    const auto* model = dnl.getDNLInstanceFromID(leaf).getSNLModel();
+    auto [it, inserted] = modelOf.emplace(model, classes.getModelIndex(leaf));
+    // Both AND instances share their classification.
+    EXPECT_EQ(it->second, classes.getModelIndex(leaf));
+    EXPECT_FALSE(classes.isSequential(it->second));
+  }
+  ASSERT_EQ(modelOf.size(), 3u);
+  EXPECT_EQ(classes.getFlags(modelOf[tieModel], 0),
+            DNLModelClasses::ConstantOutput);
+  EXPECT_EQ(classes.getFlags(modelOf[boxModel], 1),
+            DNLModelClasses::UnmodeledOutput);
+  EXPECT_EQ(classes.getFlags(modelOf[libs.andModel], 2), 0u);
+  EXPECT_EQ(classes.getFlags(modelOf[boxModel], 0),
+            DNLModelClasses::UnusedInput);
+
+  // PIs: a, the tie output and the box output; the box input is a PO.
+  BuildPrimaryOutputClauses builder;
+  builder.collect();
+  EXPECT_EQ(builder.getInputs().size(), 3u);
+  for (auto leaf : dnl.getLeaves()) {
+    const auto& inst = dnl.getDNLInstanceFromID(leaf);
+    if (inst.getSNLModel() == boxModel) {
+      const auto& outputs = builder.getOutputs();
+      EXPECT_NE(std::find(outputs.begin(), outputs.end(),
+                          inst.getTermIndexes().first),
+                outputs.end());
+    }
+  }
+  naja::DNL::destroy();
+}
+
+TEST_F(MiterTests, PathTrieInternsSharedPrefixes) {
+  PathTrie paths;
+  const auto abc = paths.intern({NLName("a"), NLName("b"), NLName("c")});
+  const auto ab = paths.intern({NLName("a"), NLName("b")});
+  const auto abd = paths.child(ab, NLName("d"));
+  EXPECT_EQ(paths.intern({}), PathTrie::kRoot);
+  EXPECT_EQ(paths.getParent(abc), ab);
+  EXPECT_EQ(paths.intern({NLName("a"), NLName("b"), NLName("c")}), abc);
+  EXPECT_NE(abd, abc);
+  // root, a, a/b, a/b/c, a/b/d
+  EXPECT_EQ(paths.size(), 5u);
+  EXPECT_EQ(paths.getString(abd, '/'), "a/b/d/");
+  EXPECT_EQ(paths.getNames(abc).size(), 3u);
+  EXPECT_EQ(paths.getName(abc).getString(), "c");
+
+  BuildPrimaryOutputClauses::TermKeyMap keys;
+  keys[{abc, 3, 0}] = 10;
+  keys[{abc, 3, 1}] = 11;
+  EXPECT_EQ(keys.size(), 2u);
+  EXPECT_EQ(keys.at({abc, 3, 1}), 11u);
+  EXPECT_LT((TermPathKey{ab, 7, 0}), (TermPathKey{abc, 0, 0}));
+}
+
+TEST_F(MiterTests, BuildOnExplicitDNLKeepsItAlive) {
+  const TestLibraries libs = createTestLibraries();
+
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("top"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto b = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("b"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+  SNLNet* bNet = SNLScalarNet::create(top, NLName("b"));
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  a->setNet(aNet);
+  b->setNet(bNet);
+  out->setNet(outNet);
+  SNLInstance* andInst = SNLInstance::create(top, libs.andModel, NLName("and"));
+  andInst->getInstTerm(libs.andIn1)->setNet(aNet);
+  andInst->getInstTerm(libs.andIn2)->setNet(bNet);
+  andInst->getInstTerm(libs.andOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  naja::DNL::destroy();
+  BuildPrimaryOutputClauses reference;
+  reference.collect();
+  reference.build();
+
+  naja::DNL::destroy();
+  const naja::DNL::DNLFull& dnl = *naja::DNL::get();
+  BuildPrimaryOutputClauses builder0;
+  builder0.collect(dnl);
+  builder0.build(dnl);
+  // The DNL is still the one collected and built on: reuse it.
+  EXPECT_EQ(naja::DNL::get(), &dnl);
+  BuildPrimaryOutputClauses builder1;
+  builder1.collect(dnl);
+  builder1.build(dnl);
+
+  ASSERT_EQ(reference.getPOs().size(), 1u);
+  ASSERT_EQ(builder0.getPOs().size(), 1u);
+  ASSERT_EQ(builder1.getPOs().size(), 1u);
+  EXPECT_EQ(builder0.getPOs()[0].get(), reference.getPOs()[0].get());
+  EXPECT_EQ(builder1.getPOs()[0].get(), reference.getPOs()[0].get());
+  EXPECT_EQ(builder0.getOutputs(), reference.getOutputs());
+
+  // prepare defers the conversion, which no longer needs the DNL.
+  BuildPrimaryOutputClauses deferred;
+  deferred.collect(dnl);
+  deferred.prepare(dnl);
+  ASSERT_EQ(deferred.getNumDeferredPOs(), 1u);
+  naja::DNL::destroy();
+  tbb::task_arena arena(2);
+  arena.execute([&]() { deferred.convertPO(0); });
+  EXPECT_EQ(deferred.getPOs()[0].get(), reference.getPOs()[0].get());
+}
+
+TEST_F(MiterTests, LargestCostsAreScheduledFirst) {
+  EXPECT_EQ(resolveThreadCount(3), 3u);
+  EXPECT_GE(resolveThreadCount(), 1u);
+  const size_t quota = getCgroupCPUQuota();
+  if (quota != 0) {
+    EXPECT_LE(resolveThreadCount(), quota);
+  }
+
+  const std::vector<size_t> costs = {4, 1024, 7, 7, 0, 1024};
+  EXPECT_EQ(largestFirst(costs), (std::vector<size_t>{1, 5, 2, 3, 0, 4}));
+
+  // With one worker the items run exactly in the given order.
+  std::vector<size_t> ran;
+  tbb::task_arena single(1);
+  runInOrder(single, largestFirst(costs), [&](size_t i) { ran.push_back(i); });
+  EXPECT_EQ(ran, largestFirst(costs));
+
+  // With several, every item still runs once.
+  std::vector<std::atomic<int>> counts(1000);
+  tbb::task_arena arena(4);
+  runInOrder(arena, largestFirst(std::vector<size_t>(1000, 1)),
+             [&](size_t i) { counts[i]++; });
+  for (const auto& count : counts) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST_F(MiterTests, TermAttributesMatchDNLLookups) {
+  const TestLibraries libs = createTestLibraries();
+  // No truth table: its output is a cut point.
+  SNLDesign* boxModel =
+      SNLDesign::create(libs.library, SNLDesign::Type::Primitive,
+                        NLName("BOX"));
+  auto boxIn =
+      SNLScalarTerm::create(boxModel, SNLTerm::Direction::Input, NLName("in"));
+  auto boxOut = SNLScalarTerm::create(boxModel, SNLTerm::Direction::Output,
+                                      NLName("out"));
+
+  // out = (a & b) & box(a), c unconnected
+  SNLDesign* top = SNLDesign::create(libs.designs, SNLDesign::Type::Standard,
+                                     NLName("attributes"));
+  auto a = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("a"));
+  auto b = SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("b"));
+  SNLScalarTerm::create(top, SNLTerm::Direction::Input, NLName("c"));
+  auto out =
+      SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("out"));
+  SNLNet* aNet = SNLScalarNet::create(top, NLName("a"));
+  SNLNet* bNet = SNLScalarNet::create(top, NLName("b"));
+  SNLNet* and0Net = SNLScalarNet::create(top, NLName("and0"));
+  SNLNet* boxNet = SNLScalarNet::create(top, NLName("box"));
+  SNLNet* outNet = SNLScalarNet::create(top, NLName("out"));
+  a->setNet(aNet);
+  b->setNet(bNet);
+  out->setNet(outNet);
+  SNLInstance* box = SNLInstance::create(top, boxModel, NLName("box"));
+  box->getInstTerm(boxIn)->setNet(aNet);
+  box->getInstTerm(boxOut)->setNet(boxNet);
+  SNLInstance* and0 = SNLInstance::create(top, libs.andModel, NLName("and0"));
+  and0->getInstTerm(libs.andIn1)->setNet(aNet);
+  and0->getInstTerm(libs.andIn2)->setNet(bNet);
+  and0->getInstTerm(libs.andOut)->setNet(and0Net);
+  SNLInstance* and1 = SNLInstance::create(top, libs.andModel, NLName("and1"));
+  and1->getInstTerm(libs.andIn1)->setNet(and0Net);
+  and1->getInstTerm(libs.andIn2)->setNet(boxNet);
+  and1->getInstTerm(libs.andOut)->setNet(outNet);
+  libs.univ->setTopDesign(top);
+
+  naja::DNL::destroy();
+  const auto& dnl = *naja::DNL::get();
+  const DNLFaninGraph graph(dnl);
+  const DNLTermAttributes& attributes = graph.getAttributes();
+  ASSERT_EQ(attributes.getNumTerms(), dnl.getNBterms());
+  for (naja::DNL::DNLID term = 0; term < dnl.getNBterms(); ++term) {
+    const auto& t = dnl.getDNLTerminalFromID(term);
+    EXPECT_EQ(attributes.getDirection(term),
+              t.getSnlBitTerm()->getDirection());
+    EXPECT_EQ(attributes.getModel(term), t.getDNLInstance().getSNLModel());
+    EXPECT_EQ(attributes.getOrderID(term), t.getSnlBitTerm()->getOrderID());
+    EXPECT_EQ(attributes.isTopPort(term), t.isTopPort());
+    EXPECT_EQ(attributes.getIsoID(term), t.getIsoID());
+    if (t.isTopPort()) {
+      EXPECT_FALSE(attributes.getTruthTable(term).isInitialized());
+      continue;
+    }
+    const SNLTruthTable expected = SNLDesignModeling::getTruthTable(
+        t.getDNLInstance().getSNLModel(), t.getSnlBitTerm()->getOrderID());
+    EXPECT_EQ(attributes.getTruthTable(term).isInitialized(),
+              expected.isInitialized());
+    if (expected.isInitialized()) {
+      const SNLTruthTable& table = attributes.getTruthTable(term);
+      ASSERT_EQ(table.size(), expected.size());
+      for (uint64_t row = 0; row < (uint64_t{1} << expected.size()); ++row) {
+        EXPECT_EQ(table.bits().bit(row), expected.bits().bit(row));
+      }
+    }
+  }
+  // Tables are stored once per model terminal: AND (3) and BOX (2).
+  EXPECT_EQ(attributes.getNumTables(), 5u);
+  const auto [first0, last0] =
+      dnl.getDNLInstanceFromID(dnl.getLeaves()[1]).getTermIndexes();
+  const auto [first1, last1] =
+      dnl.getDNLInstanceFromID(dnl.getLeaves()[2]).getTermIndexes();
+  ASSERT_EQ(attributes.getModel(first0), libs.andModel);
+  ASSERT_EQ(attributes.getModel(first1), libs.andModel);
+  EXPECT_EQ(attributes.getTableIndex(last0), attributes.getTableIndex(last1));
+  EXPECT_TRUE(attributes.isOutput(last0));
+  EXPECT_EQ(graph.getIsoID(last0), attributes.getIsoID(last0));
+  naja::DNL::destroy();
+}
+
+TEST_F(MiterTests, TermIDsMapDNLIDs) {
+#ifdef KEPLER_64BIT_TERM_IDS
+  EXPECT_EQ(sizeof(TermID), 8u);
+#else
+  EXPECT_EQ(sizeof(TermID), 4u);
+#endif
+  EXPECT_EQ(toTermID(naja::DNL::DNLID_MAX), kNoTermID);
+  EXPECT_EQ(toDNLID(kNoTermID), naja::DNL::DNLID_MAX);
+  EXPECT_EQ(toDNLID(toTermID(123456)), 123456u);
+
+  std::vector<TermID> PIs;
+  std::vector<TermID> POs;
+  std::vector<VarID> varNames;
+  loadTappedAndChain(4, PIs, POs, varNames);
+  EXPECT_NO_THROW(checkTermIDs(*naja::DNL::get()));
+  for (auto pi : PIs) {
+    EXPECT_NE(varNames[pi], kNoVarID);
+  }
+  naja::DNL::destroy();
+}
+
+TEST_F(MiterTests, POsSharingSupportAreGrouped) {
+  // 0-1 share key 7, 2-3 share key 9, 4 has no key, 5 shares key 7 but would
+  // make the first group too costly
+  const std::vector<std::vector<size_t>> keys = {
+      {7, 1}, {7}, {9}, {2, 9}, {}, {7}};
+  const std::vector<size_t> costs = {2, 2, 1, 1, 1, 3};
+  EXPECT_EQ(groupBySharedKeys(keys, costs, 4),
+            (std::vector<std::vector<size_t>>{{0, 1}, {2, 3}, {4}, {5}}));
+  EXPECT_EQ(groupBySharedKeys(keys, costs, 100),
+            (std::vector<std::vector<size_t>>{{0, 1, 5}, {2, 3}, {4}}));
+
+  // The gate never admits more than the budget at once, except for a task
+  // larger than the budget, which runs alone.
+  MemoryGate gate(10);
+  std::atomic<size_t> inUse{0};
+  std::atomic<bool> overBudget{false};
+  tbb::task_arena arena(4);
+  runInOrder(arena, largestFirst(std::vector<size_t>(64, 1)), [&](size_t i) {
+    const size_t bytes = i == 0 ? 20 : 1 + i % 6;
+    gate.acquire(bytes);
+    const size_t total = inUse += bytes;
+    if (total > 10 && total != bytes) {
+      overBudget = true;
+    }
+    inUse -= bytes;
+    gate.release(bytes);
+  });
+  EXPECT_FALSE(overBudget.load());
+}
+
+// Tseitin encoding: one solver literal per distinct node, constants as the
+// two polarities of one variable, leaves of the same variable ID shared.
+// Throughput is measured by kepler-replay --encode-bench.
+TEST_F(MiterTests, TseitinEncodingSharesLiterals) {
+  Glucose::SimpSolver solver;
+  TseitinEncoder encoder(solver);
+  const Glucose::Lit one = encoder.encode(BoolExpr::createTrue());
+  EXPECT_EQ(encoder.encode(BoolExpr::createFalse()), ~one);
+  EXPECT_EQ(encoder.getNumEncodedNodes(), 2u);
+  const Glucose::Lit x = encoder.encode(BoolExpr::Var(1000));
+  EXPECT_NE(encoder.encode(BoolExpr::Not(BoolExpr::Var(1000))), x);
+  EXPECT_EQ(encoder.encode(BoolExpr::Var(1000)), x);
+  EXPECT_EQ(encoder.getNumEncodedNodes(), 4u);
+
+  // (x0 & x1) ^ (x1 | x2), the x1 leaf shared by both sides
+  auto x0 = BoolExpr::Var(2);
+  auto x1 = BoolExpr::Var(3);
+  auto x2 = BoolExpr::Var(4);
+  auto lhs = BoolExpr::And(x0, x1);
+  auto miter = BoolExpr::Xor(lhs, BoolExpr::Or(x1, x2));
+  const Glucose::Lit root = encoder.encode(miter);
+  EXPECT_EQ(encoder.getNumEncodedNodes(), 4u + 6u);
+  // encoded sub-expressions are reused, not re-encoded
+  EXPECT_EQ(encoder.encode(miter), root);
+  EXPECT_NE(encoder.encode(lhs), root);
+  EXPECT_EQ(encoder.getNumEncodedNodes(), 4u + 6u);
+}
+
+// o0 is equal in both designs; o1 and o2 differ exactly when b is 1, so the
+// first model splits both and only o0 needs a solve of its own.
+TEST_F(MiterTests, IncrementalCheckReportsEveryDifferingPO) {
+  const TestLibraries libs = createTestLibraries();
+  const UnaryCell inv = createUnaryCell(libs.library, "INV", 1);
+
+  // o0 = b & c; o1 = o2 = a & b in top0, !a & b in top1. The ports are
+  // created in the same order, so POs 0, 1, 2 are o0, o1, o2.
+  auto createTop = [&](const char* name, bool invertA) {
+    SNLDesign* top = SNLDesign::create(
+        libs.designs, SNLDesign::Type::Standard, NLName(name));
+    SNLNet* nets[3];
+    const char* inputs[3] = {"a", "b", "c"};
+    for (size_t k = 0; k < 3; ++k) {
+      auto in = SNLScalarTerm::create(top, SNLTerm::Direction::Input,
+                                      NLName(inputs[k]));
+      nets[k] = SNLScalarNet::create(top, NLName(inputs[k]));
+      in->setNet(nets[k]);
+    }
+    SNLNet* o0Net = SNLScalarNet::create(top, NLName("o0"));
+    SNLNet* xNet = SNLScalarNet::create(top, NLName("x"));
+    SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("o0"))
+        ->setNet(o0Net);
+    SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("o1"))
+        ->setNet(xNet);
+    SNLScalarTerm::create(top, SNLTerm::Direction::Output, NLName("o2"))
+        ->setNet(xNet);
+    SNLInstance* and0 = SNLInstance::create(top, libs.andModel, NLName("and0"));
+    and0->getInstTerm(libs.andIn1)->setNet(nets[1]);
+    and0->getInstTerm(libs.andIn2)->setNet(nets[2]);
+    and0->getInstTerm(libs.andOut)->setNet(o0Net);
+    SNLNet* aNet = nets[0];
+    if (invertA) {
+      aNet = SNLScalarNet::create(top, NLName("na"));
+      SNLInstance* invInst = SNLInstance::create(top, inv.model, NLName("inv"));
+      invInst->getInstTerm(inv.in)->setNet(nets[0]);
+      invInst->getInstTerm(inv.out)->setNet(aNet);
+    }
+    SNLInstance* and1 = SNLInstance::create(top, libs.andModel, NLName("and1"));
+    and1->getInstTerm(libs.andIn1)->setNet(aNet);
+    and1->getInstTerm(libs.andIn2)->setNet(nets[1]);
+    and1->getInstTerm(libs.andOut)->setNet(xNet);
+    return top;
+  };
+  SNLDesign* top0 = createTop("top0", false);
+  SNLDesign* top1 = createTop("top1", true);
+
+  {
+    MiterStrategy MiterS(top0, top1, "CaseIncremental");
+    EXPECT_FALSE(MiterS.run());
+    EXPECT_EQ(MiterS.getFailedPOs(),
+              (std::vector<naja::DNL::DNLID>{1, 2}));
+    EXPECT_LT(MiterS.getNumSolves(), 3u);
+  }
+  {
+    MiterStrategy MiterS(top0, top1, "CaseIncremental");
+    MiterS.setParallelSAT(true);
+    EXPECT_FALSE(MiterS.run());
+    EXPECT_EQ(MiterS.getFailedPOs(),
+              (std::vector<naja::DNL::DNLID>{1, 2}));
+  }
+  {
+    MiterStrategy MiterS(top0, top0, "CaseIncremental");
+    EXPECT_TRUE(MiterS.run());
+    EXPECT_TRUE(MiterS.getFailedPOs().empty());
+    EXPECT_EQ(MiterS.getNumSolves(), 1u);
+  }
+  naja::DNL::destroy();
+}
+
 // Required main function for Google Test
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,12 +1,23 @@
 // Copyright 2024-2025 keplertech.io
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include "DNLTermSet.h"
+#include "SNLLogicCloudDump.h"
 #include "SNLTruthTableTree.h"
+#include "SNLTruthTableTreeSimulator.h"
+#include "SmallIdVector.h"
+#include "TraversalMarks.h"
+#include "Tree2BoolExpr.h"
 #include "SNLTruthTable.h"
 
 #include <gtest/gtest.h>
+#include <tbb/task_arena.h>
+#include <algorithm>
 #include <bitset>
+#include <cstring>
 #include <memory>
+#include <random>
+#include <sstream>
 #include <vector>
 #include <stdexcept>
 
@@ -261,6 +272,42 @@ TEST(SNLTruthTableTreeApiTest, DefaultConstructionAndMaxIdBehavior) {
   EXPECT_NO_THROW(tree.destroy());
 }
 
+// A moved tree rebinds its nodes to the new owner
+TEST(SNLTruthTableTreeApiTest, MoveRebindsNodesToNewOwner) {
+  SNLTruthTableTree tree;
+  auto p = std::make_shared<Node>(&tree, 0, 7, Node::Type::P);
+  uint32_t pId = tree.allocateNode(p);
+  auto in = std::make_shared<Node>(0u, &tree);
+  uint32_t inId = tree.allocateNode(in);
+  p->addChildId(inId);
+
+  SNLTruthTableTree moved(std::move(tree));
+  EXPECT_EQ(moved.getNumNodes(), 2u);
+  EXPECT_EQ(moved.nodeFromId(pId)->tree, &moved);
+  EXPECT_EQ(moved.nodeFromId(inId)->tree, &moved);
+  EXPECT_NO_THROW(moved.finalize());
+
+  SNLTruthTableTree assigned;
+  assigned = std::move(moved);
+  EXPECT_EQ(assigned.nodeFromId(pId)->tree, &assigned);
+  EXPECT_EQ(assigned.nodeFromId(inId)->tree, &assigned);
+  EXPECT_TRUE(assigned.nodeFromId(pId)->eval({true}));
+  EXPECT_NO_THROW(assigned.finalize());
+}
+
+#ifndef NDEBUG
+TEST(SNLTruthTableTreeApiTest, FinalizeRejectsMissingParentLink) {
+  SNLTruthTableTree tree;
+  auto p = std::make_shared<Node>(&tree, 0, 7, Node::Type::P);
+  tree.allocateNode(p);
+  auto in = std::make_shared<Node>(0u, &tree);
+  uint32_t inId = tree.allocateNode(in);
+  // child link without the matching parent link
+  p->childrenIds.push_back(inId);
+  EXPECT_THROW(tree.finalize(), std::logic_error);
+}
+#endif
+
 // Expect allocateNode to reject null shared_ptr
 TEST(SNLTruthTableTreeNodeFromIdTest, AllocateNullSharedPtrThrows) {
   SNLTruthTableTree tree;
@@ -509,6 +556,485 @@ TEST(SNLTruthTableTreeSizeEvalTest, SizeAndEvalBehavior) {
   EXPECT_THROW(tree.eval({true, false}), std::invalid_argument);
 }
 
+//------------------------------------------------------------------------------
+// Subtree collapsing tests
+//------------------------------------------------------------------------------
+
+// Chain of 2-input gates over Input leaves: g0(i0,i1), g1(g0,i2), ...
+static uint32_t buildGateChain(SNLTruthTableTree& tree,
+                               uint32_t numInputs,
+                               uint64_t mask) {
+  std::vector<uint32_t> inIds;
+  for (uint32_t i = 0; i < numInputs; ++i) {
+    auto in = std::make_shared<Node>(i, &tree);
+    inIds.push_back(tree.allocateNode(in));
+  }
+  uint32_t prev = inIds[0];
+  for (uint32_t i = 1; i < numInputs; ++i) {
+    auto gate = std::make_shared<Node>(0u, &tree);
+    gate->type = Node::Type::Table;
+    gate->data.termid = 2000 + i;
+    gate->truthTable = makeMaskTable(2, mask);
+    uint32_t gateId = tree.allocateNode(gate);
+    gate->addChildId(prev);
+    gate->addChildId(inIds[i]);
+    prev = gateId;
+  }
+  tree.setRootId(prev);
+  return prev;
+}
+
+static std::vector<bool> rowInputs(uint32_t numInputs, uint64_t row) {
+  std::vector<bool> in(numInputs);
+  for (uint32_t i = 0; i < numInputs; ++i) in[i] = (row >> i) & 1u;
+  return in;
+}
+
+TEST(SNLTruthTableTreeCollapseTest, PreservesFunctionOnRandomDag) {
+  std::mt19937_64 rng(0xc011);
+  SNLTruthTableTree tree;
+  const uint32_t numInputs = 6;
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < numInputs; ++i) {
+    auto in = std::make_shared<Node>(i, &tree);
+    ids.push_back(tree.allocateNode(in));
+  }
+  uint32_t rootId = SNLTruthTableTree::kInvalidId;
+  for (uint32_t t = 0; t < 24; ++t) {
+    uint32_t arity = 1 + (uint32_t)(rng() % 3);
+    auto table = std::make_shared<Node>(0u, &tree);
+    table->type = Node::Type::Table;
+    table->data.termid = 1000 + t;
+    table->truthTable = makeMaskTable(arity, rng() & ((uint64_t{1} << (1u << arity)) - 1));
+    rootId = tree.allocateNode(table);
+    for (uint32_t c = 0; c < arity; ++c) {
+      // mostly the latest nodes, so that single-parent chains appear
+      size_t span = std::min<size_t>(ids.size(), 4);
+      table->addChildId(ids[ids.size() - 1 - rng() % span]);
+    }
+    ids.push_back(rootId);
+  }
+  tree.setRootId(rootId);
+  const auto& root = tree.nodeFromId(rootId);
+  std::vector<bool> before;
+  for (uint64_t row = 0; row < 64; ++row)
+    before.push_back(root->eval(rowInputs(numInputs, row)));
+
+  EXPECT_GT(tree.collapse(), 0u);
+  EXPECT_NO_THROW(tree.finalize());
+  EXPECT_LE(root->getTruthTable().size(), 6u);
+  for (uint64_t row = 0; row < 64; ++row)
+    ASSERT_EQ(root->eval(rowInputs(numInputs, row)), before[row]) << "row " << row;
+}
+
+TEST(SNLTruthTableTreeCollapseTest, WideAndChainBecomesOneTable) {
+  SNLTruthTableTree tree;
+  uint32_t rootId = buildGateChain(tree, 8, 0b1000);
+  EXPECT_EQ(tree.collapse(6, 16, 64), 6u);
+  const auto& root = tree.nodeFromId(rootId);
+  ASSERT_EQ(root->getTruthTable().size(), 8u);
+  EXPECT_EQ(root->childrenIds.size(), 8u);
+  for (uint64_t row = 0; row < 256; ++row)
+    ASSERT_EQ(root->eval(rowInputs(8, row)), row == 255) << "row " << row;
+}
+
+TEST(SNLTruthTableTreeCollapseTest, XorChainIsLeftAlone) {
+  SNLTruthTableTree tree;
+  uint32_t rootId = buildGateChain(tree, 8, 0b0110);
+  // the parity of k inputs has 2^(k-1) on-set rows, more cubes than the
+  // XOR2 chain it would replace
+  EXPECT_EQ(tree.collapse(6, 16, 64), 0u);
+  const auto& root = tree.nodeFromId(rootId);
+  EXPECT_EQ(root->getTruthTable().size(), 2u);
+  for (uint64_t row = 0; row < 256; ++row) {
+    ASSERT_EQ(root->eval(rowInputs(8, row)),
+              (std::bitset<8>(row).count() & 1u) != 0) << "row " << row;
+  }
+}
+
+// AND2 chain over two P nodes per terminal 10..13: the eight P leaves are
+// four composite inputs, so the whole chain fits in 4 inputs.
+TEST(SNLTruthTableTreeCollapseTest, DuplicatePLeavesShareOneInput) {
+  SNLTruthTableTree tree;
+  std::vector<uint32_t> pIds;
+  for (uint32_t i = 0; i < 8; ++i) {
+    auto p = std::make_shared<Node>(&tree, 0, 10 + i % 4, Node::Type::P);
+    pIds.push_back(tree.allocateNode(p));
+    auto in = std::make_shared<Node>(i, &tree);
+    p->addChildId(tree.allocateNode(in));
+  }
+  uint32_t prev = pIds[0];
+  for (uint32_t i = 1; i < 8; ++i) {
+    auto gate = std::make_shared<Node>(0u, &tree);
+    gate->type = Node::Type::Table;
+    gate->data.termid = 2000 + i;
+    gate->truthTable = makeMaskTable(2, 0b1000);
+    uint32_t gateId = tree.allocateNode(gate);
+    gate->addChildId(prev);
+    gate->addChildId(pIds[i]);
+    prev = gateId;
+  }
+  tree.setRootId(prev);
+
+  EXPECT_EQ(tree.collapse(4, 4, 64), 6u);
+  EXPECT_NO_THROW(tree.finalize());
+  const auto& root = tree.nodeFromId(prev);
+  ASSERT_EQ(root->getTruthTable().size(), 4u);
+  ASSERT_EQ(root->childrenIds.size(), 4u);
+  for (uint32_t j = 0; j < 4; ++j) {
+    const auto& leaf = tree.nodeFromId(root->childrenIds[j]);
+    EXPECT_EQ(leaf->type, Node::Type::P);
+    EXPECT_EQ(leaf->data.termid, 10 + j);
+  }
+
+  // terminals 10..13 read rows 2..5: 16 patterns cover every assignment
+  std::vector<VarID> varNames(14, kNoVarID);
+  for (uint32_t j = 0; j < 4; ++j) varNames[10 + j] = 2 + j;
+  SNLTruthTableTreeSimulator sim;
+  size_t index = sim.addTree(tree, varNames);
+  std::vector<uint64_t> patterns = {0, 0, 0xaaaa, 0xcccc, 0xf0f0, 0xff00};
+  sim.simulate(patterns, 1);
+  EXPECT_EQ(sim.getOutput(index)[0], uint64_t{0x8000});
+}
+
+//------------------------------------------------------------------------------
+// Bit-parallel simulator tests
+//------------------------------------------------------------------------------
+
+// Random DAG of small tables over 6 inputs, children picked among earlier
+// nodes so subtrees get shared; every pattern must match Node::eval.
+TEST(SNLTruthTableTreeSimulatorTest, MatchesScalarEvalOnRandomDag) {
+  std::mt19937_64 rng(0x5eed);
+  SNLTruthTableTree tree;
+  const size_t numInputs = 6;
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < numInputs; ++i) {
+    auto in = std::make_shared<Node>(i, &tree);
+    in->type = Node::Type::Input;
+    in->data.inputIndex = i;
+    ids.push_back(tree.allocateNode(in));
+  }
+  uint32_t rootId = SNLTruthTableTree::kInvalidId;
+  for (uint32_t t = 0; t < 24; ++t) {
+    uint32_t arity = 1 + (uint32_t)(rng() % 4);
+    auto table = std::make_shared<Node>(0u, &tree);
+    table->type = Node::Type::Table;
+    table->data.termid = 1000 + t;  // distinct, allocateNode dedups by termid
+    table->truthTable = makeMaskTable(arity, rng() & ((uint64_t{1} << (1u << arity)) - 1));
+    rootId = tree.allocateNode(table);
+    for (uint32_t c = 0; c < arity; ++c) {
+      table->addChildId(ids[rng() % ids.size()]);
+    }
+    ids.push_back(rootId);
+  }
+  const auto& root = tree.nodeFromId(rootId);
+
+  SNLTruthTableTreeSimulator sim;
+  size_t index = sim.addRoot(tree, rootId);
+  EXPECT_LE(sim.getNumOps(index), 24u);
+  EXPECT_GE(sim.getNumLevels(index), 2u);
+
+  const size_t numWords = 3;
+  std::vector<uint64_t> patterns(numInputs * numWords);
+  for (auto& w : patterns) w = rng();
+  sim.simulate(patterns, numWords);
+
+  for (size_t p = 0; p < numWords * 64; ++p) {
+    std::vector<bool> in(numInputs);
+    for (size_t i = 0; i < numInputs; ++i) {
+      in[i] = (patterns[i * numWords + p / 64] >> (p % 64)) & 1u;
+    }
+    ASSERT_EQ(sim.getOutputBit(index, p), root->eval(in)) << "pattern " << p;
+  }
+}
+
+// XOR(a, a) with a = AND(x0, x1): the shared child is evaluated once.
+TEST(SNLTruthTableTreeSimulatorTest, SharedSubtreeEvaluatedOnce) {
+  SNLTruthTableTree tree;
+  auto x0 = std::make_shared<Node>(0u, &tree);
+  x0->type = Node::Type::Input;
+  x0->data.inputIndex = 0;
+  uint32_t x0Id = tree.allocateNode(x0);
+  auto x1 = std::make_shared<Node>(1u, &tree);
+  x1->type = Node::Type::Input;
+  x1->data.inputIndex = 1;
+  uint32_t x1Id = tree.allocateNode(x1);
+
+  auto a = std::make_shared<Node>(0u, &tree);
+  a->type = Node::Type::Table;
+  a->data.termid = 1;
+  a->truthTable = makeMaskTable(2, 0b1000);
+  uint32_t aId = tree.allocateNode(a);
+  a->addChildId(x0Id);
+  a->addChildId(x1Id);
+
+  auto x = std::make_shared<Node>(0u, &tree);
+  x->type = Node::Type::Table;
+  x->data.termid = 2;
+  x->truthTable = makeMaskTable(2, 0b0110);
+  uint32_t xId = tree.allocateNode(x);
+  x->addChildId(aId);
+  x->addChildId(aId);
+
+  SNLTruthTableTreeSimulator sim;
+  size_t andIndex = sim.addRoot(tree, aId);
+  size_t xorIndex = sim.addRoot(tree, xId);
+  EXPECT_EQ(sim.getNumOps(xorIndex), 2u);
+  EXPECT_EQ(sim.getNumLevels(xorIndex), 3u);
+
+  std::vector<uint64_t> patterns = {0b1010, 0b1100};
+  sim.simulate(patterns, 1);
+  EXPECT_EQ(sim.getOutput(andIndex)[0], uint64_t{0b1000});
+  EXPECT_EQ(sim.getOutput(xorIndex)[0], uint64_t{0});
+}
+
+// Variable binding through P nodes, as used by Tree2BoolExpr::convert.
+TEST(SNLTruthTableTreeSimulatorTest, VarNamesBindingAndConstants) {
+  SNLTruthTableTree tree(0, 0, SNLTruthTableTree::Node::Type::P);
+
+  SNLTruthTableTreeSimulator sim;
+  size_t varIndex = sim.addTree(tree, std::vector<VarID>{3});
+  size_t falseIndex = sim.addTree(tree, std::vector<VarID>{0});
+  size_t trueIndex = sim.addTree(tree, std::vector<VarID>{1});
+  EXPECT_EQ(sim.getNumTrees(), 3u);
+  EXPECT_EQ(sim.getNumInputRows(), 4u);
+
+  std::vector<uint64_t> patterns(4 * 2, 0);
+  patterns[3 * 2 + 0] = 0xdeadbeefull;
+  patterns[3 * 2 + 1] = 0x12345678ull;
+  sim.simulate(patterns, 2);
+  EXPECT_EQ(sim.getOutput(varIndex)[0], 0xdeadbeefull);
+  EXPECT_EQ(sim.getOutput(varIndex)[1], 0x12345678ull);
+  EXPECT_EQ(sim.getOutput(falseIndex)[1], uint64_t{0});
+  EXPECT_EQ(sim.getOutput(trueIndex)[0], ~uint64_t{0});
+
+  EXPECT_THROW(sim.simulate(std::vector<uint64_t>(2, 0), 2),
+               std::invalid_argument);
+}
+
+// AND(p10, XOR(p10, p11)); returns the id of the AND.
+static uint32_t buildDumpTree(SNLTruthTableTree& tree) {
+  std::vector<uint32_t> pIds;
+  for (uint32_t i = 0; i < 2; ++i) {
+    auto p = std::make_shared<Node>(&tree, 0, 10 + i, Node::Type::P);
+    pIds.push_back(tree.allocateNode(p));
+    auto in = std::make_shared<Node>(i, &tree);
+    p->addChildId(tree.allocateNode(in));
+  }
+  auto x = std::make_shared<Node>(0u, &tree);
+  x->type = Node::Type::Table;
+  x->data.termid = 100;
+  x->truthTable = makeMaskTable(2, 0b0110);
+  uint32_t xId = tree.allocateNode(x);
+  x->addChildId(pIds[0]);
+  x->addChildId(pIds[1]);
+  auto a = std::make_shared<Node>(0u, &tree);
+  a->type = Node::Type::Table;
+  a->data.termid = 101;
+  a->truthTable = makeMaskTable(2, 0b1000);
+  uint32_t aId = tree.allocateNode(a);
+  a->addChildId(pIds[0]);
+  a->addChildId(xId);
+  return aId;
+}
+
+static void writeDumpTree(std::ostream& out,
+                          const std::string& name,
+                          const SNLTruthTableTree& tree) {
+  std::vector<VarID> varNames(12, kNoVarID);
+  varNames[10] = 2;
+  varNames[11] = 3;
+  SNLLogicCloudDump::write(
+      out, name, tree, varNames,
+      [](naja::DNL::DNLID term) { return "pi" + std::to_string(term); });
+}
+
+// The dump survives a load round trip, with the P termids rewritten to local
+// input slots.
+TEST(SNLLogicCloudDumpTest, RoundTripPreservesTopologyAndBinding) {
+  SNLTruthTableTree tree;
+  const uint32_t aId = buildDumpTree(tree);
+  const auto& a = tree.nodeFromId(aId);
+  std::stringstream buffer;
+  for (int copy = 0; copy < 2; ++copy) {
+    writeDumpTree(buffer, "po" + std::to_string(copy), tree);
+  }
+
+  for (int copy = 0; copy < 2; ++copy) {
+    SNLLogicCloudDump::Record record;
+    ASSERT_TRUE(SNLLogicCloudDump::read(buffer, record));
+    EXPECT_EQ(record.name, "po" + std::to_string(copy));
+    EXPECT_EQ(record.tree.getNumNodes(), tree.getNumNodes());
+    EXPECT_EQ(record.varNames, (std::vector<VarID>{2, 3}));
+    EXPECT_EQ(record.inputKeys, (std::vector<std::string>{"pi10", "pi11"}));
+    const auto& loaded = record.tree.nodeFromId(aId);
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->tree, &record.tree);
+    for (unsigned m = 0; m < 4; ++m) {
+      std::vector<bool> in = {(m & 1u) != 0, (m & 2u) != 0};
+      EXPECT_EQ(loaded->eval(in), a->eval(in)) << "pattern " << m;
+    }
+  }
+  SNLLogicCloudDump::Record record;
+  EXPECT_FALSE(SNLLogicCloudDump::read(buffer, record));
+}
+
+// Every truncation and the corrupt fields below throw in the reader itself,
+// without relying on finalize (a no-op under NDEBUG).
+TEST(SNLLogicCloudDumpTest, CorruptRecordThrows) {
+  SNLTruthTableTree tree;
+  const uint32_t aId = buildDumpTree(tree);
+  std::stringstream buffer;
+  writeDumpTree(buffer, "po", tree);
+  const std::string dump = buffer.str();
+  auto readsOrThrows = [](const std::string& bytes) {
+    std::stringstream in(bytes);
+    SNLLogicCloudDump::Record record;
+    return SNLLogicCloudDump::read(in, record);
+  };
+  ASSERT_TRUE(readsOrThrows(dump));
+  for (size_t size = 1; size < dump.size(); ++size) {
+    EXPECT_THROW(readsOrThrows(dump.substr(0, size)), std::runtime_error)
+        << "truncated to " << size;
+  }
+
+  // magic, version, name length and "po", node count, root id, external
+  // input count, table count, then the arity of the first table
+  auto patched = [&dump](size_t offset, uint32_t value) {
+    std::string bytes = dump;
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    return bytes;
+  };
+  const size_t nameOffset = 8, rootOffset = 18, arityOffset = 34;
+  EXPECT_THROW(readsOrThrows(patched(nameOffset, 0xffffffffu)),
+               std::runtime_error);
+  EXPECT_THROW(readsOrThrows(patched(rootOffset, 0x10000u)),
+               std::runtime_error);
+  EXPECT_THROW(readsOrThrows(patched(arityOffset, 64)), std::runtime_error);
+
+  // the last node (the AND) ends with its two child ids and no parent
+  const size_t childOffset = dump.size() - 3 * sizeof(uint32_t);
+  uint32_t childId = 0;
+  std::memcpy(&childId, dump.data() + childOffset, sizeof(childId));
+  EXPECT_EQ(childId, tree.nodeFromId(aId)->childrenIds[0]);
+  EXPECT_THROW(readsOrThrows(patched(childOffset, 0xfffffff0u)),
+               std::runtime_error);
+}
+
+TEST(DNLTermSetTest, PackedMembership) {
+  DNLTermSet set(130, {0, 63, 64, 129});
+  for (naja::DNL::DNLID t = 0; t < 140; ++t) {
+    EXPECT_EQ(set.contains(t), t == 0 || t == 63 || t == 64 || t == 129)
+        << "term " << t;
+  }
+  EXPECT_FALSE(DNLTermSet().contains(0));
+}
+
+TEST(TraversalMarksTest, ResetStartsAFreshTraversal) {
+  TraversalMarks marks;
+  marks.reset(8);
+  EXPECT_TRUE(marks.mark(3));
+  EXPECT_FALSE(marks.mark(3));
+  EXPECT_TRUE(marks.isMarked(3));
+  EXPECT_FALSE(marks.isMarked(4));
+  // a new traversal forgets earlier marks and grows the ID space if needed
+  marks.reset(16);
+  EXPECT_FALSE(marks.isMarked(3));
+  EXPECT_TRUE(marks.mark(15));
+  EXPECT_TRUE(marks.mark(3));
+}
+
+TEST(SNLTruthTableTreeTest, NegateInputSwapsRows) {
+  // AND(a, b) with a complemented: only row a=0, b=1 is on
+  SNLTruthTable andA = SNLTruthTableTree::negateInput(SNLTruthTable(2, 8), 0);
+  EXPECT_EQ(andA.size(), 2u);
+  for (uint64_t m = 0; m < 4; ++m) {
+    EXPECT_EQ(andA.bits().bit(m), m == 2) << "row " << m;
+  }
+  // wide table: complementing an input twice gives the table back
+  naja::NajaDynamicBitset bits(128);
+  bits.set(5, true);
+  bits.set(100, true);
+  SNLTruthTable wide(7, bits);
+  SNLTruthTable once = SNLTruthTableTree::negateInput(wide, 6);
+  EXPECT_TRUE(once.bits().bit(5 + 64));
+  EXPECT_TRUE(once.bits().bit(100 - 64));
+  EXPECT_FALSE(once.bits().bit(5));
+  SNLTruthTable twice = SNLTruthTableTree::negateInput(once, 6);
+  for (uint64_t m = 0; m < 128; ++m) {
+    EXPECT_EQ(twice.bits().bit(m), m == 5 || m == 100) << "row " << m;
+  }
+}
+
+// A random DAG over P leaves converts to the same hash-consed expression
+// sequentially and level by level in parallel.
+TEST(Tree2BoolExprTest, ParallelConversionMatchesSequential) {
+  std::mt19937_64 rng(0x7a11);
+  SNLTruthTableTree tree;
+  const uint32_t numInputs = 8;
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < numInputs; ++i) {
+    auto p = std::make_shared<Node>(&tree, 0, 10 + i, Node::Type::P);
+    ids.push_back(tree.allocateNode(p));
+    auto in = std::make_shared<Node>(i, &tree);
+    p->addChildId(tree.allocateNode(in));
+  }
+  uint32_t rootId = SNLTruthTableTree::kInvalidId;
+  for (uint32_t t = 0; t < 200; ++t) {
+    uint32_t arity = 1 + (uint32_t)(rng() % 3);
+    auto table = std::make_shared<Node>(0u, &tree);
+    table->type = Node::Type::Table;
+    table->data.termid = 1000 + t;
+    table->truthTable =
+        makeMaskTable(arity, rng() & ((uint64_t{1} << (1u << arity)) - 1));
+    rootId = tree.allocateNode(table);
+    for (uint32_t c = 0; c < arity; ++c) {
+      size_t span = std::min<size_t>(ids.size(), 16);
+      table->addChildId(ids[ids.size() - 1 - rng() % span]);
+    }
+    ids.push_back(rootId);
+  }
+  tree.setRootId(rootId);
+  std::vector<VarID> varNames(10 + numInputs, kNoVarID);
+  for (uint32_t i = 0; i < numInputs; ++i) varNames[10 + i] = 2 + i;
+  // one input held at 0 by the binding
+  varNames[10] = 0;
+
+  const size_t threshold = Tree2BoolExpr::getParallelThreshold();
+  tbb::task_arena arena(4);
+  std::shared_ptr<BoolExpr> sequential, parallel;
+  arena.execute([&]() {
+    Tree2BoolExpr::setParallelThreshold(tree.getNumNodes() + 1);
+    sequential = Tree2BoolExpr::convert(tree, varNames);
+    Tree2BoolExpr::setParallelThreshold(1);
+    parallel = Tree2BoolExpr::convert(tree, varNames);
+  });
+  Tree2BoolExpr::setParallelThreshold(threshold);
+  ASSERT_NE(sequential, nullptr);
+  EXPECT_EQ(parallel.get(), sequential.get());
+}
+
+TEST(SmallIdVectorTest, SpillsPastInlineCapacity) {
+  std::pmr::monotonic_buffer_resource arena;
+  SmallIdVector ids(&arena);
+  for (uint32_t i = 0; i < 10; ++i) ids.push_back(100 + i);
+  ASSERT_EQ(ids.size(), 10u);
+  for (uint32_t i = 0; i < 10; ++i) EXPECT_EQ(ids[i], 100 + i);
+  ids.erase(std::find(ids.begin(), ids.end(), 103u));
+  EXPECT_EQ(ids.size(), 9u);
+  EXPECT_EQ(ids[3], 104u);
+  // copies own their storage
+  SmallIdVector copy(ids);
+  copy[0] = 7;
+  EXPECT_EQ(ids[0], 100u);
+  copy.resize(12);
+  EXPECT_EQ(copy[11], 0u);
+  SmallIdVector small;
+  small.assign(copy.begin(), copy.begin() + 3);
+  EXPECT_EQ(small.size(), 3u);
+  EXPECT_EQ(small[0], 7u);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();